@@ -0,0 +1,567 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include "qoi_archive.h"
+#include "qoi_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+static uint64_t qoi_archive_hash(const char *name, size_t name_length) {
+    // 64-bit FNV-1a.
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < name_length; i++) {
+        hash ^= (uint8_t)name[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static uint64_t qoi_archive_align(uint64_t offset, uint32_t alignment) {
+    return (offset + alignment - 1) & ~(uint64_t)(alignment - 1);
+}
+
+static int qoi_is_power_of_two(uint32_t value) {
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+// 64-bit file positioning; plain fseek() is limited to long.
+static int qoi_archive_seek(FILE *file, uint64_t offset) {
+#if defined(_WIN32)
+    return _fseeki64(file, (__int64)offset, SEEK_SET);
+#else
+    return fseeko(file, (off_t)offset, SEEK_SET);
+#endif
+}
+
+#if defined(_WIN32)
+static int qoi_archive_file_size(FILE *file, uint64_t *size) {
+    if (_fseeki64(file, 0, SEEK_END) != 0) {
+        return 1;
+    }
+    __int64 position = _ftelli64(file);
+    if (position < 0) {
+        return 1;
+    }
+    *size = (uint64_t)position;
+    return 0;
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// Reader
+
+int qoi_archive_open_memory(QOIArchive *archive, const uint8_t *data, size_t size) {
+    if (!archive || !data) {
+        return 1;
+    }
+    memset(archive, 0, sizeof(*archive));
+
+    if (size < QOI_ARCHIVE_HEADER_SIZE ||
+        data[0] != 'q' || data[1] != 'o' || data[2] != 'i' || data[3] != 'p') {
+        fprintf(stderr, "Error: Not a QOI archive.\n");
+        return 1;
+    }
+    uint32_t version = qoi_read_u32_be(data + 4);
+    uint32_t alignment = qoi_read_u32_be(data + 8);
+    uint32_t entry_count = qoi_read_u32_be(data + 12);
+    uint32_t bucket_count = qoi_read_u32_be(data + 16);
+    uint32_t names_size = qoi_read_u32_be(data + 20);
+    uint64_t index_offset = qoi_read_u64_be(data + 24);
+
+    if (version != QOI_ARCHIVE_VERSION) {
+        fprintf(stderr, "Error: Unsupported QOI archive version %u.\n", version);
+        return 1;
+    }
+    uint64_t index_size = (uint64_t)bucket_count * QOI_ARCHIVE_SLOT_SIZE + names_size;
+    if (!qoi_is_power_of_two(alignment) || !qoi_is_power_of_two(bucket_count) ||
+        entry_count > bucket_count || index_offset < QOI_ARCHIVE_HEADER_SIZE ||
+        index_offset > size || index_size > size - index_offset) {
+        fprintf(stderr, "Error: Corrupt QOI archive header.\n");
+        return 1;
+    }
+
+    archive->data = data;
+    archive->size = size;
+    archive->entry_count = entry_count;
+    archive->bucket_count = bucket_count;
+    archive->slots = data + index_offset;
+    archive->names = archive->slots + (size_t)bucket_count * QOI_ARCHIVE_SLOT_SIZE;
+    archive->names_size = names_size;
+    return 0;
+}
+
+int qoi_archive_open(QOIArchive *archive, const char *path) {
+    if (!archive || !path) {
+        return 1;
+    }
+    memset(archive, 0, sizeof(*archive));
+
+#if defined(_WIN32)
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        perror("Error opening QOI archive");
+        return 1;
+    }
+    uint64_t file_size = 0;
+    uint8_t *data = NULL;
+    if (qoi_archive_file_size(file, &file_size) == 0 && file_size > 0 && file_size <= SIZE_MAX &&
+        qoi_archive_seek(file, 0) == 0) {
+        data = (uint8_t *)malloc((size_t)file_size);
+        if (data && fread(data, 1, (size_t)file_size, file) != (size_t)file_size) {
+            free(data);
+            data = NULL;
+        }
+    }
+    fclose(file);
+    if (!data) {
+        fprintf(stderr, "Error: Could not read QOI archive '%s'.\n", path);
+        return 1;
+    }
+    if (qoi_archive_open_memory(archive, data, (size_t)file_size) != 0) {
+        free(data);
+        return 1;
+    }
+    archive->mapping = data;
+    archive->mapping_size = (size_t)file_size;
+    return 0;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("Error opening QOI archive");
+        return 1;
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+        perror("Error reading QOI archive size");
+        close(fd);
+        return 1;
+    }
+    if (file_stat.st_size < QOI_ARCHIVE_HEADER_SIZE ||
+        (unsigned long long)file_stat.st_size > SIZE_MAX) {
+        fprintf(stderr, "Error: QOI archive '%s' has invalid size.\n", path);
+        close(fd);
+        return 1;
+    }
+    size_t file_size = (size_t)file_stat.st_size;
+
+    void *mapping = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        perror("Error mapping QOI archive");
+        return 1;
+    }
+    posix_madvise(mapping, file_size, POSIX_MADV_RANDOM);
+
+    if (qoi_archive_open_memory(archive, (const uint8_t *)mapping, file_size) != 0) {
+        munmap(mapping, file_size);
+        return 1;
+    }
+    archive->mapping = mapping;
+    archive->mapping_size = file_size;
+    return 0;
+#endif
+}
+
+void qoi_archive_close(QOIArchive *archive) {
+    if (!archive) {
+        return;
+    }
+    if (archive->mapping) {
+#if defined(_WIN32)
+        free(archive->mapping);
+#else
+        munmap(archive->mapping, archive->mapping_size);
+#endif
+    }
+    memset(archive, 0, sizeof(*archive));
+}
+
+// Fills entry from an occupied slot after checking that its name and payload
+// lie inside the archive.
+static int qoi_archive_slot_entry(const QOIArchive *archive, const uint8_t *slot, QOIArchiveEntry *entry) {
+    uint64_t offset = qoi_read_u64_be(slot + 8);
+    uint32_t size = qoi_read_u32_be(slot + 16);
+    uint32_t name_offset = qoi_read_u32_be(slot + 28);
+    uint64_t index_offset = (uint64_t)(archive->slots - archive->data);
+
+    if (offset > index_offset || size > index_offset - offset ||
+        name_offset > archive->names_size || archive->names_size - name_offset < 2) {
+        return 1;
+    }
+    const uint8_t *name = archive->names + name_offset;
+    size_t name_length = ((size_t)name[0] << 8) | name[1];
+    if (name_length > archive->names_size - name_offset - 2) {
+        return 1;
+    }
+
+    entry->name = (const char *)(name + 2);
+    entry->name_length = name_length;
+    entry->data = archive->data + offset;
+    entry->size = size;
+    entry->width = qoi_read_u32_be(slot + 20);
+    entry->height = qoi_read_u32_be(slot + 24);
+    return 0;
+}
+
+int qoi_archive_find(const QOIArchive *archive, const char *name, size_t name_length, QOIArchiveEntry *entry) {
+    if (!archive || !archive->slots || !name || !entry) {
+        return 1;
+    }
+
+    uint64_t hash = qoi_archive_hash(name, name_length);
+    uint32_t mask = archive->bucket_count - 1;
+    uint32_t bucket = (uint32_t)hash & mask;
+    for (uint32_t probe = 0; probe < archive->bucket_count; probe++, bucket = (bucket + 1) & mask) {
+        const uint8_t *slot = archive->slots + (size_t)bucket * QOI_ARCHIVE_SLOT_SIZE;
+        if (qoi_read_u32_be(slot + 16) == 0) {
+            return 1;
+        }
+        if (qoi_read_u64_be(slot) == hash &&
+            qoi_archive_slot_entry(archive, slot, entry) == 0 &&
+            entry->name_length == name_length && memcmp(entry->name, name, name_length) == 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int qoi_archive_next(const QOIArchive *archive, uint32_t *cursor, QOIArchiveEntry *entry) {
+    if (!archive || !archive->slots || !cursor || !entry) {
+        return 1;
+    }
+    while (*cursor < archive->bucket_count) {
+        const uint8_t *slot = archive->slots + (size_t)(*cursor)++ * QOI_ARCHIVE_SLOT_SIZE;
+        if (qoi_read_u32_be(slot + 16) != 0 && qoi_archive_slot_entry(archive, slot, entry) == 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int qoi_archive_decode_into(const QOIArchive *archive,
+                            const char *name,
+                            void *pixels,
+                            size_t row_stride,
+                            size_t pixels_capacity,
+                            QOIPixelLayout layout,
+                            uint32_t *width,
+                            uint32_t *height,
+                            uint8_t *channels,
+                            uint8_t *colorspace) {
+    QOIArchiveEntry entry;
+    if (!name || qoi_archive_find(archive, name, strlen(name), &entry) != 0) {
+        return 1;
+    }
+    return qoi_decode_into(entry.data, entry.size, pixels, row_stride, pixels_capacity, layout,
+                           width, height, channels, colorspace);
+}
+
+// ---------------------------------------------------------------------------
+// Writer
+
+static int qoi_archive_write_padding(QOIArchiveWriter *writer, uint64_t target) {
+    static const uint8_t zeros[64] = {0};
+    while (writer->end < target) {
+        size_t count = target - writer->end < sizeof(zeros) ? (size_t)(target - writer->end) : sizeof(zeros);
+        if (fwrite(zeros, 1, count, writer->file) != count) {
+            return 1;
+        }
+        writer->end += count;
+    }
+    return 0;
+}
+
+static void qoi_archive_writer_release(QOIArchiveWriter *writer) {
+    for (size_t i = 0; i < writer->count; i++) {
+        free(writer->entries[i].name);
+    }
+    free(writer->entries);
+    writer->entries = NULL;
+    writer->count = writer->capacity = 0;
+}
+
+static int qoi_archive_writer_push(QOIArchiveWriter *writer, const char *name, size_t name_length,
+                                   uint64_t offset, uint32_t size, uint32_t width, uint32_t height) {
+    if (writer->count == writer->capacity) {
+        size_t new_capacity = writer->capacity ? writer->capacity * 2 : 256;
+        QOIArchiveWriterEntry *grown = (QOIArchiveWriterEntry *)realloc(writer->entries,
+                                                                         new_capacity * sizeof(*grown));
+        if (!grown) {
+            return 1;
+        }
+        writer->entries = grown;
+        writer->capacity = new_capacity;
+    }
+
+    char *name_copy = (char *)malloc(name_length + 1);
+    if (!name_copy) {
+        return 1;
+    }
+    memcpy(name_copy, name, name_length);
+    name_copy[name_length] = '\0';
+
+    QOIArchiveWriterEntry *entry = &writer->entries[writer->count++];
+    entry->name = name_copy;
+    entry->name_length = name_length;
+    entry->hash = qoi_archive_hash(name, name_length);
+    entry->offset = offset;
+    entry->size = size;
+    entry->width = width;
+    entry->height = height;
+    return 0;
+}
+
+int qoi_archive_writer_create(QOIArchiveWriter *writer, const char *path, uint32_t alignment) {
+    if (!writer || !path) {
+        return 1;
+    }
+    memset(writer, 0, sizeof(*writer));
+    if (alignment == 0) {
+        alignment = QOI_ARCHIVE_DEFAULT_ALIGNMENT;
+    }
+    if (!qoi_is_power_of_two(alignment)) {
+        fprintf(stderr, "Error: Archive alignment must be a power of two.\n");
+        return 1;
+    }
+
+    writer->file = fopen(path, "wb");
+    if (!writer->file) {
+        perror("Error creating QOI archive");
+        return 1;
+    }
+    writer->alignment = alignment;
+
+    // Placeholder header without an index; qoi_archive_writer_finish()
+    // overwrites it.
+    uint8_t header[QOI_ARCHIVE_HEADER_SIZE] = {'q', 'o', 'i', 'p'};
+    if (fwrite(header, 1, sizeof(header), writer->file) != sizeof(header)) {
+        perror("Error writing QOI archive");
+        fclose(writer->file);
+        writer->file = NULL;
+        return 1;
+    }
+    writer->end = sizeof(header);
+    return 0;
+}
+
+int qoi_archive_writer_append(QOIArchiveWriter *writer, const char *path) {
+    if (!writer || !path) {
+        return 1;
+    }
+    memset(writer, 0, sizeof(*writer));
+
+    // Load the existing entries through the reader so both sides apply the
+    // same checks.
+    QOIArchive archive;
+    if (qoi_archive_open(&archive, path) != 0) {
+        return 1;
+    }
+    writer->alignment = qoi_read_u32_be(archive.data + 8);
+    uint64_t file_size = archive.size;
+
+    int status = 0;
+    uint32_t cursor = 0;
+    QOIArchiveEntry entry;
+    while (status == 0 && qoi_archive_next(&archive, &cursor, &entry) == 0) {
+        status = qoi_archive_writer_push(writer, entry.name, entry.name_length,
+                                         (uint64_t)(entry.data - archive.data), (uint32_t)entry.size,
+                                         entry.width, entry.height);
+    }
+    qoi_archive_close(&archive);
+    if (status != 0) {
+        qoi_archive_writer_release(writer);
+        return 1;
+    }
+
+    // New payloads go after everything already in the file, including the old
+    // index, so the file stays valid until the new header is written.
+    writer->file = fopen(path, "r+b");
+    if (!writer->file || qoi_archive_seek(writer->file, file_size) != 0) {
+        perror("Error opening QOI archive for appending");
+        qoi_archive_writer_abort(writer);
+        return 1;
+    }
+    writer->end = file_size;
+    return 0;
+}
+
+int qoi_archive_writer_add(QOIArchiveWriter *writer, const char *name, const uint8_t *qoi_data, size_t qoi_size) {
+    if (!writer || !writer->file || !name || !qoi_data) {
+        return 1;
+    }
+    size_t name_length = strlen(name);
+    if (name_length == 0 || name_length > 0xFFFF) {
+        fprintf(stderr, "Error: Archive entry names must be 1 to 65535 bytes long.\n");
+        return 1;
+    }
+    if (qoi_size > UINT32_MAX) {
+        fprintf(stderr, "Error: '%s' is too large for a QOI archive entry.\n", name);
+        return 1;
+    }
+
+    QOIInfo info;
+    QOIStatus status = qoi_validate(qoi_data, qoi_size, &info, NULL);
+    if (status != QOI_OK) {
+        fprintf(stderr, "Error: '%s' is not a valid QOI file: %s.\n", name, qoi_status_string(status));
+        return 1;
+    }
+
+    uint64_t offset = qoi_archive_align(writer->end, writer->alignment);
+    if (qoi_archive_write_padding(writer, offset) != 0 ||
+        fwrite(qoi_data, 1, qoi_size, writer->file) != qoi_size) {
+        perror("Error writing QOI archive");
+        return 1;
+    }
+    writer->end += qoi_size;
+
+    return qoi_archive_writer_push(writer, name, name_length, offset, (uint32_t)qoi_size, info.width, info.height);
+}
+
+int qoi_archive_writer_add_image(QOIArchiveWriter *writer,
+                                 const char *name,
+                                 const QOIPixel *pixel_data,
+                                 uint32_t width,
+                                 uint32_t height,
+                                 uint8_t channels,
+                                 uint8_t colorspace) {
+    size_t capacity = qoi_encode_max_size(width, height, channels);
+    if (capacity == 0) {
+        return 1;
+    }
+    uint8_t *encoded = (uint8_t *)malloc(capacity);
+    if (!encoded) {
+        return 1;
+    }
+
+    size_t encoded_size = 0;
+    int status = qoi_encode_to_memory(pixel_data, width, height, channels, colorspace,
+                                      encoded, capacity, &encoded_size);
+    if (status == 0) {
+        status = qoi_archive_writer_add(writer, name, encoded, encoded_size);
+    }
+    free(encoded);
+    return status;
+}
+
+int qoi_archive_writer_finish(QOIArchiveWriter *writer) {
+    if (!writer || !writer->file) {
+        return 1;
+    }
+
+    uint32_t bucket_count = 1;
+    while (bucket_count < 2 * writer->count && bucket_count <= UINT32_MAX / 4) {
+        bucket_count *= 2;
+    }
+
+    // Place entries in insertion order so that a later entry with the same
+    // name replaces the earlier one.
+    int32_t *table = (int32_t *)malloc((size_t)bucket_count * sizeof(int32_t));
+    uint8_t *slots = (uint8_t *)calloc(bucket_count, QOI_ARCHIVE_SLOT_SIZE);
+    int status = (!table || !slots || writer->count > INT32_MAX || bucket_count < 2 * writer->count) ? 1 : 0;
+
+    uint32_t entry_count = 0;
+    uint64_t names_size = 0;
+    if (status == 0) {
+        uint32_t mask = bucket_count - 1;
+        for (uint32_t i = 0; i < bucket_count; i++) {
+            table[i] = -1;
+        }
+        for (size_t i = 0; i < writer->count; i++) {
+            const QOIArchiveWriterEntry *entry = &writer->entries[i];
+            uint32_t bucket = (uint32_t)entry->hash & mask;
+            while (table[bucket] >= 0) {
+                const QOIArchiveWriterEntry *other = &writer->entries[table[bucket]];
+                if (other->hash == entry->hash && other->name_length == entry->name_length &&
+                    memcmp(other->name, entry->name, entry->name_length) == 0) {
+                    break;
+                }
+                bucket = (bucket + 1) & mask;
+            }
+            if (table[bucket] < 0) {
+                entry_count++;
+                names_size += 2 + entry->name_length;
+            }
+            table[bucket] = (int32_t)i;
+        }
+        if (names_size > UINT32_MAX) {
+            fprintf(stderr, "Error: Archive entry names exceed 4 GiB.\n");
+            status = 1;
+        }
+    }
+
+    uint8_t *names = status == 0 ? (uint8_t *)malloc(names_size ? (size_t)names_size : 1) : NULL;
+    if (status == 0 && !names) {
+        status = 1;
+    }
+    if (status == 0) {
+        uint32_t name_offset = 0;
+        for (uint32_t bucket = 0; bucket < bucket_count; bucket++) {
+            if (table[bucket] < 0) {
+                continue;
+            }
+            const QOIArchiveWriterEntry *entry = &writer->entries[table[bucket]];
+            uint8_t *slot = slots + (size_t)bucket * QOI_ARCHIVE_SLOT_SIZE;
+            qoi_write_u64_be(slot, entry->hash);
+            qoi_write_u64_be(slot + 8, entry->offset);
+            qoi_write_u32_be(slot + 16, entry->size);
+            qoi_write_u32_be(slot + 20, entry->width);
+            qoi_write_u32_be(slot + 24, entry->height);
+            qoi_write_u32_be(slot + 28, name_offset);
+
+            names[name_offset] = (uint8_t)(entry->name_length >> 8);
+            names[name_offset + 1] = (uint8_t)entry->name_length;
+            memcpy(names + name_offset + 2, entry->name, entry->name_length);
+            name_offset += 2 + (uint32_t)entry->name_length;
+        }
+
+        uint64_t index_offset = qoi_archive_align(writer->end, writer->alignment);
+        uint8_t header[QOI_ARCHIVE_HEADER_SIZE] = {'q', 'o', 'i', 'p'};
+        qoi_write_u32_be(header + 4, QOI_ARCHIVE_VERSION);
+        qoi_write_u32_be(header + 8, writer->alignment);
+        qoi_write_u32_be(header + 12, entry_count);
+        qoi_write_u32_be(header + 16, bucket_count);
+        qoi_write_u32_be(header + 20, (uint32_t)names_size);
+        qoi_write_u64_be(header + 24, index_offset);
+
+        if (qoi_archive_write_padding(writer, index_offset) != 0 ||
+            fwrite(slots, QOI_ARCHIVE_SLOT_SIZE, bucket_count, writer->file) != bucket_count ||
+            fwrite(names, 1, (size_t)names_size, writer->file) != names_size ||
+            fflush(writer->file) != 0 ||
+            qoi_archive_seek(writer->file, 0) != 0 ||
+            fwrite(header, 1, sizeof(header), writer->file) != sizeof(header)) {
+            perror("Error writing QOI archive index");
+            status = 1;
+        }
+    }
+
+    free(names);
+    free(slots);
+    free(table);
+    qoi_archive_writer_release(writer);
+    if (fclose(writer->file) != 0) {
+        status = 1;
+    }
+    writer->file = NULL;
+    return status;
+}
+
+void qoi_archive_writer_abort(QOIArchiveWriter *writer) {
+    if (!writer) {
+        return;
+    }
+    qoi_archive_writer_release(writer);
+    if (writer->file) {
+        fclose(writer->file);
+        writer->file = NULL;
+    }
+}
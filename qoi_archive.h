@@ -0,0 +1,124 @@
+#ifndef QOI_ARCHIVE_H
+#define QOI_ARCHIVE_H
+
+#include "qoi_utils.h"
+
+// QOI archive ("QOI-PAK"): many complete QOI files packed into one file
+// with a hashed name index, so a large set of small images costs one open
+// and one mapping instead of a syscall round trip per image.
+//
+// Layout (all integers big-endian):
+//   header (QOI_ARCHIVE_HEADER_SIZE bytes): magic "qoip", version u32,
+//   alignment u32, entry_count u32, bucket_count u32, names_size u32,
+//   index_offset u64;
+//   payloads: unmodified QOI files, each starting at a multiple of alignment;
+//   index at index_offset: bucket_count slots of QOI_ARCHIVE_SLOT_SIZE bytes
+//   (name hash u64, payload offset u64, payload length u32, width u32,
+//   height u32, name offset u32), then names_size bytes of names, each a u16
+//   length followed by the bytes.
+//
+// The slots form an open-addressing table (linear probing, a power-of-two
+// bucket_count at most half full) keyed by the 64-bit FNV-1a hash of the
+// name; a slot with payload length 0 is empty. Appending writes new payloads
+// and a fresh index after the old end of file and rewrites the header last,
+// so an interrupted append leaves the previous contents readable.
+
+#define QOI_ARCHIVE_HEADER_SIZE 32
+#define QOI_ARCHIVE_SLOT_SIZE 32
+#define QOI_ARCHIVE_VERSION 1
+#define QOI_ARCHIVE_DEFAULT_ALIGNMENT 64
+
+typedef struct QOIArchive {
+    const uint8_t *data;
+    size_t size;
+    uint32_t entry_count;
+    uint32_t bucket_count;
+    const uint8_t *slots;
+    const uint8_t *names;
+    uint32_t names_size;
+    void *mapping;       // Non-NULL when opened from a path.
+    size_t mapping_size;
+} QOIArchive;
+
+typedef struct QOIArchiveEntry {
+    const char *name;    // Points into the archive; not NUL-terminated.
+    size_t name_length;
+    const uint8_t *data; // The complete QOI file.
+    size_t size;
+    uint32_t width, height;
+} QOIArchiveEntry;
+
+// Maps the archive at path read-only (reads it into memory where mmap is
+// unavailable). Lookups and decodes afterwards make no system calls.
+int qoi_archive_open(QOIArchive *archive, const char *path);
+
+// Uses a caller-owned buffer holding a whole archive; it must outlive archive.
+int qoi_archive_open_memory(QOIArchive *archive, const uint8_t *data, size_t size);
+
+void qoi_archive_close(QOIArchive *archive);
+
+// Looks name up in the index. Returns 0 and fills entry if found.
+int qoi_archive_find(const QOIArchive *archive, const char *name, size_t name_length, QOIArchiveEntry *entry);
+
+// Iterates every entry in index order: start with *cursor = 0 and call until
+// it returns non-zero.
+int qoi_archive_next(const QOIArchive *archive, uint32_t *cursor, QOIArchiveEntry *entry);
+
+// Looks name up and decodes it with qoi_decode_into().
+int qoi_archive_decode_into(const QOIArchive *archive,
+                            const char *name,
+                            void *pixels,
+                            size_t row_stride,
+                            size_t pixels_capacity,
+                            QOIPixelLayout layout,
+                            uint32_t *width,
+                            uint32_t *height,
+                            uint8_t *channels,
+                            uint8_t *colorspace);
+
+typedef struct QOIArchiveWriterEntry {
+    char *name;
+    size_t name_length;
+    uint64_t hash;
+    uint64_t offset;
+    uint32_t size;
+    uint32_t width, height;
+} QOIArchiveWriterEntry;
+
+typedef struct QOIArchiveWriter {
+    FILE *file;
+    uint32_t alignment;
+    uint64_t end;        // Where the next payload goes.
+    QOIArchiveWriterEntry *entries;
+    size_t count, capacity;
+} QOIArchiveWriter;
+
+// Starts a new archive at path. alignment 0 selects
+// QOI_ARCHIVE_DEFAULT_ALIGNMENT; otherwise it must be a power of two.
+int qoi_archive_writer_create(QOIArchiveWriter *writer, const char *path, uint32_t alignment);
+
+// Opens an existing archive for appending; its entries are kept, and an entry
+// added under an existing name replaces it.
+int qoi_archive_writer_append(QOIArchiveWriter *writer, const char *path);
+
+// Adds a complete QOI file (checked with qoi_validate()).
+int qoi_archive_writer_add(QOIArchiveWriter *writer, const char *name, const uint8_t *qoi_data, size_t qoi_size);
+
+// Encodes an RGBA image the way qoi_encode_to_file() does and adds it.
+int qoi_archive_writer_add_image(QOIArchiveWriter *writer,
+                                 const char *name,
+                                 const QOIPixel *pixel_data,
+                                 uint32_t width,
+                                 uint32_t height,
+                                 uint8_t channels,
+                                 uint8_t colorspace);
+
+// Writes the index and header and closes the file. The writer is released
+// whether or not this succeeds.
+int qoi_archive_writer_finish(QOIArchiveWriter *writer);
+
+// Closes the file without writing an index. A new archive is left unusable;
+// an archive opened for appending keeps its previous contents.
+void qoi_archive_writer_abort(QOIArchiveWriter *writer);
+
+#endif
@@ -0,0 +1,161 @@
+#include "qoi_archive.h"
+#include "qoi_internal.h"
+#include "qoi_test.h"
+
+// Round trip through create, append, find and decode, then open truncated
+// and corrupted copies of the archive from memory, which must either fail
+// or only ever hand back entries that lie inside the buffer.
+
+typedef struct TestImage {
+    const char *name;
+    uint32_t width, height;
+    uint8_t channels;
+    QOIPixel *pixels;
+} TestImage;
+
+static int decodes_to(const QOIArchive *archive, const TestImage *image) {
+    size_t size = (size_t)image->width * image->height * sizeof(QOIPixel);
+    QOIPixel *decoded = (QOIPixel *)malloc(size);
+    uint32_t width, height;
+    uint8_t channels, colorspace;
+    int match = decoded &&
+                qoi_archive_decode_into(archive, image->name, decoded, (size_t)image->width * sizeof(QOIPixel),
+                                        size, QOI_LAYOUT_RGBA, &width, &height, &channels, &colorspace) == 0 &&
+                width == image->width && height == image->height && channels == image->channels &&
+                memcmp(decoded, image->pixels, size) == 0;
+    free(decoded);
+    return match;
+}
+
+static int read_file(const char *path, uint8_t **data, size_t *size) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return 1;
+    }
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    *data = (uint8_t *)malloc(length > 0 ? (size_t)length : 1);
+    int status = length <= 0 || !*data || fread(*data, 1, (size_t)length, file) != (size_t)length;
+    fclose(file);
+    *size = (size_t)length;
+    return status;
+}
+
+// Opens data from memory; if that succeeds, walks and decodes every entry.
+// Returns the number of entries found.
+static uint32_t open_and_walk(const uint8_t *data, size_t size) {
+    QOIArchive archive;
+    if (qoi_archive_open_memory(&archive, data, size) != 0) {
+        return 0;
+    }
+    uint32_t found = 0;
+    uint32_t cursor = 0;
+    QOIArchiveEntry entry;
+    while (qoi_archive_next(&archive, &cursor, &entry) == 0) {
+        QOI_CHECK(entry.data >= data && entry.size <= size && (size_t)(entry.data - data) <= size - entry.size);
+        QOIInfo info;
+        if (qoi_read_info(entry.data, entry.size, &info) == QOI_OK &&
+            (uint64_t)info.width * info.height <= 1u << 20) {
+            uint32_t width, height;
+            uint8_t channels, colorspace;
+            QOIPixel *pixels = qoi_decode_from_memory(entry.data, entry.size, &width, &height, &channels, &colorspace);
+            free(pixels);
+        }
+        found++;
+    }
+    qoi_archive_close(&archive);
+    return found;
+}
+
+int main(int argc, char *argv[]) {
+    const char *path = argc > 1 ? argv[1] : "qoi_archive_test.qpak";
+    TestImage images[] = {
+        {"tiles/grass", 64, 64, 4, NULL},
+        {"tiles/water", 33, 17, 3, NULL},
+        {"ui/button", 120, 40, 4, NULL},
+        {"tiles/water", 48, 48, 4, NULL}, // Replaces the first tiles/water on append.
+    };
+    for (int i = 0; i < 4; i++) {
+        images[i].pixels = qoi_test_image(images[i].width, images[i].height, (uint32_t)i + 1, images[i].channels == 3);
+    }
+
+    // Create with the first two images.
+    QOIArchiveWriter writer;
+    QOI_CHECK(qoi_archive_writer_create(&writer, path, 0) == 0);
+    for (int i = 0; i < 2; i++) {
+        QOI_CHECK(qoi_archive_writer_add_image(&writer, images[i].name, images[i].pixels, images[i].width,
+                                               images[i].height, images[i].channels, 0) == 0);
+    }
+    QOI_CHECK(qoi_archive_writer_add(&writer, "bogus", (const uint8_t *)"not a qoi file", 14) != 0);
+    QOI_CHECK(qoi_archive_writer_finish(&writer) == 0);
+
+    QOIArchive archive;
+    QOI_CHECK(qoi_archive_open(&archive, path) == 0);
+    QOI_CHECK(archive.entry_count == 2);
+    QOI_CHECK(decodes_to(&archive, &images[0]));
+    QOI_CHECK(decodes_to(&archive, &images[1]));
+    QOIArchiveEntry entry;
+    QOI_CHECK(qoi_archive_find(&archive, "ui/button", 9, &entry) != 0);
+    QOI_CHECK(qoi_archive_find(&archive, "tiles/grass", 11, &entry) == 0 &&
+              entry.width == 64 && entry.height == 64 &&
+              (size_t)(entry.data - archive.data) % QOI_ARCHIVE_DEFAULT_ALIGNMENT == 0);
+    qoi_archive_close(&archive);
+
+    // Append a new name and one that replaces an existing entry.
+    QOI_CHECK(qoi_archive_writer_append(&writer, path) == 0);
+    for (int i = 2; i < 4; i++) {
+        QOI_CHECK(qoi_archive_writer_add_image(&writer, images[i].name, images[i].pixels, images[i].width,
+                                               images[i].height, images[i].channels, 0) == 0);
+    }
+    QOI_CHECK(qoi_archive_writer_finish(&writer) == 0);
+
+    QOI_CHECK(qoi_archive_open(&archive, path) == 0);
+    QOI_CHECK(archive.entry_count == 3);
+    QOI_CHECK(decodes_to(&archive, &images[0]));
+    QOI_CHECK(decodes_to(&archive, &images[2]));
+    QOI_CHECK(decodes_to(&archive, &images[3]));
+    uint32_t cursor = 0, listed = 0;
+    while (qoi_archive_next(&archive, &cursor, &entry) == 0) {
+        listed++;
+    }
+    QOI_CHECK(listed == 3);
+    qoi_archive_close(&archive);
+
+    // Truncated and corrupted copies from memory.
+    uint8_t *data = NULL;
+    size_t size = 0;
+    QOI_CHECK(read_file(path, &data, &size) == 0);
+    if (qoi_test_failures == 0) {
+        QOI_CHECK(open_and_walk(data, size) == 3);
+        for (size_t length = 0; length < size; length += 1 + length / 16) {
+            uint8_t *copy = (uint8_t *)malloc(length > 0 ? length : 1);
+            memcpy(copy, data, length);
+            QOI_CHECK(open_and_walk(copy, length) == 0); // The index is at the end.
+            free(copy);
+        }
+        uint32_t state = 12345;
+        uint8_t *copy = (uint8_t *)malloc(size);
+        uint64_t index_offset = qoi_read_u64_be(data + 24);
+        for (int round = 0; round < 2000; round++) {
+            memcpy(copy, data, size);
+            for (int flips = 1 + round % 4; flips > 0; flips--) {
+                // Mostly the header and index, which the reader has to distrust.
+                uint32_t r = qoi_test_random(&state);
+                size_t at = r % 4 == 0 ? (r >> 2) % size
+                          : r % 4 == 1 ? (r >> 2) % QOI_ARCHIVE_HEADER_SIZE
+                          : (size_t)index_offset + (r >> 2) % (size - (size_t)index_offset);
+                copy[at] ^= (uint8_t)(1u << (qoi_test_random(&state) % 8));
+            }
+            open_and_walk(copy, size);
+        }
+        free(copy);
+    }
+    free(data);
+    remove(path);
+
+    for (int i = 0; i < 4; i++) {
+        free(images[i].pixels);
+    }
+    return qoi_test_report("qoi_archive_test");
+}
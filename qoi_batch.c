@@ -0,0 +1,825 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#if defined(_WIN32)
+#include <direct.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+#include "qoi_utils.h"
+#include "qoi_internal.h"
+
+// Batch PNG <-> QOI converter. Files move through three pipeline stages:
+// the main thread reads input files, a pool of conversion threads (each with
+// its own work deque, stealing from the others when idle) decodes and
+// re-encodes them in memory, and a writer thread stores the results. At most
+// queue_depth images are in flight at once, so memory stays bounded.
+
+#define DEFAULT_ITEMS_PER_THREAD 4
+
+typedef struct BatchItem {
+    char *input_path;
+    char *output_path;
+    uint8_t *data;          // Input file bytes, replaced by the converted output.
+    size_t size;
+    uint64_t pixels;
+    int failed;
+    struct BatchItem *next; // Writer queue link.
+} BatchItem;
+
+// Fixed-size ring of items. The owning thread pops from the back, idle
+// threads steal from the front.
+typedef struct WorkDeque {
+    BatchItem **items;
+    size_t capacity;
+    size_t head;
+    size_t count;
+    pthread_mutex_t lock;
+} WorkDeque;
+
+typedef struct StageStats {
+    double busy_seconds;
+    uint64_t items;
+    uint64_t bytes;
+    uint64_t pixels;
+    uint64_t steals;
+    uint64_t failures;
+} StageStats;
+
+typedef struct BatchPipeline {
+    int to_png;
+    unsigned worker_count;
+    WorkDeque *deques;
+    StageStats *worker_stats;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work_available;   // queued > 0 or reading finished
+    pthread_cond_t space_available;  // in_flight < queue_depth
+    pthread_cond_t output_available; // writer queue non-empty or conversion finished
+    size_t queue_depth;
+    size_t in_flight;
+    size_t queued;
+    int reading_done;
+    unsigned workers_running;
+
+    BatchItem *write_head;
+    BatchItem *write_tail;
+    StageStats writer_stats;
+} BatchPipeline;
+
+typedef struct WorkerArgs {
+    BatchPipeline *pipeline;
+    unsigned index;
+} WorkerArgs;
+
+typedef struct PathList {
+    char **inputs;
+    char **outputs;
+    size_t count;
+    size_t capacity;
+} PathList;
+
+static double now_seconds(void) {
+#if defined(_WIN32)
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+static unsigned online_cpu_count(void) {
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (unsigned)info.dwNumberOfProcessors : 1;
+#elif defined(_SC_NPROCESSORS_ONLN)
+    long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpu_count > 0 ? (unsigned)cpu_count : 1;
+#else
+    return 1;
+#endif
+}
+
+static char *copy_string(const char *text) {
+    char *copy = (char *)malloc(strlen(text) + 1);
+    if (copy) {
+        strcpy(copy, text);
+    }
+    return copy;
+}
+
+static int has_extension(const char *path, const char *extension) {
+    size_t length = strlen(path);
+    size_t extension_length = strlen(extension);
+    if (length < extension_length) {
+        return 0;
+    }
+    for (size_t i = 0; i < extension_length; i++) {
+        if (tolower((unsigned char)path[length - extension_length + i]) != extension[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Builds the output path for input: relative_path (the part of input below
+// the corpus root) placed under output_dir, or input itself when output_dir is
+// NULL, with the extension swapped for new_extension.
+static char *make_output_path(const char *input, const char *relative_path,
+                              const char *output_dir, const char *new_extension) {
+    const char *base = output_dir ? relative_path : input;
+    size_t base_length = strlen(base);
+    const char *dot = strrchr(base, '.');
+    const char *slash = strrchr(base, '/');
+    if (dot && (!slash || dot > slash)) {
+        base_length = (size_t)(dot - base);
+    }
+
+    size_t length = (output_dir ? strlen(output_dir) + 1 : 0) + base_length + strlen(new_extension) + 1;
+    char *path = (char *)malloc(length);
+    if (!path) {
+        return NULL;
+    }
+    if (output_dir) {
+        snprintf(path, length, "%s/%.*s%s", output_dir, (int)base_length, base, new_extension);
+    } else {
+        snprintf(path, length, "%.*s%s", (int)base_length, base, new_extension);
+    }
+    return path;
+}
+
+static int path_list_add(PathList *list, const char *input, const char *relative_path,
+                         const char *output_dir, const char *new_extension) {
+    if (list->count == list->capacity) {
+        size_t new_capacity = list->capacity ? list->capacity * 2 : 256;
+        char **grown_inputs = (char **)realloc(list->inputs, new_capacity * sizeof(char *));
+        if (!grown_inputs) {
+            return 1;
+        }
+        list->inputs = grown_inputs;
+        char **grown_outputs = (char **)realloc(list->outputs, new_capacity * sizeof(char *));
+        if (!grown_outputs) {
+            return 1;
+        }
+        list->outputs = grown_outputs;
+        list->capacity = new_capacity;
+    }
+
+    char *input_copy = copy_string(input);
+    char *output = make_output_path(input, relative_path, output_dir, new_extension);
+    if (!input_copy || !output) {
+        free(input_copy);
+        free(output);
+        return 1;
+    }
+    list->inputs[list->count] = input_copy;
+    list->outputs[list->count] = output;
+    list->count++;
+    return 0;
+}
+
+static void path_list_free(PathList *list) {
+    for (size_t i = 0; i < list->count; i++) {
+        free(list->inputs[i]);
+        free(list->outputs[i]);
+    }
+    free(list->inputs);
+    free(list->outputs);
+}
+
+static const char *path_basename(const char *path) {
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+// Adds path if it is a file, or every file with input_extension below it if
+// it is a directory. root_length is the length of the corpus root prefix that
+// is stripped to form the relative output path.
+static int collect_inputs(const char *path, size_t root_length, int explicit_file,
+                          const char *input_extension, const char *output_extension,
+                          const char *output_dir, PathList *list) {
+    struct stat path_info;
+    if (stat(path, &path_info) != 0) {
+        fprintf(stderr, "Error: Cannot access '%s'.\n", path);
+        return 1;
+    }
+
+    if (!S_ISDIR(path_info.st_mode)) {
+        if (explicit_file) {
+            return path_list_add(list, path, path_basename(path), output_dir, output_extension);
+        }
+        if (has_extension(path, input_extension)) {
+            return path_list_add(list, path, path + root_length, output_dir, output_extension);
+        }
+        return 0;
+    }
+
+    DIR *dir = opendir(path);
+    if (!dir) {
+        fprintf(stderr, "Error: Cannot open directory '%s'.\n", path);
+        return 1;
+    }
+
+    int status = 0;
+    struct dirent *entry;
+    while (status == 0 && (entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        size_t child_length = strlen(path) + 1 + strlen(entry->d_name) + 1;
+        char *child = (char *)malloc(child_length);
+        if (!child) {
+            status = 1;
+            break;
+        }
+        snprintf(child, child_length, "%s/%s", path, entry->d_name);
+        status = collect_inputs(child, root_length, 0, input_extension, output_extension, output_dir, list);
+        free(child);
+    }
+    closedir(dir);
+    return status;
+}
+
+static int collect_list_file(const char *list_path, const char *output_extension,
+                             const char *output_dir, PathList *list) {
+    FILE *f = fopen(list_path, "r");
+    if (!f) {
+        fprintf(stderr, "Error: Cannot open file list '%s'.\n", list_path);
+        return 1;
+    }
+
+    int status = 0;
+    char line[4096];
+    while (status == 0 && fgets(line, sizeof(line), f)) {
+        size_t length = strlen(line);
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) {
+            line[--length] = '\0';
+        }
+        if (length > 0) {
+            status = path_list_add(list, line, path_basename(line), output_dir, output_extension);
+        }
+    }
+    fclose(f);
+    return status;
+}
+
+static int make_directory(const char *path) {
+#if defined(_WIN32)
+    return _mkdir(path);
+#else
+    return mkdir(path, 0777);
+#endif
+}
+
+// Creates every missing directory above path.
+static int make_parent_directories(const char *path) {
+    char *copy = copy_string(path);
+    if (!copy) {
+        return 1;
+    }
+    for (char *c = copy + 1; *c; c++) {
+        if (*c != '/') {
+            continue;
+        }
+        *c = '\0';
+        if (make_directory(copy) != 0 && errno != EEXIST) {
+            free(copy);
+            return 1;
+        }
+        *c = '/';
+    }
+    free(copy);
+    return 0;
+}
+
+static uint8_t *read_whole_file(const char *path, size_t *out_size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+    uint8_t *data = NULL;
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0) {
+        size = ftell(f);
+    }
+    if (size > 0 && fseek(f, 0, SEEK_SET) == 0) {
+        data = (uint8_t *)malloc((size_t)size);
+        if (data && fread(data, 1, (size_t)size, f) != (size_t)size) {
+            free(data);
+            data = NULL;
+        }
+    }
+    fclose(f);
+    *out_size = data ? (size_t)size : 0;
+    return data;
+}
+
+// The in-memory core of qoi_encode_to_file(); file I/O happens in the reader
+// and writer stages instead.
+static int convert_png_to_qoi(BatchItem *item) {
+    if (item->size > 0x7FFFFFFF) {
+        return 1;
+    }
+    int width, height, channels_in_file;
+    if (!stbi_info_from_memory(item->data, (int)item->size, &width, &height, &channels_in_file)) {
+        return 1;
+    }
+    int channels = (channels_in_file == 3) ? 3 : 4;
+    unsigned char *pixels = stbi_load_from_memory(item->data, (int)item->size, &width, &height,
+                                                  &channels_in_file, channels);
+    if (!pixels) {
+        return 1;
+    }
+
+    size_t capacity = qoi_encode_max_size(width, height, (uint8_t)channels);
+    uint8_t *encoded = capacity ? (uint8_t *)malloc(capacity) : NULL;
+    size_t encoded_size = 0;
+    int status = !encoded ||
+                 qoi_encode_from_layout(pixels, width, height, (size_t)width * channels,
+                                        channels == 3 ? QOI_LAYOUT_RGB : QOI_LAYOUT_RGBA,
+                                        (uint8_t)channels, 0, encoded, capacity, &encoded_size) != 0;
+    stbi_image_free(pixels);
+    if (status != 0) {
+        free(encoded);
+        return 1;
+    }
+
+    free(item->data);
+    item->data = encoded;
+    item->size = encoded_size;
+    item->pixels = (uint64_t)width * height;
+    return 0;
+}
+
+// The in-memory core of qoi_decode_from_file(), followed by PNG encoding.
+static int convert_qoi_to_png(BatchItem *item) {
+    QOIInfo info;
+    if (qoi_read_info(item->data, item->size, &info) != QOI_OK) {
+        return 1;
+    }
+    // Opaque images are written as RGB PNGs.
+    int channels = info.channels == 3 ? 3 : 4;
+    uint32_t width = info.width;
+    uint32_t height = info.height;
+    // stb takes the dimensions and row stride as int; the buffer size must fit size_t.
+    if (!qoi_pixel_count_fits(width, height, item->size - QOI_HEADER_SIZE) ||
+        width > (uint32_t)(INT_MAX / channels) || height > INT_MAX ||
+        (size_t)width * channels > SIZE_MAX / height) {
+        return 1;
+    }
+
+    size_t row_stride = (size_t)width * channels;
+    size_t pixels_size = row_stride * height;
+    unsigned char *pixels = (unsigned char *)malloc(pixels_size);
+    if (!pixels) {
+        return 1;
+    }
+    uint8_t header_channels, header_colorspace;
+    if (qoi_decode_into(item->data, item->size, pixels, row_stride, pixels_size,
+                        channels == 3 ? QOI_LAYOUT_RGB : QOI_LAYOUT_RGBA,
+                        &width, &height, &header_channels, &header_colorspace) != 0) {
+        free(pixels);
+        return 1;
+    }
+
+    int png_size = 0;
+    unsigned char *png = stbi_write_png_to_mem(pixels, (int)row_stride, (int)width, (int)height,
+                                               channels, &png_size);
+    free(pixels);
+    if (!png) {
+        return 1;
+    }
+
+    free(item->data);
+    item->data = png;
+    item->size = (size_t)png_size;
+    item->pixels = (uint64_t)width * height;
+    return 0;
+}
+
+static void batch_item_free(BatchItem *item) {
+    free(item->data);
+    free(item);
+}
+
+static int deque_init(WorkDeque *deque, size_t capacity) {
+    deque->items = (BatchItem **)malloc(capacity * sizeof(BatchItem *));
+    deque->capacity = capacity;
+    deque->head = 0;
+    deque->count = 0;
+    if (!deque->items) {
+        return 1;
+    }
+    if (pthread_mutex_init(&deque->lock, NULL) != 0) {
+        free(deque->items);
+        return 1;
+    }
+    return 0;
+}
+
+static void deque_destroy(WorkDeque *deque) {
+    pthread_mutex_destroy(&deque->lock);
+    free(deque->items);
+}
+
+// Never fails: every deque can hold queue_depth items, which bounds the
+// number of items in flight.
+static void deque_push_back(WorkDeque *deque, BatchItem *item) {
+    pthread_mutex_lock(&deque->lock);
+    deque->items[(deque->head + deque->count) % deque->capacity] = item;
+    deque->count++;
+    pthread_mutex_unlock(&deque->lock);
+}
+
+static BatchItem *deque_pop_back(WorkDeque *deque) {
+    BatchItem *item = NULL;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count > 0) {
+        deque->count--;
+        item = deque->items[(deque->head + deque->count) % deque->capacity];
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return item;
+}
+
+static BatchItem *deque_steal_front(WorkDeque *deque) {
+    BatchItem *item = NULL;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count > 0) {
+        item = deque->items[deque->head];
+        deque->head = (deque->head + 1) % deque->capacity;
+        deque->count--;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return item;
+}
+
+// Takes an item from the worker's own deque, or steals one from another
+// worker. Blocks while there is no work; returns NULL once reading has
+// finished and every deque is empty.
+static BatchItem *next_work_item(BatchPipeline *pipeline, unsigned index) {
+    StageStats *stats = &pipeline->worker_stats[index];
+
+    for (;;) {
+        BatchItem *item = deque_pop_back(&pipeline->deques[index]);
+        for (unsigned i = 1; !item && i < pipeline->worker_count; i++) {
+            item = deque_steal_front(&pipeline->deques[(index + i) % pipeline->worker_count]);
+            if (item) {
+                stats->steals++;
+            }
+        }
+
+        pthread_mutex_lock(&pipeline->lock);
+        if (item) {
+            pipeline->queued--;
+            pthread_mutex_unlock(&pipeline->lock);
+            return item;
+        }
+        while (pipeline->queued == 0 && !pipeline->reading_done) {
+            pthread_cond_wait(&pipeline->work_available, &pipeline->lock);
+        }
+        int finished = pipeline->queued == 0 && pipeline->reading_done;
+        pthread_mutex_unlock(&pipeline->lock);
+        if (finished) {
+            return NULL;
+        }
+    }
+}
+
+static void *conversion_worker(void *arg) {
+    WorkerArgs *args = (WorkerArgs *)arg;
+    BatchPipeline *pipeline = args->pipeline;
+    StageStats *stats = &pipeline->worker_stats[args->index];
+
+    BatchItem *item;
+    while ((item = next_work_item(pipeline, args->index)) != NULL) {
+        uint64_t input_bytes = item->size;
+        double start = now_seconds();
+        item->failed = pipeline->to_png ? convert_qoi_to_png(item) : convert_png_to_qoi(item);
+        stats->busy_seconds += now_seconds() - start;
+        stats->items++;
+        stats->bytes += input_bytes;
+        if (item->failed) {
+            stats->failures++;
+        } else {
+            stats->pixels += item->pixels;
+        }
+
+        pthread_mutex_lock(&pipeline->lock);
+        item->next = NULL;
+        if (pipeline->write_tail) {
+            pipeline->write_tail->next = item;
+        } else {
+            pipeline->write_head = item;
+        }
+        pipeline->write_tail = item;
+        pthread_cond_signal(&pipeline->output_available);
+        pthread_mutex_unlock(&pipeline->lock);
+    }
+
+    pthread_mutex_lock(&pipeline->lock);
+    if (--pipeline->workers_running == 0) {
+        pthread_cond_broadcast(&pipeline->output_available);
+    }
+    pthread_mutex_unlock(&pipeline->lock);
+    return NULL;
+}
+
+static void *writer_thread(void *arg) {
+    BatchPipeline *pipeline = (BatchPipeline *)arg;
+    StageStats *stats = &pipeline->writer_stats;
+
+    for (;;) {
+        pthread_mutex_lock(&pipeline->lock);
+        while (!pipeline->write_head && pipeline->workers_running > 0) {
+            pthread_cond_wait(&pipeline->output_available, &pipeline->lock);
+        }
+        BatchItem *item = pipeline->write_head;
+        if (item) {
+            pipeline->write_head = item->next;
+            if (!pipeline->write_head) {
+                pipeline->write_tail = NULL;
+            }
+        }
+        pthread_mutex_unlock(&pipeline->lock);
+        if (!item) {
+            break;
+        }
+
+        if (item->failed) {
+            fprintf(stderr, "Error: Could not convert '%s'.\n", item->input_path);
+        } else {
+            double start = now_seconds();
+            FILE *f = NULL;
+            if (make_parent_directories(item->output_path) == 0) {
+                f = fopen(item->output_path, "wb");
+            }
+            int write_failed = !f || fwrite(item->data, 1, item->size, f) != item->size;
+            if (f && fclose(f) != 0) {
+                write_failed = 1;
+            }
+            stats->busy_seconds += now_seconds() - start;
+            if (write_failed) {
+                fprintf(stderr, "Error: Could not write '%s'.\n", item->output_path);
+                stats->failures++;
+            } else {
+                stats->items++;
+                stats->bytes += item->size;
+            }
+        }
+        batch_item_free(item);
+
+        pthread_mutex_lock(&pipeline->lock);
+        pipeline->in_flight--;
+        pthread_cond_signal(&pipeline->space_available);
+        pthread_mutex_unlock(&pipeline->lock);
+    }
+    return NULL;
+}
+
+static void print_stage(const char *name, const StageStats *stats, unsigned threads, double wall_seconds) {
+    double busy = stats->busy_seconds > 0 ? stats->busy_seconds : 1e-9;
+    printf("%-8s %8llu files %10.1f MB  busy %7.2f s on %u thread%s  %8.1f MB/s busy  %8.1f MB/s wall",
+           name, (unsigned long long)stats->items, stats->bytes / 1000000.0,
+           stats->busy_seconds, threads, threads == 1 ? " " : "s",
+           stats->bytes / busy / 1000000.0,
+           wall_seconds > 0 ? stats->bytes / wall_seconds / 1000000.0 : 0.0);
+    if (stats->pixels > 0) {
+        printf("  %8.1f MP/s wall", wall_seconds > 0 ? stats->pixels / wall_seconds / 1000000.0 : 0.0);
+    }
+    printf("\n");
+}
+
+static void print_usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [options] <file | directory>...\n"
+            "Converts PNG files to QOI (or QOI to PNG with --to-png). Directories are searched\n"
+            "recursively for *.png (or *.qoi).\n"
+            "  -l <list>     also read input paths from a file, one per line\n"
+            "  -o <dir>      output directory (default: next to each input)\n"
+            "  -j <threads>  conversion threads (default: one per online CPU)\n"
+            "  -q <depth>    images in flight across the pipeline (default %d per thread)\n"
+            "  --to-png      convert QOI to PNG\n",
+            program, DEFAULT_ITEMS_PER_THREAD);
+}
+
+int main(int argc, char *argv[]) {
+    const char *output_dir = NULL;
+    const char *list_path = NULL;
+    unsigned thread_count = 0;
+    size_t queue_depth = 0;
+    int to_png = 0;
+
+    int first_input_arg = argc;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output_dir = argv[++i];
+        } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            list_path = argv[++i];
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            thread_count = (unsigned)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-q") == 0 && i + 1 < argc) {
+            queue_depth = (size_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--to-png") == 0) {
+            to_png = 1;
+        } else if (argv[i][0] == '-') {
+            print_usage(argv[0]);
+            return 1;
+        } else {
+            first_input_arg = i;
+            break;
+        }
+    }
+    if (first_input_arg == argc && !list_path) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    const char *input_extension = to_png ? ".qoi" : ".png";
+    const char *output_extension = to_png ? ".png" : ".qoi";
+    int exit_status = 0;
+
+    PathList paths = {NULL, NULL, 0, 0};
+    if (list_path && collect_list_file(list_path, output_extension, output_dir, &paths) != 0) {
+        exit_status = 1;
+    }
+    for (int arg = first_input_arg; arg < argc; arg++) {
+        // Children are named "root/name", so strip the root and its separator
+        // to get the path mirrored below the output directory.
+        size_t root_length = strlen(argv[arg]) + 1;
+        if (collect_inputs(argv[arg], root_length, 1, input_extension, output_extension, output_dir, &paths) != 0) {
+            exit_status = 1;
+        }
+    }
+    if (paths.count == 0) {
+        fprintf(stderr, "No input files found.\n");
+        path_list_free(&paths);
+        return 1;
+    }
+
+    if (thread_count == 0) {
+        thread_count = online_cpu_count();
+    }
+    if (queue_depth == 0) {
+        queue_depth = (size_t)thread_count * DEFAULT_ITEMS_PER_THREAD;
+    }
+    if (queue_depth < thread_count) {
+        queue_depth = thread_count;
+    }
+
+    BatchPipeline pipeline;
+    memset(&pipeline, 0, sizeof(pipeline));
+    pipeline.to_png = to_png;
+    pipeline.worker_count = thread_count;
+    pipeline.queue_depth = queue_depth;
+    pipeline.workers_running = thread_count;
+    pipeline.deques = (WorkDeque *)calloc(thread_count, sizeof(WorkDeque));
+    pipeline.worker_stats = (StageStats *)calloc(thread_count, sizeof(StageStats));
+    pthread_t *threads = (pthread_t *)malloc((thread_count + 1) * sizeof(pthread_t));
+    WorkerArgs *worker_args = (WorkerArgs *)malloc(thread_count * sizeof(WorkerArgs));
+    if (!pipeline.deques || !pipeline.worker_stats || !threads || !worker_args) {
+        fprintf(stderr, "Error: Could not allocate the thread pool.\n");
+        return 1;
+    }
+    for (unsigned i = 0; i < thread_count; i++) {
+        if (deque_init(&pipeline.deques[i], queue_depth) != 0) {
+            fprintf(stderr, "Error: Could not allocate the thread pool.\n");
+            return 1;
+        }
+    }
+    pthread_mutex_init(&pipeline.lock, NULL);
+    pthread_cond_init(&pipeline.work_available, NULL);
+    pthread_cond_init(&pipeline.space_available, NULL);
+    pthread_cond_init(&pipeline.output_available, NULL);
+
+    double start = now_seconds();
+    unsigned started = 0;
+    for (; started < thread_count; started++) {
+        worker_args[started].pipeline = &pipeline;
+        worker_args[started].index = started;
+        if (pthread_create(&threads[started], NULL, conversion_worker, &worker_args[started]) != 0) {
+            break;
+        }
+    }
+    int writer_started = started > 0 && pthread_create(&threads[thread_count], NULL, writer_thread, &pipeline) == 0;
+    if (!writer_started) {
+        fprintf(stderr, "Error: Could not start worker threads.\n");
+        return 1;
+    }
+    if (started < thread_count) {
+        // Deques of workers that failed to start are drained by stealing. No
+        // worker can exit before reading_done is set, so this is not racy.
+        pthread_mutex_lock(&pipeline.lock);
+        pipeline.workers_running = started;
+        pthread_mutex_unlock(&pipeline.lock);
+    }
+
+    // Reader stage: runs on the main thread.
+    StageStats reader_stats;
+    memset(&reader_stats, 0, sizeof(reader_stats));
+    for (size_t i = 0; i < paths.count; i++) {
+        pthread_mutex_lock(&pipeline.lock);
+        while (pipeline.in_flight >= pipeline.queue_depth) {
+            pthread_cond_wait(&pipeline.space_available, &pipeline.lock);
+        }
+        pipeline.in_flight++;
+        pthread_mutex_unlock(&pipeline.lock);
+
+        double read_start = now_seconds();
+        BatchItem *item = (BatchItem *)calloc(1, sizeof(BatchItem));
+        if (item) {
+            item->input_path = paths.inputs[i];
+            item->output_path = paths.outputs[i];
+            item->data = read_whole_file(item->input_path, &item->size);
+        }
+        reader_stats.busy_seconds += now_seconds() - read_start;
+
+        if (!item || !item->data) {
+            fprintf(stderr, "Error: Could not read '%s'.\n", paths.inputs[i]);
+            reader_stats.failures++;
+            free(item);
+            pthread_mutex_lock(&pipeline.lock);
+            pipeline.in_flight--;
+            pthread_mutex_unlock(&pipeline.lock);
+            continue;
+        }
+        reader_stats.items++;
+        reader_stats.bytes += item->size;
+
+        deque_push_back(&pipeline.deques[i % thread_count], item);
+        pthread_mutex_lock(&pipeline.lock);
+        pipeline.queued++;
+        pthread_cond_signal(&pipeline.work_available);
+        pthread_mutex_unlock(&pipeline.lock);
+    }
+
+    pthread_mutex_lock(&pipeline.lock);
+    pipeline.reading_done = 1;
+    pthread_cond_broadcast(&pipeline.work_available);
+    pthread_mutex_unlock(&pipeline.lock);
+
+    for (unsigned i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_join(threads[thread_count], NULL);
+    double wall_seconds = now_seconds() - start;
+
+    StageStats convert_stats;
+    memset(&convert_stats, 0, sizeof(convert_stats));
+    for (unsigned i = 0; i < thread_count; i++) {
+        convert_stats.busy_seconds += pipeline.worker_stats[i].busy_seconds;
+        convert_stats.items += pipeline.worker_stats[i].items;
+        convert_stats.bytes += pipeline.worker_stats[i].bytes;
+        convert_stats.pixels += pipeline.worker_stats[i].pixels;
+        convert_stats.steals += pipeline.worker_stats[i].steals;
+        convert_stats.failures += pipeline.worker_stats[i].failures;
+        deque_destroy(&pipeline.deques[i]);
+    }
+
+    printf("%s: %zu inputs in %.2f s\n", to_png ? "QOI -> PNG" : "PNG -> QOI", paths.count, wall_seconds);
+    print_stage("read", &reader_stats, 1, wall_seconds);
+    print_stage("convert", &convert_stats, started, wall_seconds);
+    print_stage("write", &pipeline.writer_stats, 1, wall_seconds);
+    printf("steals: %llu  failures: read %llu, convert %llu, write %llu\n",
+           (unsigned long long)convert_stats.steals, (unsigned long long)reader_stats.failures,
+           (unsigned long long)convert_stats.failures, (unsigned long long)pipeline.writer_stats.failures);
+
+    if (reader_stats.failures || convert_stats.failures || pipeline.writer_stats.failures) {
+        exit_status = 1;
+    }
+
+    pthread_cond_destroy(&pipeline.output_available);
+    pthread_cond_destroy(&pipeline.space_available);
+    pthread_cond_destroy(&pipeline.work_available);
+    pthread_mutex_destroy(&pipeline.lock);
+    free(pipeline.deques);
+    free(pipeline.worker_stats);
+    free(threads);
+    free(worker_args);
+    path_list_free(&paths);
+    return exit_status;
+}
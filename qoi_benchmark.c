@@ -1,160 +1,649 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include <ctype.h>
+#include <dirent.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <time.h>
 
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
 
 #include "qoi_utils.h"
+#if defined(QOI_ENABLE_STATS)
+#include "qoi_stats.h"
+#endif
 
-long get_file_size(const char *filename) {
-    FILE *f = fopen(filename, "rb");
-    if (!f) {
-        perror("Error opening file for size check");
-        return -1;
+#define DEFAULT_ITERATIONS 10
+#define DEFAULT_WARMUP_ITERATIONS 2
+
+typedef enum OutputFormat {
+    OUTPUT_TEXT,
+    OUTPUT_CSV,
+    OUTPUT_JSON
+} OutputFormat;
+
+typedef struct BenchOptions {
+    int iterations;
+    int warmup_iterations;
+    int run_png;
+    OutputFormat format;
+} BenchOptions;
+
+// Median and 95th-percentile wall-clock time of one operation, in seconds.
+typedef struct TimingStats {
+    double median;
+    double p95;
+} TimingStats;
+
+typedef struct ImageResult {
+    const char *path;
+    int width, height, channels;
+    size_t png_file_size;
+    size_t qoi_size;
+    size_t png_encoded_size;
+    TimingStats qoi_encode, qoi_decode;
+    TimingStats png_encode, png_decode;
+    int round_trip_ok;
+#if defined(QOI_ENABLE_STATS)
+    QOIStats stats;  // From one extra, untimed encode/decode pass.
+#endif
+} ImageResult;
+
+// Per-corpus sums; throughput is total pixels over the summed median times.
+typedef struct CorpusTotals {
+    int image_count;
+    int failed_count;
+    double pixels;
+    double qoi_bytes, png_file_bytes, png_encoded_bytes;
+    double qoi_encode_seconds, qoi_decode_seconds;
+    double png_encode_seconds, png_decode_seconds;
+#if defined(QOI_ENABLE_STATS)
+    QOIStats stats;
+#endif
+} CorpusTotals;
+
+typedef struct FileList {
+    char **paths;
+    size_t count;
+    size_t capacity;
+} FileList;
+
+static double now_seconds(void) {
+#if defined(_WIN32)
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static TimingStats summarize_times(double *times, int count) {
+    TimingStats stats;
+    qsort(times, (size_t)count, sizeof(double), compare_doubles);
+    if (count % 2 == 1) {
+        stats.median = times[count / 2];
+    } else {
+        stats.median = 0.5 * (times[count / 2 - 1] + times[count / 2]);
     }
-    fseek(f, 0, SEEK_END);
-    long size = ftell(f);
-    fclose(f);
-    return size;
+    int p95_index = (count * 95 + 99) / 100 - 1;
+    stats.p95 = times[p95_index < 0 ? 0 : p95_index];
+    return stats;
 }
 
-int main(int argc, char *argv[]) {
-    if (argc < 3 || argc > 4) {
-        fprintf(stderr, "Usage: %s <input.png> <output.qoi> [decoded_output.png]\n", argv[0]);
+static double megapixels_per_second(double pixels, double seconds) {
+    return seconds > 0 ? pixels / seconds / 1000000.0 : 0.0;
+}
+
+static int has_png_extension(const char *path) {
+    size_t length = strlen(path);
+    if (length < 4) {
+        return 0;
+    }
+    const char *extension = path + length - 4;
+    return extension[0] == '.' &&
+           tolower((unsigned char)extension[1]) == 'p' &&
+           tolower((unsigned char)extension[2]) == 'n' &&
+           tolower((unsigned char)extension[3]) == 'g';
+}
+
+static int file_list_add(FileList *list, const char *path) {
+    if (list->count == list->capacity) {
+        size_t new_capacity = list->capacity ? list->capacity * 2 : 64;
+        char **grown = (char **)realloc(list->paths, new_capacity * sizeof(char *));
+        if (!grown) {
+            return 1;
+        }
+        list->paths = grown;
+        list->capacity = new_capacity;
+    }
+    char *copy = (char *)malloc(strlen(path) + 1);
+    if (!copy) {
         return 1;
     }
+    strcpy(copy, path);
+    list->paths[list->count++] = copy;
+    return 0;
+}
 
-    const char *input_png_filename = argv[1];
-    const char *output_qoi_filename = argv[2];
-    const char *decoded_png_filename = (argc == 4) ? argv[3] : NULL;
+static void file_list_free(FileList *list) {
+    for (size_t i = 0; i < list->count; i++) {
+        free(list->paths[i]);
+    }
+    free(list->paths);
+    list->paths = NULL;
+    list->count = list->capacity = 0;
+}
 
-    int width, height, channels_in_file;
-    unsigned char *stb_pixel_data = stbi_load(input_png_filename, &width, &height, &channels_in_file, 4);
+static int compare_paths(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
 
-    if (!stb_pixel_data) {
-        fprintf(stderr, "Error loading PNG '%s': %s\n", input_png_filename, stbi_failure_reason());
+// Adds path if it is a file, or every *.png below it if it is a directory.
+static int collect_files(const char *path, int explicit_file, FileList *list) {
+    struct stat path_info;
+    if (stat(path, &path_info) != 0) {
+        fprintf(stderr, "Error: Cannot access '%s'.\n", path);
         return 1;
     }
-    printf("Loaded PNG '%s': %d x %d, Original Channels: %d (loaded as RGBA)\n",
-           input_png_filename, width, height, channels_in_file);
 
-    QOIPixel *image_pixels = (QOIPixel *)stb_pixel_data;
+    if (!S_ISDIR(path_info.st_mode)) {
+        if (explicit_file || has_png_extension(path)) {
+            return file_list_add(list, path);
+        }
+        return 0;
+    }
 
-    printf("\nEncoding to QOI '%s'...\n", output_qoi_filename);
-    FILE *qoi_outfile = fopen(output_qoi_filename, "wb");
-    if (!qoi_outfile) {
-        perror("Error opening QOI output file");
-        stbi_image_free(stb_pixel_data);
+    DIR *dir = opendir(path);
+    if (!dir) {
+        fprintf(stderr, "Error: Cannot open directory '%s'.\n", path);
         return 1;
     }
 
-    uint8_t qoi_header_channels_for_file = (channels_in_file == 3) ? 3 : 4;
-    uint8_t qoi_colorspace = 0;
+    int status = 0;
+    struct dirent *entry;
+    while (status == 0 && (entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        size_t child_length = strlen(path) + 1 + strlen(entry->d_name) + 1;
+        char *child = (char *)malloc(child_length);
+        if (!child) {
+            status = 1;
+            break;
+        }
+        snprintf(child, child_length, "%s/%s", path, entry->d_name);
+        status = collect_files(child, 0, list);
+        free(child);
+    }
+    closedir(dir);
+    return status;
+}
 
-    clock_t start_time = clock();
-    int encode_status = qoi_encode_to_file(image_pixels, width, height, qoi_header_channels_for_file, qoi_colorspace, qoi_outfile);
-    clock_t end_time = clock();
-    double encode_time_seconds = ((double)(end_time - start_time)) / CLOCKS_PER_SEC;
+static unsigned char *read_whole_file(const char *path, size_t *out_size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+    unsigned char *data = NULL;
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0) {
+        size = ftell(f);
+    }
+    if (size > 0 && fseek(f, 0, SEEK_SET) == 0) {
+        data = (unsigned char *)malloc((size_t)size);
+        if (data && fread(data, 1, (size_t)size, f) != (size_t)size) {
+            free(data);
+            data = NULL;
+        }
+    }
+    fclose(f);
+    *out_size = data ? (size_t)size : 0;
+    return data;
+}
 
-    fclose(qoi_outfile);
+// Loads one image and times every codec on it. Returns 0 if the image could
+// be loaded and measured; result->round_trip_ok reports correctness.
+static int benchmark_image(const char *path, const BenchOptions *options, ImageResult *result) {
+    memset(result, 0, sizeof(*result));
+    result->path = path;
 
-    if (encode_status != 0) {
-        fprintf(stderr, "QOI encoding failed.\n");
-        stbi_image_free(stb_pixel_data);
-        remove(output_qoi_filename);
+    size_t png_size = 0;
+    unsigned char *png_data = read_whole_file(path, &png_size);
+    if (!png_data || png_size > (size_t)0x7FFFFFFF) {
+        fprintf(stderr, "Error: Could not read '%s'.\n", path);
+        free(png_data);
         return 1;
     }
-    printf("Encoding successful. Time: %.4f seconds\n", encode_time_seconds);
 
-    printf("\nDecoding from QOI '%s'...\n", output_qoi_filename);
-    FILE *qoi_infile = fopen(output_qoi_filename, "rb");
-    if (!qoi_infile) {
-        perror("Error opening QOI input file for decoding");
-        stbi_image_free(stb_pixel_data);
+    int width, height, channels_in_file;
+    if (!stbi_info_from_memory(png_data, (int)png_size, &width, &height, &channels_in_file)) {
+        fprintf(stderr, "Error loading PNG '%s': %s\n", path, stbi_failure_reason());
+        free(png_data);
         return 1;
     }
 
-    uint32_t decoded_width, decoded_height;
-    uint8_t decoded_channels_header, decoded_colorspace_header;
+    // Opaque PNGs are benchmarked as packed RGB, everything else as RGBA.
+    int load_channels = (channels_in_file == 3) ? 3 : 4;
+    QOIPixelLayout pixel_layout = (load_channels == 3) ? QOI_LAYOUT_RGB : QOI_LAYOUT_RGBA;
+    unsigned char *pixels = stbi_load_from_memory(png_data, (int)png_size, &width, &height,
+                                                  &channels_in_file, load_channels);
+    if (!pixels) {
+        fprintf(stderr, "Error loading PNG '%s': %s\n", path, stbi_failure_reason());
+        free(png_data);
+        return 1;
+    }
 
-    start_time = clock();
-    QOIPixel *decoded_image_pixels = qoi_decode_from_file(qoi_infile, &decoded_width, &decoded_height, &decoded_channels_header, &decoded_colorspace_header);
-    end_time = clock();
-    double decode_time_seconds = ((double)(end_time - start_time)) / CLOCKS_PER_SEC;
+    result->width = width;
+    result->height = height;
+    result->channels = load_channels;
+    result->png_file_size = png_size;
 
-    fclose(qoi_infile);
+    size_t row_stride = (size_t)width * load_channels;
+    size_t image_size = row_stride * height;
+    size_t qoi_capacity = qoi_encode_max_size(width, height, (uint8_t)load_channels);
+    uint8_t *qoi_buffer = qoi_capacity ? (uint8_t *)malloc(qoi_capacity) : NULL;
+    unsigned char *decoded = (unsigned char *)malloc(image_size);
+    int total_runs = options->warmup_iterations + options->iterations;
+    double *times = (double *)malloc((size_t)options->iterations * sizeof(double));
+    int status = 0;
 
-    if (!decoded_image_pixels) {
-        fprintf(stderr, "QOI decoding failed.\n");
-        stbi_image_free(stb_pixel_data);
-        return 1;
+    if (!qoi_buffer || !decoded || !times) {
+        fprintf(stderr, "Error: Could not allocate benchmark buffers for '%s'.\n", path);
+        status = 1;
     }
-    printf("Decoding successful. Time: %.4f seconds\n", decode_time_seconds);
-    printf("Decoded QOI: %u x %u, Channels in header: %u, Colorspace in header: %u\n",
-           decoded_width, decoded_height, decoded_channels_header, decoded_colorspace_header);
 
-    if (decoded_width != (uint32_t)width || decoded_height != (uint32_t)height) {
-        fprintf(stderr, "Error: Decoded dimensions (%ux%u) do not match original (%dx%d)!\n",
-                decoded_width, decoded_height, width, height);
-    } else {
-        printf("Dimensions match original.\n");
+    for (int i = 0; status == 0 && i < total_runs; i++) {
+        double start = now_seconds();
+        if (qoi_encode_from_layout(pixels, width, height, row_stride, pixel_layout, (uint8_t)load_channels, 0,
+                                   qoi_buffer, qoi_capacity, &result->qoi_size) != 0) {
+            fprintf(stderr, "Error: QOI encoding of '%s' failed.\n", path);
+            status = 1;
+        }
+        if (i >= options->warmup_iterations) {
+            times[i - options->warmup_iterations] = now_seconds() - start;
+        }
+    }
+    if (status == 0) {
+        result->qoi_encode = summarize_times(times, options->iterations);
     }
 
-    if (decoded_png_filename) {
-        printf("Saving decoded image to '%s'...\n", decoded_png_filename);
-        int write_status = stbi_write_png(decoded_png_filename, decoded_width, decoded_height, 4,
-                                          (const void*)decoded_image_pixels, decoded_width * sizeof(QOIPixel));
-        if (write_status == 0) {
-            fprintf(stderr, "Error writing decoded PNG to '%s'.\n", decoded_png_filename);
-        } else {
-            printf("Decoded image saved successfully.\n");
+    int decode_ok = status == 0;
+    for (int i = 0; status == 0 && i < total_runs; i++) {
+        uint32_t decoded_width, decoded_height;
+        uint8_t decoded_channels, decoded_colorspace;
+        double start = now_seconds();
+        if (qoi_decode_into(qoi_buffer, result->qoi_size, decoded, row_stride, image_size, pixel_layout,
+                            &decoded_width, &decoded_height, &decoded_channels, &decoded_colorspace) != 0 ||
+            decoded_width != (uint32_t)width || decoded_height != (uint32_t)height) {
+            fprintf(stderr, "Error: QOI decoding of '%s' failed.\n", path);
+            decode_ok = 0;
+            break;
         }
+        if (i >= options->warmup_iterations) {
+            times[i - options->warmup_iterations] = now_seconds() - start;
+        }
+    }
+    if (decode_ok) {
+        result->qoi_decode = summarize_times(times, options->iterations);
+        result->round_trip_ok = memcmp(decoded, pixels, image_size) == 0;
     }
 
-    printf("\n--- Benchmark Statistics ---\n");
-    long input_png_size = get_file_size(input_png_filename);
-    long output_qoi_size = get_file_size(output_qoi_filename);
+#if defined(QOI_ENABLE_STATS)
+    // Counting slows the codec down, so the statistics come from a separate
+    // pass rather than from the timed iterations.
+    if (decode_ok) {
+        uint32_t decoded_width, decoded_height;
+        uint8_t decoded_channels, decoded_colorspace;
+        qoi_stats_attach(&result->stats);
+        qoi_encode_from_layout(pixels, width, height, row_stride, pixel_layout, (uint8_t)load_channels, 0,
+                               qoi_buffer, qoi_capacity, &result->qoi_size);
+        qoi_decode_into(qoi_buffer, result->qoi_size, decoded, row_stride, image_size, pixel_layout,
+                        &decoded_width, &decoded_height, &decoded_channels, &decoded_colorspace);
+        qoi_stats_attach(NULL);
+    }
+#endif
 
-    long raw_rgba_size = (long)width * height * 4;
+    if (status == 0 && options->run_png) {
+        for (int i = 0; i < total_runs; i++) {
+            int encoded_length = 0;
+            double start = now_seconds();
+            unsigned char *encoded = stbi_write_png_to_mem(pixels, (int)row_stride, width, height,
+                                                           load_channels, &encoded_length);
+            double elapsed = now_seconds() - start;
+            free(encoded);
+            if (i >= options->warmup_iterations) {
+                times[i - options->warmup_iterations] = elapsed;
+            }
+            result->png_encoded_size = encoded ? (size_t)encoded_length : 0;
+        }
+        result->png_encode = summarize_times(times, options->iterations);
 
-    printf("Raw RGBA (uncompressed) size: %ld bytes\n", raw_rgba_size);
+        for (int i = 0; i < total_runs; i++) {
+            int w, h, c;
+            double start = now_seconds();
+            unsigned char *png_pixels = stbi_load_from_memory(png_data, (int)png_size, &w, &h, &c, load_channels);
+            double elapsed = now_seconds() - start;
+            stbi_image_free(png_pixels);
+            if (i >= options->warmup_iterations) {
+                times[i - options->warmup_iterations] = elapsed;
+            }
+        }
+        result->png_decode = summarize_times(times, options->iterations);
+    }
 
-    if (output_qoi_size > 0) {
-        double compression_ratio_vs_raw = (double)raw_rgba_size / output_qoi_size;
-        printf("Output QOI size: %ld bytes\n", output_qoi_size);
-        printf("Compression ratio (Raw_RGBA_size / QOI_size): %.2f : 1\n", compression_ratio_vs_raw);
+    free(times);
+    free(decoded);
+    free(qoi_buffer);
+    stbi_image_free(pixels);
+    free(png_data);
+    return status;
+}
 
-        if (input_png_size > 0) {
-            double compression_ratio_vs_png = (double)input_png_size / output_qoi_size;
-            printf("Input PNG size: %ld bytes\n", input_png_size);
-            printf("Compression ratio (PNG_size / QOI_size): %.2f : 1\n", compression_ratio_vs_png);
+static void corpus_add(CorpusTotals *totals, const ImageResult *result) {
+    totals->image_count++;
+    if (!result->round_trip_ok) {
+        totals->failed_count++;
+    }
+    totals->pixels += (double)result->width * result->height;
+    totals->qoi_bytes += (double)result->qoi_size;
+    totals->png_file_bytes += (double)result->png_file_size;
+    totals->png_encoded_bytes += (double)result->png_encoded_size;
+    totals->qoi_encode_seconds += result->qoi_encode.median;
+    totals->qoi_decode_seconds += result->qoi_decode.median;
+    totals->png_encode_seconds += result->png_encode.median;
+    totals->png_decode_seconds += result->png_decode.median;
+#if defined(QOI_ENABLE_STATS)
+    qoi_stats_accumulate(&totals->stats, &result->stats);
+#endif
+}
+
+static void print_json_string(const char *text) {
+    putchar('"');
+    for (const unsigned char *c = (const unsigned char *)text; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            printf("\\%c", *c);
+        } else if (*c < 0x20) {
+            printf("\\u%04x", *c);
         } else {
-            printf("Could not get input PNG file size for PNG ratio calculation.\n");
+            putchar(*c);
         }
+    }
+    putchar('"');
+}
 
-        double Bpp_qoi = (double)(output_qoi_size * 8) / (width * height);
-        printf("QOI Bits per pixel (Bpp): %.2f\n", Bpp_qoi);
-        printf("Raw RGBA Bits per pixel (Bpp): %.2f\n", (double)(raw_rgba_size * 8) / (width*height) );
-    } else {
-        printf("Could not get QOI file size for ratio calculations.\n");
-        if (input_png_size <=0) printf("Could not get input PNG file size either.\n");
+#if defined(QOI_ENABLE_STATS)
+static void print_json_codec_stats(const QOICodecStats *stats) {
+    static const char *const opcode_names[QOI_STATS_OP_COUNT] = {
+        "index", "diff", "luma", "rgb", "rgba", "run"
+    };
+    static const char *const phase_names[QOI_STATS_PHASE_COUNT] = {
+        "header", "pixels", "convert", "trailer"
+    };
+
+    printf("{\"opcodes\": {");
+    for (int op = 0; op < QOI_STATS_OP_COUNT; op++) {
+        printf("%s\"%s\": {\"count\": %llu, \"bytes\": %llu}", op ? ", " : "", opcode_names[op],
+               (unsigned long long)stats->opcode_count[op], (unsigned long long)stats->opcode_bytes[op]);
+    }
+    // Element n - 1 counts runs of length n.
+    printf("},\n                   \"run_histogram\": [");
+    for (int length = 1; length <= QOI_MAX_RUN_LENGTH; length++) {
+        printf("%s%llu", length > 1 ? ", " : "", (unsigned long long)stats->run_histogram[length]);
     }
+    printf("],\n                   \"index_lookups\": %llu, \"index_hits\": %llu, \"index_collisions\": %llu,",
+           (unsigned long long)stats->index_lookups, (unsigned long long)stats->index_hits,
+           (unsigned long long)stats->index_collisions);
+    printf("\n                   \"phase_seconds\": {");
+    for (int phase = 0; phase < QOI_STATS_PHASE_COUNT; phase++) {
+        printf("%s\"%s\": %.6f", phase ? ", " : "", phase_names[phase], stats->phase_seconds[phase]);
+    }
+    printf("}}");
+}
+#endif
 
-    uint64_t total_pixels = (uint64_t)width * height;
-    if (encode_time_seconds > 0) {
-        printf("Encoding speed: %.2f Megapixels/sec\n", (total_pixels / encode_time_seconds) / 1000000.0);
+static void print_csv_string(const char *text) {
+    putchar('"');
+    for (const char *c = text; *c; c++) {
+        if (*c == '"') {
+            putchar('"');
+        }
+        putchar(*c);
     }
-    if (decode_time_seconds > 0) {
-        printf("Decoding speed: %.2f Megapixels/sec\n", (total_pixels / decode_time_seconds) / 1000000.0);
+    putchar('"');
+}
+
+static void print_csv_header(void) {
+    printf("corpus,file,width,height,channels,"
+           "qoi_encode_mps_median,qoi_encode_mps_p95,qoi_decode_mps_median,qoi_decode_mps_p95,"
+           "qoi_bytes,qoi_bytes_per_pixel,"
+           "png_encode_mps_median,png_encode_mps_p95,png_decode_mps_median,png_decode_mps_p95,"
+           "png_file_bytes,png_file_bytes_per_pixel,round_trip\n");
+}
+
+static void print_image_result(const char *corpus, const ImageResult *r, const BenchOptions *options, int first) {
+    double pixels = (double)r->width * r->height;
+
+    switch (options->format) {
+    case OUTPUT_CSV:
+        print_csv_string(corpus);
+        putchar(',');
+        print_csv_string(r->path);
+        printf(",%d,%d,%d,%.2f,%.2f,%.2f,%.2f,%zu,%.4f,%.2f,%.2f,%.2f,%.2f,%zu,%.4f,%s\n",
+               r->width, r->height, r->channels,
+               megapixels_per_second(pixels, r->qoi_encode.median), megapixels_per_second(pixels, r->qoi_encode.p95),
+               megapixels_per_second(pixels, r->qoi_decode.median), megapixels_per_second(pixels, r->qoi_decode.p95),
+               r->qoi_size, r->qoi_size / pixels,
+               megapixels_per_second(pixels, r->png_encode.median), megapixels_per_second(pixels, r->png_encode.p95),
+               megapixels_per_second(pixels, r->png_decode.median), megapixels_per_second(pixels, r->png_decode.p95),
+               r->png_file_size, r->png_file_size / pixels,
+               r->round_trip_ok ? "ok" : "FAIL");
+        break;
+    case OUTPUT_JSON:
+        printf("%s\n        {\"file\": ", first ? "" : ",");
+        print_json_string(r->path);
+        printf(", \"width\": %d, \"height\": %d, \"channels\": %d,\n", r->width, r->height, r->channels);
+        printf("         \"qoi\": {\"encode_mps_median\": %.2f, \"encode_mps_p95\": %.2f, "
+               "\"decode_mps_median\": %.2f, \"decode_mps_p95\": %.2f, \"bytes\": %zu, \"bytes_per_pixel\": %.4f},\n",
+               megapixels_per_second(pixels, r->qoi_encode.median), megapixels_per_second(pixels, r->qoi_encode.p95),
+               megapixels_per_second(pixels, r->qoi_decode.median), megapixels_per_second(pixels, r->qoi_decode.p95),
+               r->qoi_size, r->qoi_size / pixels);
+        printf("         \"png\": {\"encode_mps_median\": %.2f, \"encode_mps_p95\": %.2f, "
+               "\"decode_mps_median\": %.2f, \"decode_mps_p95\": %.2f, \"file_bytes\": %zu, \"bytes_per_pixel\": %.4f},\n",
+               megapixels_per_second(pixels, r->png_encode.median), megapixels_per_second(pixels, r->png_encode.p95),
+               megapixels_per_second(pixels, r->png_decode.median), megapixels_per_second(pixels, r->png_decode.p95),
+               r->png_file_size, r->png_file_size / pixels);
+        printf("         \"round_trip\": %s}", r->round_trip_ok ? "true" : "false");
+        break;
+    default:
+        printf("%-40s %5dx%-5d %d  enc %8.1f (p95 %8.1f)  dec %8.1f (p95 %8.1f) MP/s  %.3f B/px",
+               r->path, r->width, r->height, r->channels,
+               megapixels_per_second(pixels, r->qoi_encode.median), megapixels_per_second(pixels, r->qoi_encode.p95),
+               megapixels_per_second(pixels, r->qoi_decode.median), megapixels_per_second(pixels, r->qoi_decode.p95),
+               r->qoi_size / pixels);
+        if (options->run_png) {
+            printf("  | png enc %6.1f dec %6.1f MP/s  %.3f B/px",
+                   megapixels_per_second(pixels, r->png_encode.median),
+                   megapixels_per_second(pixels, r->png_decode.median),
+                   r->png_file_size / pixels);
+        }
+        printf("  %s\n", r->round_trip_ok ? "ok" : "ROUND-TRIP FAIL");
+        break;
     }
+}
 
-    stbi_image_free(stb_pixel_data);
-    free(decoded_image_pixels);
+static void print_corpus_totals(const char *corpus, const CorpusTotals *t, const BenchOptions *options) {
+    double pixels = t->pixels > 0 ? t->pixels : 1;
 
-    printf("\nBenchmark finished.\n");
-    return 0;
+    switch (options->format) {
+    case OUTPUT_CSV:
+        // Aggregates use the median columns; p95 is not defined for a sum.
+        print_csv_string(corpus);
+        printf(",\"(total)\",,,,%.2f,,%.2f,,%.0f,%.4f,%.2f,,%.2f,,%.0f,%.4f,%s\n",
+               megapixels_per_second(t->pixels, t->qoi_encode_seconds),
+               megapixels_per_second(t->pixels, t->qoi_decode_seconds),
+               t->qoi_bytes, t->qoi_bytes / pixels,
+               megapixels_per_second(t->pixels, t->png_encode_seconds),
+               megapixels_per_second(t->pixels, t->png_decode_seconds),
+               t->png_file_bytes, t->png_file_bytes / pixels,
+               t->failed_count ? "FAIL" : "ok");
+        break;
+    case OUTPUT_JSON:
+        printf("\n      ],\n      \"total\": {\"images\": %d, \"round_trip_failures\": %d, \"megapixels\": %.3f,\n",
+               t->image_count, t->failed_count, t->pixels / 1000000.0);
+        printf("        \"qoi\": {\"encode_mps\": %.2f, \"decode_mps\": %.2f, \"bytes\": %.0f, \"bytes_per_pixel\": %.4f},\n",
+               megapixels_per_second(t->pixels, t->qoi_encode_seconds),
+               megapixels_per_second(t->pixels, t->qoi_decode_seconds),
+               t->qoi_bytes, t->qoi_bytes / pixels);
+        printf("        \"png\": {\"encode_mps\": %.2f, \"decode_mps\": %.2f, \"file_bytes\": %.0f, \"bytes_per_pixel\": %.4f}",
+               megapixels_per_second(t->pixels, t->png_encode_seconds),
+               megapixels_per_second(t->pixels, t->png_decode_seconds),
+               t->png_file_bytes, t->png_file_bytes / pixels);
+#if defined(QOI_ENABLE_STATS)
+        printf(",\n        \"stats\": {\"encode\": ");
+        print_json_codec_stats(&t->stats.encode);
+        printf(",\n                  \"decode\": ");
+        print_json_codec_stats(&t->stats.decode);
+        printf("}");
+#endif
+        printf("}\n    }");
+        break;
+    default:
+        printf("\n--- Corpus '%s': %d images, %.2f MP ---\n", corpus, t->image_count, t->pixels / 1000000.0);
+        printf("QOI encode: %.1f MP/s  decode: %.1f MP/s  size: %.0f bytes (%.3f B/px)\n",
+               megapixels_per_second(t->pixels, t->qoi_encode_seconds),
+               megapixels_per_second(t->pixels, t->qoi_decode_seconds),
+               t->qoi_bytes, t->qoi_bytes / pixels);
+        if (options->run_png) {
+            printf("PNG encode: %.1f MP/s  decode: %.1f MP/s  size: %.0f bytes (%.3f B/px)\n",
+                   megapixels_per_second(t->pixels, t->png_encode_seconds),
+                   megapixels_per_second(t->pixels, t->png_decode_seconds),
+                   t->png_file_bytes, t->png_file_bytes / pixels);
+            if (t->qoi_bytes > 0) {
+                printf("Compression ratio (PNG_size / QOI_size): %.2f : 1\n", t->png_file_bytes / t->qoi_bytes);
+            }
+        }
+#if defined(QOI_ENABLE_STATS)
+        qoi_stats_print(&t->stats, stdout);
+#endif
+        printf("Round trip: %s\n\n", t->failed_count ? "FAILED" : "ok");
+        break;
+    }
+}
+
+static void print_usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [options] <file.png | directory>...\n"
+            "Each argument is benchmarked as one corpus; directories are searched recursively for *.png.\n"
+            "  -n <count>   timed iterations per image (default %d)\n"
+            "  -w <count>   untimed warm-up iterations per image (default %d)\n"
+            "  --csv        CSV output (codec statistics are not included)\n"
+            "  --json       JSON output\n"
+            "  --no-png     skip the stb PNG encode/decode baseline\n",
+            program, DEFAULT_ITERATIONS, DEFAULT_WARMUP_ITERATIONS);
+}
+
+int main(int argc, char *argv[]) {
+    BenchOptions options;
+    options.iterations = DEFAULT_ITERATIONS;
+    options.warmup_iterations = DEFAULT_WARMUP_ITERATIONS;
+    options.run_png = 1;
+    options.format = OUTPUT_TEXT;
+
+    int first_corpus_arg = argc;
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "-w") == 0) && i + 1 < argc) {
+            int value = atoi(argv[i + 1]);
+            if (argv[i][1] == 'n') {
+                options.iterations = value;
+            } else {
+                options.warmup_iterations = value;
+            }
+            i++;
+        } else if (strcmp(argv[i], "--csv") == 0) {
+            options.format = OUTPUT_CSV;
+        } else if (strcmp(argv[i], "--json") == 0) {
+            options.format = OUTPUT_JSON;
+        } else if (strcmp(argv[i], "--no-png") == 0) {
+            options.run_png = 0;
+        } else if (argv[i][0] == '-') {
+            print_usage(argv[0]);
+            return 1;
+        } else {
+            first_corpus_arg = i;
+            break;
+        }
+    }
+    if (first_corpus_arg == argc || options.iterations < 1 || options.warmup_iterations < 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if (options.format == OUTPUT_CSV) {
+        print_csv_header();
+    } else if (options.format == OUTPUT_JSON) {
+        printf("{\"iterations\": %d, \"warmup_iterations\": %d, \"corpora\": [",
+               options.iterations, options.warmup_iterations);
+    }
+
+    int exit_status = 0;
+    for (int arg = first_corpus_arg; arg < argc; arg++) {
+        const char *corpus = argv[arg];
+        FileList files = {NULL, 0, 0};
+        if (collect_files(corpus, 1, &files) != 0) {
+            exit_status = 1;
+        }
+        if (files.count > 0) {
+            qsort(files.paths, files.count, sizeof(char *), compare_paths);
+        }
+
+        if (options.format == OUTPUT_JSON) {
+            printf("%s\n    {\"corpus\": ", arg == first_corpus_arg ? "" : ",");
+            print_json_string(corpus);
+            printf(",\n      \"images\": [");
+        }
+
+        CorpusTotals totals;
+        memset(&totals, 0, sizeof(totals));
+        for (size_t i = 0; i < files.count; i++) {
+            ImageResult result;
+            if (benchmark_image(files.paths[i], &options, &result) != 0) {
+                exit_status = 1;
+                continue;
+            }
+            if (!result.round_trip_ok) {
+                exit_status = 1;
+            }
+            print_image_result(corpus, &result, &options, totals.image_count == 0);
+            corpus_add(&totals, &result);
+            fflush(stdout);
+        }
+        print_corpus_totals(corpus, &totals, &options);
+        file_list_free(&files);
+    }
+
+    if (options.format == OUTPUT_JSON) {
+        printf("\n]}\n");
+    }
+    return exit_status;
 }
@@ -0,0 +1,452 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include "qoi_cache.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+enum {
+    QOI_CACHE_LOADING,
+    QOI_CACHE_READY,
+    QOI_CACHE_FAILED
+};
+
+typedef struct QOICacheShard QOICacheShard;
+
+typedef struct QOICacheEntry {
+    QOICachedImage image;  // Handles point here, so it must come first.
+    QOICacheShard *shard;
+    struct QOICacheEntry *bucket_next;
+    struct QOICacheEntry *clock_prev, *clock_next;
+
+    // Key: path, mtime and size for files; two content hashes and size for
+    // in-memory inputs (path NULL).
+    uint64_t hash;
+    uint64_t content_hash;
+    int64_t mtime;
+    uint64_t size;
+    char *path;
+
+    size_t bytes;
+    unsigned refcount;     // Handles plus the loader while LOADING.
+    uint8_t state;
+    uint8_t referenced;    // CLOCK second-chance bit.
+    uint8_t cached;        // Still reachable through the table.
+} QOICacheEntry;
+
+struct QOICacheShard {
+    pthread_mutex_t lock;
+    pthread_cond_t loaded;
+    QOICacheEntry **buckets;
+    size_t bucket_count;
+    size_t entry_count;
+    QOICacheEntry *clock_hand;  // Ring of READY entries.
+    size_t bytes, budget;
+    size_t ready_count;
+    uint64_t hits, misses, shared_loads, load_failures, evictions;
+};
+
+struct QOICache {
+    QOICacheShard *shards;
+    unsigned shard_count;
+};
+
+typedef struct QOICacheKey {
+    uint64_t hash;
+    uint64_t content_hash;
+    int64_t mtime;
+    uint64_t size;
+    const char *path;
+} QOICacheKey;
+
+#define QOI_CACHE_INITIAL_BUCKETS 64
+
+static uint64_t qoi_cache_mix(uint64_t value) {
+    value ^= value >> 33;
+    value *= 0xFF51AFD7ED558CCDULL;
+    value ^= value >> 33;
+    value *= 0xC4CEB9FE1A85EC53ULL;
+    value ^= value >> 33;
+    return value;
+}
+
+// Two independent 64-bit lanes over 8-byte words; both see every byte.
+static void qoi_cache_hash_contents(const uint8_t *data, size_t size, uint64_t *hash, uint64_t *content_hash) {
+    uint64_t a = 0x9E3779B97F4A7C15ULL ^ (uint64_t)size;
+    uint64_t b = 0xC2B2AE3D27D4EB4FULL + (uint64_t)size;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        a = (a ^ word) * 0xFF51AFD7ED558CCDULL;
+        a ^= a >> 32;
+        b = (b + word) * 0xC4CEB9FE1A85EC53ULL;
+        b ^= b >> 29;
+    }
+    if (i < size) {
+        uint64_t word = 0;
+        memcpy(&word, data + i, size - i);
+        a = (a ^ word) * 0xFF51AFD7ED558CCDULL;
+        b = (b + word) * 0xC4CEB9FE1A85EC53ULL;
+    }
+    *hash = qoi_cache_mix(a);
+    *content_hash = qoi_cache_mix(b);
+}
+
+static uint64_t qoi_cache_hash_file(const char *path, int64_t mtime, uint64_t size) {
+    // 64-bit FNV-1a of the path, then the file metadata.
+    uint64_t hash = 14695981039346656037ULL;
+    for (const unsigned char *c = (const unsigned char *)path; *c; c++) {
+        hash ^= *c;
+        hash *= 1099511628211ULL;
+    }
+    return qoi_cache_mix(hash ^ qoi_cache_mix((uint64_t)mtime ^ (size << 1)));
+}
+
+static int qoi_cache_key_matches(const QOICacheEntry *entry, const QOICacheKey *key) {
+    if (entry->hash != key->hash || entry->content_hash != key->content_hash ||
+        entry->mtime != key->mtime || entry->size != key->size) {
+        return 0;
+    }
+    if (!entry->path || !key->path) {
+        return !entry->path && !key->path;
+    }
+    return strcmp(entry->path, key->path) == 0;
+}
+
+static void qoi_cache_entry_free(QOICacheEntry *entry) {
+    free((void *)entry->image.pixels);
+    free(entry->path);
+    free(entry);
+}
+
+QOICache* qoi_cache_create(size_t byte_budget, unsigned shard_count) {
+    if (shard_count == 0) {
+        shard_count = QOI_CACHE_DEFAULT_SHARDS;
+    }
+    unsigned rounded = 1;
+    while (rounded < shard_count && rounded <= 0x8000) {
+        rounded *= 2;
+    }
+    shard_count = rounded;
+
+    QOICache *cache = (QOICache *)calloc(1, sizeof(QOICache));
+    if (!cache) {
+        return NULL;
+    }
+    cache->shards = (QOICacheShard *)calloc(shard_count, sizeof(QOICacheShard));
+    if (!cache->shards) {
+        free(cache);
+        return NULL;
+    }
+
+    for (unsigned i = 0; i < shard_count; i++) {
+        QOICacheShard *shard = &cache->shards[i];
+        shard->budget = byte_budget / shard_count;
+        shard->bucket_count = QOI_CACHE_INITIAL_BUCKETS;
+        shard->buckets = (QOICacheEntry **)calloc(shard->bucket_count, sizeof(QOICacheEntry *));
+        if (!shard->buckets) {
+            cache->shard_count = i;
+            qoi_cache_destroy(cache);
+            return NULL;
+        }
+        if (pthread_mutex_init(&shard->lock, NULL) != 0) {
+            free(shard->buckets);
+            cache->shard_count = i;
+            qoi_cache_destroy(cache);
+            return NULL;
+        }
+        if (pthread_cond_init(&shard->loaded, NULL) != 0) {
+            pthread_mutex_destroy(&shard->lock);
+            free(shard->buckets);
+            cache->shard_count = i;
+            qoi_cache_destroy(cache);
+            return NULL;
+        }
+    }
+    cache->shard_count = shard_count;
+    return cache;
+}
+
+void qoi_cache_destroy(QOICache *cache) {
+    if (!cache) {
+        return;
+    }
+    for (unsigned i = 0; i < cache->shard_count; i++) {
+        QOICacheShard *shard = &cache->shards[i];
+        for (size_t bucket = 0; bucket < shard->bucket_count; bucket++) {
+            QOICacheEntry *entry = shard->buckets[bucket];
+            while (entry) {
+                QOICacheEntry *next = entry->bucket_next;
+                qoi_cache_entry_free(entry);
+                entry = next;
+            }
+        }
+        free(shard->buckets);
+        pthread_cond_destroy(&shard->loaded);
+        pthread_mutex_destroy(&shard->lock);
+    }
+    free(cache->shards);
+    free(cache);
+}
+
+// The functions below run with shard->lock held.
+
+static QOICacheEntry *qoi_cache_find(QOICacheShard *shard, const QOICacheKey *key) {
+    QOICacheEntry *entry = shard->buckets[key->hash & (shard->bucket_count - 1)];
+    while (entry && !qoi_cache_key_matches(entry, key)) {
+        entry = entry->bucket_next;
+    }
+    return entry;
+}
+
+static void qoi_cache_table_insert(QOICacheShard *shard, QOICacheEntry *entry) {
+    if (shard->entry_count >= shard->bucket_count) {
+        // Keep the load factor at or below one; if growing fails the chains
+        // just get longer.
+        size_t new_count = shard->bucket_count * 2;
+        QOICacheEntry **grown = (QOICacheEntry **)calloc(new_count, sizeof(QOICacheEntry *));
+        if (grown) {
+            for (size_t bucket = 0; bucket < shard->bucket_count; bucket++) {
+                QOICacheEntry *moved = shard->buckets[bucket];
+                while (moved) {
+                    QOICacheEntry *next = moved->bucket_next;
+                    size_t target = moved->hash & (new_count - 1);
+                    moved->bucket_next = grown[target];
+                    grown[target] = moved;
+                    moved = next;
+                }
+            }
+            free(shard->buckets);
+            shard->buckets = grown;
+            shard->bucket_count = new_count;
+        }
+    }
+
+    size_t bucket = entry->hash & (shard->bucket_count - 1);
+    entry->bucket_next = shard->buckets[bucket];
+    shard->buckets[bucket] = entry;
+    shard->entry_count++;
+    entry->cached = 1;
+}
+
+static void qoi_cache_table_remove(QOICacheShard *shard, QOICacheEntry *entry) {
+    QOICacheEntry **link = &shard->buckets[entry->hash & (shard->bucket_count - 1)];
+    while (*link && *link != entry) {
+        link = &(*link)->bucket_next;
+    }
+    if (*link) {
+        *link = entry->bucket_next;
+        shard->entry_count--;
+    }
+    entry->cached = 0;
+}
+
+// Adds entry to the CLOCK ring just behind the hand, so it is the last one
+// the hand reaches.
+static void qoi_cache_clock_insert(QOICacheShard *shard, QOICacheEntry *entry) {
+    QOICacheEntry *hand = shard->clock_hand;
+    if (!hand) {
+        entry->clock_prev = entry->clock_next = entry;
+        shard->clock_hand = entry;
+    } else {
+        entry->clock_next = hand;
+        entry->clock_prev = hand->clock_prev;
+        hand->clock_prev->clock_next = entry;
+        hand->clock_prev = entry;
+    }
+    shard->ready_count++;
+}
+
+static void qoi_cache_clock_remove(QOICacheShard *shard, QOICacheEntry *entry) {
+    if (entry->clock_next == entry) {
+        shard->clock_hand = NULL;
+    } else {
+        entry->clock_prev->clock_next = entry->clock_next;
+        entry->clock_next->clock_prev = entry->clock_prev;
+        if (shard->clock_hand == entry) {
+            shard->clock_hand = entry->clock_next;
+        }
+    }
+    shard->ready_count--;
+}
+
+// Evicts until the shard is within budget. Entries with handles outstanding
+// leave the cache too; the last qoi_cache_release() frees them.
+static void qoi_cache_evict(QOICacheShard *shard) {
+    while (shard->bytes > shard->budget && shard->clock_hand) {
+        QOICacheEntry *victim = shard->clock_hand;
+        if (victim->referenced) {
+            victim->referenced = 0;
+            shard->clock_hand = victim->clock_next;
+            continue;
+        }
+        qoi_cache_clock_remove(shard, victim);
+        qoi_cache_table_remove(shard, victim);
+        shard->bytes -= victim->bytes;
+        shard->evictions++;
+        if (victim->refcount == 0) {
+            qoi_cache_entry_free(victim);
+        }
+    }
+}
+
+static const QOICachedImage *qoi_cache_get(QOICache *cache, const QOICacheKey *key,
+                                           const char *path, const uint8_t *data, size_t data_size) {
+    QOICacheShard *shard = &cache->shards[(key->hash >> 32) & (cache->shard_count - 1)];
+
+    pthread_mutex_lock(&shard->lock);
+    QOICacheEntry *entry = qoi_cache_find(shard, key);
+    if (entry) {
+        entry->refcount++;
+        if (entry->state == QOI_CACHE_LOADING) {
+            shard->shared_loads++;
+            while (entry->state == QOI_CACHE_LOADING) {
+                pthread_cond_wait(&shard->loaded, &shard->lock);
+            }
+        } else {
+            shard->hits++;
+        }
+
+        if (entry->state == QOI_CACHE_FAILED) {
+            int last = --entry->refcount == 0;
+            pthread_mutex_unlock(&shard->lock);
+            if (last) {
+                qoi_cache_entry_free(entry);
+            }
+            return NULL;
+        }
+        entry->referenced = 1;
+        pthread_mutex_unlock(&shard->lock);
+        return &entry->image;
+    }
+
+    // Miss: publish a LOADING entry so concurrent lookups of the same key
+    // wait for this decode instead of starting their own.
+    entry = (QOICacheEntry *)calloc(1, sizeof(QOICacheEntry));
+    char *path_copy = path ? (char *)malloc(strlen(path) + 1) : NULL;
+    if (!entry || (path && !path_copy)) {
+        pthread_mutex_unlock(&shard->lock);
+        free(entry);
+        free(path_copy);
+        return NULL;
+    }
+    if (path_copy) {
+        strcpy(path_copy, path);
+    }
+    entry->shard = shard;
+    entry->hash = key->hash;
+    entry->content_hash = key->content_hash;
+    entry->mtime = key->mtime;
+    entry->size = key->size;
+    entry->path = path_copy;
+    entry->refcount = 1;
+    entry->state = QOI_CACHE_LOADING;
+    qoi_cache_table_insert(shard, entry);
+    shard->misses++;
+    pthread_mutex_unlock(&shard->lock);
+
+    QOICachedImage image;
+    QOIPixel *pixels = path
+        ? qoi_decode_path(path, &image.width, &image.height, &image.channels, &image.colorspace)
+        : qoi_decode_from_memory(data, data_size, &image.width, &image.height, &image.channels, &image.colorspace);
+
+    pthread_mutex_lock(&shard->lock);
+    if (!pixels) {
+        entry->state = QOI_CACHE_FAILED;
+        qoi_cache_table_remove(shard, entry);
+        shard->load_failures++;
+        pthread_cond_broadcast(&shard->loaded);
+        int last = --entry->refcount == 0;
+        pthread_mutex_unlock(&shard->lock);
+        if (last) {
+            qoi_cache_entry_free(entry);
+        }
+        return NULL;
+    }
+
+    image.pixels = pixels;
+    entry->image = image;
+    entry->bytes = (size_t)image.width * image.height * sizeof(QOIPixel) + sizeof(QOICacheEntry) +
+                   (path ? strlen(path) + 1 : 0);
+    entry->state = QOI_CACHE_READY;
+    if (entry->bytes > shard->budget) {
+        // Too big to keep: hand it out uncached rather than flushing the
+        // shard for it. Waiting lookups still share this decode.
+        qoi_cache_table_remove(shard, entry);
+    } else {
+        shard->bytes += entry->bytes;
+        qoi_cache_clock_insert(shard, entry);
+        qoi_cache_evict(shard);
+    }
+    pthread_cond_broadcast(&shard->loaded);
+    pthread_mutex_unlock(&shard->lock);
+    return &entry->image;
+}
+
+const QOICachedImage* qoi_cache_get_file(QOICache *cache, const char *path) {
+    if (!cache || !path) {
+        return NULL;
+    }
+    struct stat file_stat;
+    if (stat(path, &file_stat) != 0) {
+        return NULL;
+    }
+
+    QOICacheKey key;
+    key.mtime = (int64_t)file_stat.st_mtime;
+    key.size = (uint64_t)file_stat.st_size;
+    key.hash = qoi_cache_hash_file(path, key.mtime, key.size);
+    key.content_hash = 0;
+    key.path = path;
+    return qoi_cache_get(cache, &key, path, NULL, 0);
+}
+
+const QOICachedImage* qoi_cache_get_memory(QOICache *cache, const uint8_t *data, size_t data_size) {
+    if (!cache || !data) {
+        return NULL;
+    }
+    QOICacheKey key;
+    qoi_cache_hash_contents(data, data_size, &key.hash, &key.content_hash);
+    key.mtime = 0;
+    key.size = (uint64_t)data_size;
+    key.path = NULL;
+    return qoi_cache_get(cache, &key, NULL, data, data_size);
+}
+
+void qoi_cache_release(QOICache *cache, const QOICachedImage *image) {
+    if (!cache || !image) {
+        return;
+    }
+    QOICacheEntry *entry = (QOICacheEntry *)image;
+    QOICacheShard *shard = entry->shard;
+
+    pthread_mutex_lock(&shard->lock);
+    int last = --entry->refcount == 0 && !entry->cached;
+    pthread_mutex_unlock(&shard->lock);
+    if (last) {
+        qoi_cache_entry_free(entry);
+    }
+}
+
+void qoi_cache_get_stats(QOICache *cache, QOICacheStats *stats) {
+    if (!cache || !stats) {
+        return;
+    }
+    memset(stats, 0, sizeof(*stats));
+    for (unsigned i = 0; i < cache->shard_count; i++) {
+        QOICacheShard *shard = &cache->shards[i];
+        pthread_mutex_lock(&shard->lock);
+        stats->hits += shard->hits;
+        stats->misses += shard->misses;
+        stats->shared_loads += shard->shared_loads;
+        stats->load_failures += shard->load_failures;
+        stats->evictions += shard->evictions;
+        stats->cached_bytes += shard->bytes;
+        stats->cached_images += shard->ready_count;
+        pthread_mutex_unlock(&shard->lock);
+    }
+}
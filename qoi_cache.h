@@ -0,0 +1,64 @@
+#ifndef QOI_CACHE_H
+#define QOI_CACHE_H
+
+#include "qoi_utils.h"
+
+// Thread-safe cache of decoded images. Files are keyed by path, modification
+// time and size, so an edited file is decoded afresh; in-memory inputs are
+// keyed by a 128-bit hash of their contents and their size.
+//
+// The cache holds at most byte_budget bytes of decoded pixels, split evenly
+// across independently locked shards, and evicts with the CLOCK
+// (second-chance) policy. Each shard enforces only its own share, so the
+// largest image the cache keeps is byte_budget / shard count (after
+// rounding); a bigger one is returned but not kept, and evicts nothing.
+// Caches of large images want few shards. Concurrent misses on the same key
+// decode it once: the first caller decodes while the others wait for its
+// result.
+//
+// Every successful lookup returns a reference-counted handle that must be
+// passed to qoi_cache_release(). Eviction removes an image from the cache at
+// once, but its pixels are freed only when the last handle is released.
+// Requires pthreads (-pthread).
+
+#define QOI_CACHE_DEFAULT_SHARDS 16
+
+typedef struct QOICache QOICache;
+
+typedef struct QOICachedImage {
+    const QOIPixel *pixels;
+    uint32_t width, height;
+    uint8_t channels, colorspace;
+} QOICachedImage;
+
+typedef struct QOICacheStats {
+    uint64_t hits;
+    uint64_t misses;          // Lookups that decoded the image.
+    uint64_t shared_loads;    // Lookups that waited for another caller's decode.
+    uint64_t load_failures;
+    uint64_t evictions;
+    size_t cached_bytes;
+    size_t cached_images;
+} QOICacheStats;
+
+// shard_count 0 selects QOI_CACHE_DEFAULT_SHARDS; it is rounded up to a power
+// of two. Pass 1 when single images may approach byte_budget (see above).
+// Returns NULL on failure.
+QOICache* qoi_cache_create(size_t byte_budget, unsigned shard_count);
+
+// Frees every cached image. All handles must have been released.
+void qoi_cache_destroy(QOICache *cache);
+
+// Returns the decoded file at path, or NULL if it cannot be read or decoded.
+const QOICachedImage* qoi_cache_get_file(QOICache *cache, const char *path);
+
+// Returns the decoded image for a QOI file held in memory. data does not
+// need to outlive the call.
+const QOICachedImage* qoi_cache_get_memory(QOICache *cache, const uint8_t *data, size_t data_size);
+
+void qoi_cache_release(QOICache *cache, const QOICachedImage *image);
+
+// Counters summed over all shards.
+void qoi_cache_get_stats(QOICache *cache, QOICacheStats *stats);
+
+#endif
@@ -0,0 +1,218 @@
+#include "qoi_context.h"
+#include "qoi_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void *qoi_default_malloc(void *user, size_t size) {
+    (void)user;
+    return malloc(size);
+}
+
+static void *qoi_default_realloc(void *user, void *ptr, size_t size) {
+    (void)user;
+    return realloc(ptr, size);
+}
+
+static void qoi_default_free(void *user, void *ptr) {
+    (void)user;
+    free(ptr);
+}
+
+void qoi_context_init(QOIContext *context, const QOIAllocator *allocator) {
+    if (!context) {
+        return;
+    }
+    if (allocator) {
+        context->allocator = *allocator;
+    } else {
+        context->allocator.malloc_fn = qoi_default_malloc;
+        context->allocator.realloc_fn = qoi_default_realloc;
+        context->allocator.free_fn = qoi_default_free;
+        context->allocator.user = NULL;
+    }
+    context->pixels = NULL;
+    context->pixels_capacity = 0;
+    context->encoded = NULL;
+    context->encoded_capacity = 0;
+}
+
+void qoi_context_free(QOIContext *context) {
+    if (!context) {
+        return;
+    }
+    QOIAllocator *allocator = &context->allocator;
+    if (context->pixels) {
+        allocator->free_fn(allocator->user, context->pixels);
+    }
+    if (context->encoded) {
+        allocator->free_fn(allocator->user, context->encoded);
+    }
+    context->pixels = NULL;
+    context->pixels_capacity = 0;
+    context->encoded = NULL;
+    context->encoded_capacity = 0;
+}
+
+// Makes *buffer hold at least size bytes. The old contents are kept only if
+// keep_contents is set; otherwise the buffer is replaced without copying.
+static int qoi_context_reserve(QOIContext *context, void **buffer, size_t *capacity,
+                               size_t size, int keep_contents) {
+    if (size <= *capacity) {
+        return 0;
+    }
+
+    QOIAllocator *allocator = &context->allocator;
+    void *grown;
+    if (keep_contents && *buffer) {
+        grown = allocator->realloc_fn(allocator->user, *buffer, size);
+        if (!grown) {
+            return 1;
+        }
+    } else {
+        if (*buffer) {
+            allocator->free_fn(allocator->user, *buffer);
+            *buffer = NULL;
+            *capacity = 0;
+        }
+        grown = allocator->malloc_fn(allocator->user, size);
+        if (!grown) {
+            return 1;
+        }
+    }
+    *buffer = grown;
+    *capacity = size;
+    return 0;
+}
+
+int qoi_context_encode(QOIContext *context,
+                       const QOIPixel *image_data,
+                       uint32_t width,
+                       uint32_t height,
+                       uint8_t channels,
+                       uint8_t colorspace,
+                       const uint8_t **out_data,
+                       size_t *out_size) {
+    if (!context || !image_data || !out_data || !out_size) {
+        return 1;
+    }
+
+    size_t required_capacity = qoi_encode_max_size(width, height, channels);
+    if (required_capacity == 0) {
+        return 1;
+    }
+    if (qoi_context_reserve(context, (void **)&context->encoded, &context->encoded_capacity,
+                            required_capacity, 0) != 0) {
+        fprintf(stderr, "Error: Could not allocate QOI output buffer.\n");
+        return 1;
+    }
+
+    if (qoi_encode_to_memory(image_data, width, height, channels, colorspace,
+                             context->encoded, context->encoded_capacity, out_size) != 0) {
+        return 1;
+    }
+    *out_data = context->encoded;
+    return 0;
+}
+
+int qoi_context_encode_to_file(QOIContext *context,
+                               const QOIPixel *image_data,
+                               uint32_t width,
+                               uint32_t height,
+                               uint8_t channels,
+                               uint8_t colorspace,
+                               FILE *outfile_ptr) {
+    if (!outfile_ptr) {
+        return 1;
+    }
+
+    const uint8_t *encoded_data;
+    size_t encoded_size;
+    if (qoi_context_encode(context, image_data, width, height, channels, colorspace,
+                           &encoded_data, &encoded_size) != 0) {
+        return 1;
+    }
+    if (fwrite(encoded_data, 1, encoded_size, outfile_ptr) != encoded_size || ferror(outfile_ptr)) {
+        return 1;
+    }
+    return 0;
+}
+
+const QOIPixel* qoi_context_decode(QOIContext *context,
+                                   const uint8_t *data,
+                                   size_t data_size,
+                                   uint32_t *out_width,
+                                   uint32_t *out_height,
+                                   uint8_t *out_channels,
+                                   uint8_t *out_colorspace) {
+    if (!context || !data || !out_width || !out_height || !out_channels || !out_colorspace) {
+        return NULL;
+    }
+    // Validate the header before growing the pooled buffer for it, so a
+    // corrupt input never leaves the context holding an oversized block.
+    QOIInfo info;
+    QOIStatus status = qoi_read_info(data, data_size, &info);
+    if (status != QOI_OK) {
+        fprintf(stderr, "Error: %s.\n", qoi_status_string(status));
+        return NULL;
+    }
+    if (!qoi_pixel_count_fits(info.width, info.height, data_size - QOI_HEADER_SIZE)) {
+        fprintf(stderr, "Error: QOI header dimensions do not match the data size.\n");
+        return NULL;
+    }
+    uint64_t num_pixels = (uint64_t)info.width * info.height;
+    if (num_pixels > SIZE_MAX / sizeof(QOIPixel)) {
+        fprintf(stderr, "Error: Image dimensions too large for memory allocation.\n");
+        return NULL;
+    }
+    size_t pixels_size = (size_t)num_pixels * sizeof(QOIPixel);
+    if (qoi_context_reserve(context, (void **)&context->pixels, &context->pixels_capacity,
+                            pixels_size, 0) != 0) {
+        fprintf(stderr, "Error: Could not allocate memory for decoded pixels.\n");
+        return NULL;
+    }
+
+    if (qoi_decode_into(data, data_size, context->pixels, (size_t)info.width * sizeof(QOIPixel),
+                        context->pixels_capacity, QOI_LAYOUT_RGBA,
+                        out_width, out_height, out_channels, out_colorspace) != 0) {
+        return NULL;
+    }
+    return context->pixels;
+}
+
+const QOIPixel* qoi_context_decode_from_file(QOIContext *context,
+                                             FILE *infile_ptr,
+                                             uint32_t *out_width,
+                                             uint32_t *out_height,
+                                             uint8_t *out_channels,
+                                             uint8_t *out_colorspace) {
+    if (!context || !infile_ptr) {
+        return NULL;
+    }
+
+    size_t file_size = 0;
+    for (;;) {
+        if (file_size == context->encoded_capacity) {
+            size_t grown_capacity = context->encoded_capacity ? context->encoded_capacity * 2 : 64 * 1024;
+            if (grown_capacity < context->encoded_capacity ||
+                qoi_context_reserve(context, (void **)&context->encoded, &context->encoded_capacity,
+                                    grown_capacity, 1) != 0) {
+                fprintf(stderr, "Error: Could not allocate memory for QOI file data.\n");
+                return NULL;
+            }
+        }
+        size_t bytes_read = fread(context->encoded + file_size, 1,
+                                  context->encoded_capacity - file_size, infile_ptr);
+        file_size += bytes_read;
+        if (bytes_read == 0) {
+            break;
+        }
+    }
+
+    if (ferror(infile_ptr)) {
+        perror("Error reading QOI file");
+        return NULL;
+    }
+
+    return qoi_context_decode(context, context->encoded, file_size,
+                              out_width, out_height, out_channels, out_colorspace);
+}
@@ -0,0 +1,66 @@
+#ifndef QOI_CONTEXT_H
+#define QOI_CONTEXT_H
+
+#include "qoi_utils.h"
+
+// Allocation hooks for a QOIContext. user is passed through unchanged, e.g. to
+// select a per-thread arena or pool.
+typedef struct QOIAllocator {
+    void *(*malloc_fn)(void *user, size_t size);
+    void *(*realloc_fn)(void *user, void *ptr, size_t size);
+    void (*free_fn)(void *user, void *ptr);
+    void *user;
+} QOIAllocator;
+
+// Reusable encoder/decoder buffers. They grow to the largest image seen and
+// are kept until qoi_context_free(), so a worker handling many images only
+// allocates when an image is bigger than every previous one. Results returned
+// by the functions below point into the context and stay valid until the next
+// call with the same context. A context must not be shared between threads.
+typedef struct QOIContext {
+    QOIAllocator allocator;
+    QOIPixel *pixels;           // Decoded RGBA output.
+    size_t pixels_capacity;     // In bytes.
+    uint8_t *encoded;           // Encoder output, or file data read for decoding.
+    size_t encoded_capacity;
+} QOIContext;
+
+// allocator may be NULL to use malloc/realloc/free.
+void qoi_context_init(QOIContext *context, const QOIAllocator *allocator);
+
+// Releases the buffers; the context can be reused after another init.
+void qoi_context_free(QOIContext *context);
+
+int qoi_context_encode(QOIContext *context,
+                       const QOIPixel *pixel_data,
+                       uint32_t width,
+                       uint32_t height,
+                       uint8_t channels,
+                       uint8_t colorspace,
+                       const uint8_t **out_data,
+                       size_t *out_size);
+
+int qoi_context_encode_to_file(QOIContext *context,
+                               const QOIPixel *pixel_data,
+                               uint32_t width,
+                               uint32_t height,
+                               uint8_t channels,
+                               uint8_t colorspace,
+                               FILE *outfile_ptr);
+
+const QOIPixel* qoi_context_decode(QOIContext *context,
+                                   const uint8_t *data,
+                                   size_t data_size,
+                                   uint32_t *width,
+                                   uint32_t *height,
+                                   uint8_t *channels,
+                                   uint8_t *colorspace);
+
+const QOIPixel* qoi_context_decode_from_file(QOIContext *context,
+                                             FILE *infile_ptr,
+                                             uint32_t *width,
+                                             uint32_t *height,
+                                             uint8_t *channels,
+                                             uint8_t *colorspace);
+
+#endif
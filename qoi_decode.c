@@ -1,58 +1,489 @@
-#include "qoi_utils.h"
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include "qoi_internal.h"
 #include <stdlib.h>
 #include <string.h>
 
-static uint8_t qoi_calculate_hash_static(QOIPixel px) {
-    return (px.r * 3 + px.g * 5 + px.b * 7 + px.a * 11) % QOI_INDEX_SIZE;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define QOI_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const unsigned char QOI_END_MARKER[8] = {0,0,0,0,0,0,0,1};
+
+enum {
+    QOI_CLASS_INDEX,
+    QOI_CLASS_DIFF,
+    QOI_CLASS_LUMA,
+    QOI_CLASS_RUN,
+    QOI_CLASS_RGB,
+    QOI_CLASS_RGBA
+};
+
+#define QOI_REPEAT_16(v) v, v, v, v, v, v, v, v, v, v, v, v, v, v, v, v
+#define QOI_REPEAT_64(v) QOI_REPEAT_16(v), QOI_REPEAT_16(v), QOI_REPEAT_16(v), QOI_REPEAT_16(v)
+
+// Opcode class for every possible first byte, so the hot loop dispatches
+// with a single table load instead of a chain of tag comparisons.
+static const uint8_t qoi_opcode_class[256] = {
+    QOI_REPEAT_64(QOI_CLASS_INDEX),
+    QOI_REPEAT_64(QOI_CLASS_DIFF),
+    QOI_REPEAT_64(QOI_CLASS_LUMA),
+    QOI_REPEAT_16(QOI_CLASS_RUN), QOI_REPEAT_16(QOI_CLASS_RUN), QOI_REPEAT_16(QOI_CLASS_RUN),
+    QOI_CLASS_RUN, QOI_CLASS_RUN, QOI_CLASS_RUN, QOI_CLASS_RUN, QOI_CLASS_RUN, QOI_CLASS_RUN, QOI_CLASS_RUN,
+    QOI_CLASS_RUN, QOI_CLASS_RUN, QOI_CLASS_RUN, QOI_CLASS_RUN, QOI_CLASS_RUN, QOI_CLASS_RUN, QOI_CLASS_RUN,
+    QOI_CLASS_RGB,
+    QOI_CLASS_RGBA
+};
+
+// Largest opcode (QOI_OP_RGBA) and the most pixels one run can write,
+// rounded up to the 4-pixel stores used to fill runs.
+#define QOI_MAX_OPCODE_BYTES 5
+#define QOI_MAX_RUN_STORE 64
+
+// GCC and Clang dispatch through computed goto; define QOI_NO_COMPUTED_GOTO
+// to use the portable switch instead.
+#if defined(__GNUC__) && !defined(QOI_NO_COMPUTED_GOTO)
+#define QOI_COMPUTED_GOTO 1
+#endif
+
+// Decodes as many whole chunks of opcodes as fit without any bounds checks:
+// each chunk is sized so that even all-RGBA input or all-run output cannot
+// cross in_end or out_end.
+static void qoi_decode_pixels_fast(QOIDecodeState *state,
+                                   const uint8_t **in_ptr,
+                                   const uint8_t *in_end,
+                                   QOIPixel **out_ptr,
+                                   QOIPixel *out_end) {
+    const uint8_t *in = *in_ptr;
+    QOIPixel *out = *out_ptr;
+    QOIPixel px = state->previous_pixel;
+    QOIPixel *index_array = state->index_array;
+    uint8_t byte1;
+
+    for (;;) {
+        size_t ops_left = (size_t)(in_end - in) / QOI_MAX_OPCODE_BYTES;
+        size_t out_chunks = (size_t)(out_end - out) / QOI_MAX_RUN_STORE;
+        if (ops_left > out_chunks) {
+            ops_left = out_chunks;
+        }
+        if (ops_left == 0) {
+            break;
+        }
+
+#define QOI_OP_BODY_INDEX                                                   \
+        px = index_array[byte1 & 0x3F];                                     \
+        QOI_STATS_OPCODE(decode, INDEX, 1);
+#define QOI_OP_BODY_DIFF                                                    \
+        px.r += ((byte1 >> 4) & 0x03) - 2;                                  \
+        px.g += ((byte1 >> 2) & 0x03) - 2;                                  \
+        px.b += (byte1 & 0x03) - 2;                                         \
+        QOI_STATS_OPCODE(decode, DIFF, 1);
+#define QOI_OP_BODY_LUMA                                                    \
+        {                                                                   \
+            uint8_t byte2 = *in++;                                          \
+            int dg_val = (byte1 & 0x3F) - 32;                               \
+            px.r += dg_val - 8 + ((byte2 >> 4) & 0x0F);                     \
+            px.g += dg_val;                                                 \
+            px.b += dg_val - 8 + (byte2 & 0x0F);                            \
+            QOI_STATS_OPCODE(decode, LUMA, 2);                              \
+        }
+#define QOI_OP_BODY_RGB                                                     \
+        px.r = in[0];                                                       \
+        px.g = in[1];                                                       \
+        px.b = in[2];                                                       \
+        in += 3;                                                            \
+        QOI_STATS_OPCODE(decode, RGB, 4);
+#define QOI_OP_BODY_RGBA                                                    \
+        px.r = in[0];                                                       \
+        px.g = in[1];                                                       \
+        px.b = in[2];                                                       \
+        px.a = in[3];                                                       \
+        in += 4;                                                            \
+        QOI_STATS_OPCODE(decode, RGBA, 5);
+#define QOI_OP_BODY_RUN                                                     \
+        {                                                                   \
+            int run_length = (byte1 & 0x3F) + 1;                            \
+            QOIPixel quad[4] = {px, px, px, px};                            \
+            for (int i = 0; i < run_length; i += 4) {                       \
+                memcpy(out + i, quad, sizeof(quad));                        \
+            }                                                               \
+            out += run_length;                                              \
+            index_array[qoi_hash_pixel(px)] = px;                           \
+            QOI_STATS_RUN(decode, run_length);                              \
+        }
+#define QOI_EMIT_PIXEL                                                      \
+        *out++ = px;                                                        \
+        index_array[qoi_hash_pixel(px)] = px;
+
+#if defined(QOI_COMPUTED_GOTO)
+        static const void *const dispatch_table[6] = {
+            __extension__ &&op_index, __extension__ &&op_diff, __extension__ &&op_luma,
+            __extension__ &&op_run, __extension__ &&op_rgb, __extension__ &&op_rgba
+        };
+#define QOI_DISPATCH_NEXT()                                                 \
+        if (ops_left-- == 0) {                                              \
+            continue;                                                       \
+        }                                                                   \
+        byte1 = *in++;                                                      \
+        __extension__ ({ goto *dispatch_table[qoi_opcode_class[byte1]]; })
+
+        QOI_DISPATCH_NEXT();
+op_index:
+        QOI_OP_BODY_INDEX
+        QOI_EMIT_PIXEL
+        QOI_DISPATCH_NEXT();
+op_diff:
+        QOI_OP_BODY_DIFF
+        QOI_EMIT_PIXEL
+        QOI_DISPATCH_NEXT();
+op_luma:
+        QOI_OP_BODY_LUMA
+        QOI_EMIT_PIXEL
+        QOI_DISPATCH_NEXT();
+op_run:
+        QOI_OP_BODY_RUN
+        QOI_DISPATCH_NEXT();
+op_rgb:
+        QOI_OP_BODY_RGB
+        QOI_EMIT_PIXEL
+        QOI_DISPATCH_NEXT();
+op_rgba:
+        QOI_OP_BODY_RGBA
+        QOI_EMIT_PIXEL
+        QOI_DISPATCH_NEXT();
+#undef QOI_DISPATCH_NEXT
+#else
+        while (ops_left-- > 0) {
+            byte1 = *in++;
+            switch (qoi_opcode_class[byte1]) {
+            case QOI_CLASS_INDEX: QOI_OP_BODY_INDEX QOI_EMIT_PIXEL break;
+            case QOI_CLASS_DIFF:  QOI_OP_BODY_DIFF  QOI_EMIT_PIXEL break;
+            case QOI_CLASS_LUMA:  QOI_OP_BODY_LUMA  QOI_EMIT_PIXEL break;
+            case QOI_CLASS_RUN:   QOI_OP_BODY_RUN                  break;
+            case QOI_CLASS_RGB:   QOI_OP_BODY_RGB   QOI_EMIT_PIXEL break;
+            default:              QOI_OP_BODY_RGBA  QOI_EMIT_PIXEL break;
+            }
+        }
+#endif
+
+#undef QOI_OP_BODY_INDEX
+#undef QOI_OP_BODY_DIFF
+#undef QOI_OP_BODY_LUMA
+#undef QOI_OP_BODY_RGB
+#undef QOI_OP_BODY_RGBA
+#undef QOI_OP_BODY_RUN
+#undef QOI_EMIT_PIXEL
+    }
+
+    state->previous_pixel = px;
+    *in_ptr = in;
+    *out_ptr = out;
 }
 
+size_t qoi_decode_pixels(QOIDecodeState *state,
+                         const uint8_t **in_ptr,
+                         const uint8_t *in_end,
+                         QOIPixel *out,
+                         size_t out_count) {
+    const uint8_t *in = *in_ptr;
+    QOIPixel *out_start = out;
+    QOIPixel *out_end = out + out_count;
+    QOIPixel previous_pixel = state->previous_pixel;
 
-QOIPixel* qoi_decode_from_file(FILE *infile_ptr,
-                               uint32_t *out_width,
-                               uint32_t *out_height,
-                               uint8_t *out_channels,
-                               uint8_t *out_colorspace) {
-    if (!infile_ptr || !out_width || !out_height || !out_channels || !out_colorspace) {
-        return NULL;
+    while (state->run_remaining > 0 && out < out_end) {
+        *out++ = previous_pixel;
+        state->run_remaining--;
     }
 
-    unsigned char header_buffer[14];
-    if (fread(header_buffer, 1, 14, infile_ptr) != 14) {
-        fprintf(stderr, "Error: Could not read QOI header.\n");
-        return NULL;
+    qoi_decode_pixels_fast(state, &in, in_end, &out, out_end);
+    previous_pixel = state->previous_pixel;
+
+    // Guarded path for the last few opcodes near the end of either buffer.
+    while (out < out_end) {
+        if (in >= in_end) {
+            break;
+        }
+
+        uint8_t byte1 = *in;
+        QOIPixel current_pixel_val = previous_pixel;
+
+        if (byte1 == QOI_OP_RGB_BYTE) {
+            if (in_end - in < 4) {
+                break;
+            }
+            current_pixel_val.r = in[1];
+            current_pixel_val.g = in[2];
+            current_pixel_val.b = in[3];
+            in += 4;
+            QOI_STATS_OPCODE(decode, RGB, 4);
+        } else if (byte1 == QOI_OP_RGBA_BYTE) {
+            if (in_end - in < 5) {
+                break;
+            }
+            current_pixel_val.r = in[1];
+            current_pixel_val.g = in[2];
+            current_pixel_val.b = in[3];
+            current_pixel_val.a = in[4];
+            in += 5;
+            QOI_STATS_OPCODE(decode, RGBA, 5);
+        } else {
+            uint8_t tag = (byte1 >> 6) & 0x03;
+
+            if (tag == QOI_OP_INDEX_TAG) {
+                current_pixel_val = state->index_array[byte1 & 0x3F];
+                in++;
+                QOI_STATS_OPCODE(decode, INDEX, 1);
+            } else if (tag == QOI_OP_DIFF_TAG) {
+                current_pixel_val.r = previous_pixel.r + (((byte1 >> 4) & 0x03) - 2);
+                current_pixel_val.g = previous_pixel.g + (((byte1 >> 2) & 0x03) - 2);
+                current_pixel_val.b = previous_pixel.b + ((byte1 & 0x03) - 2);
+                in++;
+                QOI_STATS_OPCODE(decode, DIFF, 1);
+            } else if (tag == QOI_OP_LUMA_TAG) {
+                if (in_end - in < 2) {
+                    break;
+                }
+                uint8_t byte2 = in[1];
+
+                int dg_val = (byte1 & 0x3F) - 32;
+                int dr_val = (((byte2 >> 4) & 0x0F) - 8) + dg_val;
+                int db_val = ((byte2 & 0x0F) - 8) + dg_val;
+
+                current_pixel_val.r = previous_pixel.r + dr_val;
+                current_pixel_val.g = previous_pixel.g + dg_val;
+                current_pixel_val.b = previous_pixel.b + db_val;
+                in += 2;
+                QOI_STATS_OPCODE(decode, LUMA, 2);
+            } else {
+                uint32_t run_length = (byte1 & 0x3F) + 1;
+                in++;
+                QOI_STATS_RUN(decode, run_length);
+                if (run_length > (size_t)(out_end - out)) {
+                    state->run_remaining = run_length - (uint32_t)(out_end - out);
+                    run_length = (uint32_t)(out_end - out);
+                }
+                for (uint32_t i = 0; i < run_length; ++i) {
+                    *out++ = previous_pixel;
+                }
+                state->index_array[qoi_hash_pixel(previous_pixel)] = previous_pixel;
+                continue;
+            }
+        }
+
+        *out++ = current_pixel_val;
+        state->index_array[qoi_hash_pixel(current_pixel_val)] = current_pixel_val;
+        previous_pixel = current_pixel_val;
     }
 
-    if (header_buffer[0] != 'q' || header_buffer[1] != 'o' ||
-        header_buffer[2] != 'i' || header_buffer[3] != 'f') {
-        fprintf(stderr, "Error: Invalid QOI magic bytes.\n");
-        return NULL;
+    state->previous_pixel = previous_pixel;
+    *in_ptr = in;
+    return (size_t)(out - out_start);
+}
+
+QOIStatus qoi_read_info(const uint8_t *data, size_t data_size, QOIInfo *info) {
+    if (!data || !info) {
+        return QOI_ERROR_INVALID_ARGUMENT;
+    }
+    if (data_size < QOI_HEADER_SIZE) {
+        return QOI_ERROR_TRUNCATED_HEADER;
+    }
+    if (data[0] != 'q' || data[1] != 'o' ||
+        data[2] != 'i' || data[3] != 'f') {
+        return QOI_ERROR_BAD_MAGIC;
     }
 
-    *out_width = ((uint32_t)header_buffer[4] << 24) |
-                 ((uint32_t)header_buffer[5] << 16) |
-                 ((uint32_t)header_buffer[6] << 8) |
-                 ((uint32_t)header_buffer[7]);
-    *out_height = ((uint32_t)header_buffer[8] << 24) |
-                  ((uint32_t)header_buffer[9] << 16) |
-                  ((uint32_t)header_buffer[10] << 8) |
-                  ((uint32_t)header_buffer[11]);
-    *out_channels = header_buffer[12];
-    *out_colorspace = header_buffer[13];
+    info->width = qoi_read_u32_be(data + 4);
+    info->height = qoi_read_u32_be(data + 8);
+    info->channels = data[12];
+    info->colorspace = data[13];
 
-    if (*out_width == 0 || *out_height == 0 || *out_channels < 3 || *out_channels > 4) {
-        fprintf(stderr, "Error: Invalid image dimensions or channels in header.\n");
-        return NULL;
+    if (info->width == 0 || info->height == 0) {
+        return QOI_ERROR_ZERO_DIMENSIONS;
+    }
+    if (info->channels < 3 || info->channels > 4) {
+        return QOI_ERROR_BAD_CHANNELS;
+    }
+    if (info->colorspace > 1) {
+        return QOI_ERROR_BAD_COLORSPACE;
+    }
+    return QOI_OK;
+}
+
+// Opcode length in bytes for every possible first byte.
+static const uint8_t qoi_opcode_bytes[256] = {
+    QOI_REPEAT_64(1), QOI_REPEAT_64(1), QOI_REPEAT_64(2),
+    QOI_REPEAT_16(1), QOI_REPEAT_16(1), QOI_REPEAT_16(1),
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    4, 5
+};
+
+QOIStatus qoi_validate(const uint8_t *data, size_t data_size, QOIInfo *info, size_t *error_offset) {
+    QOIInfo header = {0, 0, 0, 0};
+    size_t offset = 0;
+    QOIStatus status = qoi_read_info(data, data_size, &header);
+    if (info && status != QOI_ERROR_INVALID_ARGUMENT) {
+        *info = header;
+    }
+    if (status == QOI_ERROR_ZERO_DIMENSIONS) {
+        offset = 4;
+    } else if (status == QOI_ERROR_BAD_CHANNELS) {
+        offset = 12;
+    } else if (status == QOI_ERROR_BAD_COLORSPACE) {
+        offset = 13;
+    }
+    if (status != QOI_OK) {
+        if (error_offset) {
+            *error_offset = offset;
+        }
+        return status;
+    }
+
+    const uint8_t *in = data + QOI_HEADER_SIZE;
+    const uint8_t *in_end = data + data_size;
+    uint64_t pixels_left = (uint64_t)header.width * header.height;
+
+    // Unchecked walk while neither the longest opcode nor the longest run can
+    // overrun. It branches on the opcode class instead of looking lengths up
+    // in qoi_opcode_bytes: predicted branches let the next opcode address be
+    // formed without waiting for this opcode's byte to load.
+    while (in_end - in >= QOI_MAX_OPCODE_BYTES && pixels_left >= QOI_MAX_RUN_LENGTH) {
+        uint8_t byte1 = *in;
+        if (byte1 < 0x80) {
+            in++;
+            pixels_left--;
+        } else if (byte1 < 0xC0) {
+            in += 2;
+            pixels_left--;
+        } else if (byte1 < QOI_OP_RGB_BYTE) {
+            in++;
+            pixels_left -= (uint32_t)(byte1 & 0x3F) + 1;
+        } else if (byte1 == QOI_OP_RGB_BYTE) {
+            in += 4;
+            pixels_left--;
+        } else {
+            in += 5;
+            pixels_left--;
+        }
+    }
+
+    // Guarded path for the last opcodes near the end of either count.
+    while (pixels_left > 0) {
+        if (in >= in_end || (size_t)(in_end - in) < qoi_opcode_bytes[*in]) {
+            status = QOI_ERROR_TRUNCATED_DATA;
+            break;
+        }
+        uint32_t pixels = qoi_opcode_class[*in] == QOI_CLASS_RUN ? (uint32_t)(*in & 0x3F) + 1 : 1;
+        if (pixels > pixels_left) {
+            status = QOI_ERROR_RUN_OVERFLOW;
+            break;
+        }
+        pixels_left -= pixels;
+        in += qoi_opcode_bytes[*in];
+    }
+
+    if (status == QOI_OK) {
+        size_t trailing_bytes = (size_t)(in_end - in);
+        if (trailing_bytes < QOI_PADDING_SIZE || memcmp(in, QOI_END_MARKER, QOI_PADDING_SIZE) != 0) {
+            status = QOI_ERROR_BAD_END_MARKER;
+        } else if (trailing_bytes > QOI_PADDING_SIZE) {
+            status = QOI_ERROR_TRAILING_DATA;
+            in += QOI_PADDING_SIZE;
+        }
+    }
+    if (status != QOI_OK && error_offset) {
+        *error_offset = (size_t)(in - data);
     }
-    if (*out_height > 0 && *out_width > UINT32_MAX / *out_height) {
-        fprintf(stderr, "Error: Image dimensions (width * height) too large, would overflow uint32_t.\n");
+    return status;
+}
+
+const char *qoi_status_string(QOIStatus status) {
+    switch (status) {
+    case QOI_OK:                     return "ok";
+    case QOI_ERROR_INVALID_ARGUMENT: return "invalid argument";
+    case QOI_ERROR_TRUNCATED_HEADER: return "truncated QOI header";
+    case QOI_ERROR_BAD_MAGIC:        return "invalid QOI magic bytes";
+    case QOI_ERROR_ZERO_DIMENSIONS:  return "zero image width or height";
+    case QOI_ERROR_BAD_CHANNELS:     return "invalid channel count";
+    case QOI_ERROR_BAD_COLORSPACE:   return "invalid colorspace";
+    case QOI_ERROR_TRUNCATED_DATA:   return "pixel data ends before the image is complete";
+    case QOI_ERROR_RUN_OVERFLOW:     return "run extends past the end of the image";
+    case QOI_ERROR_BAD_END_MARKER:   return "missing or corrupt end-of-stream marker";
+    case QOI_ERROR_TRAILING_DATA:    return "data after the end-of-stream marker";
+    }
+    return "unknown error";
+}
+
+static int qoi_parse_header(const uint8_t *data,
+                            size_t data_size,
+                            uint32_t *out_width,
+                            uint32_t *out_height,
+                            uint8_t *out_channels,
+                            uint8_t *out_colorspace) {
+    QOIInfo info;
+    QOIStatus status = qoi_read_info(data, data_size, &info);
+    if (status != QOI_OK) {
+        fprintf(stderr, "Error: %s.\n", qoi_status_string(status));
+        return 1;
+    }
+
+    *out_width = info.width;
+    *out_height = info.height;
+    *out_channels = info.channels;
+    *out_colorspace = info.colorspace;
+    return 0;
+}
+
+static void qoi_check_end_marker(const uint8_t *in, const uint8_t *in_end) {
+    size_t trailing_bytes = (size_t)(in_end - in);
+    if (trailing_bytes >= QOI_PADDING_SIZE) {
+        if (memcmp(in, QOI_END_MARKER, QOI_PADDING_SIZE) != 0) {
+            fprintf(stderr, "Warning: End-of-stream marker mismatch. File might be corrupt or have extra data.\n");
+        } else if (trailing_bytes > QOI_PADDING_SIZE) {
+            fprintf(stderr, "Warning: Additional data found after QOI end-of-stream marker.\n");
+        }
+    } else {
+        fprintf(stderr, "Warning: Could not fully read/verify end-of-stream marker (read %d bytes of 8). File might be truncated.\n", (int)trailing_bytes);
+    }
+}
+
+// Decodes the opcodes in data[0, data_size), then checks that the end marker
+// follows the last one and reaches file_end. file_end lies past
+// data + data_size when the caller has already split the marker off.
+static QOIPixel* qoi_decode_buffer(const uint8_t *data,
+                                   size_t data_size,
+                                   const uint8_t *file_end,
+                                   uint32_t *out_width,
+                                   uint32_t *out_height,
+                                   uint8_t *out_channels,
+                                   uint8_t *out_colorspace) {
+    if (!data || !out_width || !out_height || !out_channels || !out_colorspace) {
         return NULL;
     }
-    uint32_t num_pixels_to_decode = (*out_width) * (*out_height);
 
-    if (num_pixels_to_decode > SIZE_MAX / sizeof(QOIPixel)) {
-         fprintf(stderr, "Error: Image dimensions too large for memory allocation.\n");
+    QOI_STATS_TIMER(stats_timer);
+    if (qoi_parse_header(data, data_size, out_width, out_height, out_channels, out_colorspace) != 0) {
+        return NULL;
+    }
+    if (!qoi_pixel_count_fits(*out_width, *out_height, data_size - QOI_HEADER_SIZE)) {
+        fprintf(stderr, "Error: QOI header dimensions do not match the data size.\n");
         return NULL;
     }
+    uint64_t num_pixels = (uint64_t)*out_width * *out_height;
+    if (num_pixels > SIZE_MAX / sizeof(QOIPixel)) {
+        fprintf(stderr, "Error: Image dimensions too large for memory allocation.\n");
+        return NULL;
+    }
+    size_t num_pixels_to_decode = (size_t)num_pixels;
 
     QOIPixel *decoded_pixels_data = (QOIPixel *)malloc(num_pixels_to_decode * sizeof(QOIPixel));
     if (decoded_pixels_data == NULL) {
@@ -60,137 +491,991 @@ QOIPixel* qoi_decode_from_file(FILE *infile_ptr,
         return NULL;
     }
 
-    QOIPixel previous_pixel = {0, 0, 0, 255};
-    QOIPixel index_array[QOI_INDEX_SIZE];
-    memset(index_array, 0, sizeof(index_array));
+    QOIDecodeState state;
+    qoi_decode_state_init(&state);
 
-    uint32_t decoded_pixel_count = 0;
-    int byte1;
-    unsigned char stream_end_check_buffer[8];
-    int stream_end_bytes_read_ahead = 0;
+    const uint8_t *in = data + QOI_HEADER_SIZE;
+    const uint8_t *in_end = data + data_size;
+    QOI_STATS_PHASE(decode, HEADER, stats_timer);
 
-    while (decoded_pixel_count < num_pixels_to_decode) {
-        if (stream_end_bytes_read_ahead > 0) {
-            byte1 = stream_end_check_buffer[0];
-            if (stream_end_bytes_read_ahead > 1) {
-                memmove(stream_end_check_buffer, stream_end_check_buffer + 1, stream_end_bytes_read_ahead - 1);
-            }
-            stream_end_bytes_read_ahead--;
-        } else {
-            byte1 = fgetc(infile_ptr);
+    size_t decoded_pixel_count = qoi_decode_pixels(&state, &in, in_end,
+                                                   decoded_pixels_data, num_pixels_to_decode);
+    if (decoded_pixel_count != num_pixels_to_decode) {
+        fprintf(stderr, "Error: Unexpected EOF during pixel decoding. Decoded %llu of %llu pixels.\n",
+                (unsigned long long)decoded_pixel_count, (unsigned long long)num_pixels_to_decode);
+        free(decoded_pixels_data);
+        return NULL;
+    }
+    if (state.run_remaining > 0) {
+        fprintf(stderr, "Error: Decoded more pixels than specified in header. Stream may be corrupt.\n");
+        free(decoded_pixels_data);
+        return NULL;
+    }
+    QOI_STATS_PHASE(decode, PIXELS, stats_timer);
+
+    qoi_check_end_marker(in, file_end);
+    QOI_STATS_PHASE(decode, TRAILER, stats_timer);
+    return decoded_pixels_data;
+}
+
+QOIPixel* qoi_decode_from_memory(const uint8_t *data,
+                                 size_t data_size,
+                                 uint32_t *out_width,
+                                 uint32_t *out_height,
+                                 uint8_t *out_channels,
+                                 uint8_t *out_colorspace) {
+    return qoi_decode_buffer(data, data_size, data + data_size, out_width, out_height,
+                             out_channels, out_colorspace);
+}
+
+// Pixels converted per step when the target layout is not RGBA.
+#define QOI_CONVERT_CHUNK_PIXELS 512
+
+// 8-bit sRGB to linear, as float and as IEEE half.
+static const float qoi_srgb_to_linear_f32[256] = {
+    0.0f, 0.000303526991f, 0.000607053982f, 0.000910580973f, 0.00121410796f, 0.00151763496f,
+    0.00182116195f, 0.00212468882f, 0.00242821593f, 0.0027317428f, 0.00303526991f, 0.00334653584f,
+    0.00367650739f, 0.00402471703f, 0.00439144205f, 0.00477695325f, 0.00518151652f, 0.00560539169f,
+    0.00604883302f, 0.00651209056f, 0.00699541019f, 0.00749903219f, 0.00802319311f, 0.00856812578f,
+    0.00913405884f, 0.00972121768f, 0.010329823f, 0.0109600937f, 0.0116122449f, 0.012286488f,
+    0.0129830325f, 0.0137020834f, 0.0144438436f, 0.0152085144f, 0.0159962941f, 0.0168073755f,
+    0.0176419541f, 0.01850022f, 0.0193823613f, 0.0202885624f, 0.0212190095f, 0.0221738853f,
+    0.0231533665f, 0.0241576321f, 0.0251868591f, 0.0262412224f, 0.0273208916f, 0.02842604f,
+    0.0295568351f, 0.0307134446f, 0.0318960324f, 0.0331047662f, 0.0343398079f, 0.0356013142f,
+    0.0368894488f, 0.0382043719f, 0.0395462364f, 0.0409151986f, 0.0423114114f, 0.043735031f,
+    0.045186203f, 0.0466650873f, 0.0481718257f, 0.0497065671f, 0.0512694567f, 0.0528606474f,
+    0.054480277f, 0.0561284907f, 0.0578054301f, 0.0595112368f, 0.0612460524f, 0.0630100146f,
+    0.064803265f, 0.0666259378f, 0.0684781671f, 0.0703600943f, 0.0722718537f, 0.0742135718f,
+    0.0761853829f, 0.078187421f, 0.0802198201f, 0.0822827071f, 0.0843762085f, 0.0865004584f,
+    0.0886555836f, 0.0908417106f, 0.0930589661f, 0.0953074694f, 0.097587347f, 0.0998987257f,
+    0.102241732f, 0.104616486f, 0.107023105f, 0.10946171f, 0.111932427f, 0.114435375f,
+    0.116970666f, 0.119538426f, 0.122138776f, 0.124771819f, 0.127437681f, 0.130136475f,
+    0.13286832f, 0.135633335f, 0.138431609f, 0.141263291f, 0.144128472f, 0.147027269f,
+    0.149959788f, 0.152926147f, 0.155926466f, 0.158960834f, 0.162029371f, 0.165132195f,
+    0.168269396f, 0.171441108f, 0.174647406f, 0.177888423f, 0.18116425f, 0.18447499f,
+    0.187820777f, 0.191201687f, 0.194617838f, 0.198069319f, 0.20155625f, 0.205078736f,
+    0.208636865f, 0.212230757f, 0.215860501f, 0.219526201f, 0.223227963f, 0.226965874f,
+    0.230740055f, 0.23455058f, 0.238397568f, 0.242281124f, 0.246201321f, 0.25015828f,
+    0.254152089f, 0.258182853f, 0.262250662f, 0.266355604f, 0.270497799f, 0.274677306f,
+    0.278894275f, 0.283148736f, 0.287440836f, 0.291770637f, 0.296138257f, 0.300543785f,
+    0.304987311f, 0.309468925f, 0.313988715f, 0.318546772f, 0.323143214f, 0.327778101f,
+    0.332451522f, 0.337163627f, 0.341914415f, 0.346704066f, 0.351532608f, 0.356400132f,
+    0.361306787f, 0.366252601f, 0.371237695f, 0.376262128f, 0.38132602f, 0.386429429f,
+    0.391572475f, 0.396755219f, 0.401977777f, 0.407240212f, 0.412542611f, 0.417885065f,
+    0.423267663f, 0.428690493f, 0.434153646f, 0.439657182f, 0.445201188f, 0.450785786f,
+    0.456411034f, 0.462076992f, 0.467783809f, 0.473531485f, 0.479320168f, 0.48514995f,
+    0.491020858f, 0.496932983f, 0.502886474f, 0.50888133f, 0.514917672f, 0.520995557f,
+    0.527115107f, 0.533276379f, 0.539479494f, 0.545724452f, 0.55201143f, 0.558340371f,
+    0.564711511f, 0.571124852f, 0.577580452f, 0.584078431f, 0.590618849f, 0.597201765f,
+    0.603827357f, 0.610495567f, 0.617206573f, 0.623960376f, 0.630757153f, 0.637596846f,
+    0.644479692f, 0.651405632f, 0.658374846f, 0.665387273f, 0.672443151f, 0.679542482f,
+    0.686685324f, 0.693871737f, 0.701101899f, 0.708375752f, 0.715693474f, 0.723055124f,
+    0.730460763f, 0.73791039f, 0.745404184f, 0.752942204f, 0.760524511f, 0.768151164f,
+    0.775822222f, 0.783537805f, 0.791297913f, 0.799102724f, 0.806952238f, 0.814846575f,
+    0.822785735f, 0.830769897f, 0.838799f, 0.846873224f, 0.854992628f, 0.863157213f,
+    0.871367097f, 0.8796224f, 0.887923121f, 0.896269381f, 0.904661179f, 0.913098633f,
+    0.921581864f, 0.930110872f, 0.938685715f, 0.947306514f, 0.955973327f, 0.964686275f,
+    0.973445296f, 0.982250571f, 0.991102099f, 1.0f,
+};
+
+static const uint16_t qoi_srgb_to_linear_f16[256] = {
+    0x0000, 0x0CF9, 0x10F9, 0x1376, 0x14F9, 0x1637, 0x1776, 0x185A, 0x18F9, 0x1998, 0x1A37, 0x1ADB,
+    0x1B88, 0x1C1F, 0x1C7F, 0x1CE4, 0x1D4E, 0x1DBD, 0x1E32, 0x1EAB, 0x1F2A, 0x1FAE, 0x201C, 0x2063,
+    0x20AD, 0x20FA, 0x214A, 0x219D, 0x21F2, 0x224A, 0x22A6, 0x2304, 0x2365, 0x23C9, 0x2418, 0x244D,
+    0x2484, 0x24BC, 0x24F6, 0x2532, 0x256F, 0x25AD, 0x25ED, 0x262F, 0x2673, 0x26B8, 0x26FF, 0x2747,
+    0x2791, 0x27DD, 0x2815, 0x283D, 0x2865, 0x288F, 0x28B9, 0x28E4, 0x2910, 0x293D, 0x296A, 0x2999,
+    0x29C9, 0x29F9, 0x2A2A, 0x2A5D, 0x2A90, 0x2AC4, 0x2AF9, 0x2B2F, 0x2B66, 0x2B9E, 0x2BD7, 0x2C08,
+    0x2C26, 0x2C44, 0x2C62, 0x2C81, 0x2CA0, 0x2CC0, 0x2CE0, 0x2D01, 0x2D22, 0x2D44, 0x2D66, 0x2D89,
+    0x2DAD, 0x2DD0, 0x2DF5, 0x2E1A, 0x2E3F, 0x2E65, 0x2E8B, 0x2EB2, 0x2ED9, 0x2F01, 0x2F2A, 0x2F53,
+    0x2F7C, 0x2FA7, 0x2FD1, 0x2FFC, 0x3014, 0x302A, 0x3040, 0x3057, 0x306E, 0x3085, 0x309D, 0x30B4,
+    0x30CC, 0x30E5, 0x30FD, 0x3116, 0x312F, 0x3149, 0x3162, 0x317C, 0x3197, 0x31B1, 0x31CC, 0x31E7,
+    0x3203, 0x321E, 0x323A, 0x3257, 0x3273, 0x3290, 0x32AD, 0x32CB, 0x32E8, 0x3306, 0x3325, 0x3343,
+    0x3362, 0x3381, 0x33A1, 0x33C1, 0x33E1, 0x3401, 0x3411, 0x3422, 0x3432, 0x3443, 0x3454, 0x3465,
+    0x3476, 0x3488, 0x3499, 0x34AB, 0x34BD, 0x34CF, 0x34E1, 0x34F4, 0x3506, 0x3519, 0x352C, 0x353F,
+    0x3552, 0x3565, 0x3578, 0x358C, 0x35A0, 0x35B4, 0x35C8, 0x35DC, 0x35F1, 0x3605, 0x361A, 0x362F,
+    0x3644, 0x3659, 0x366F, 0x3684, 0x369A, 0x36B0, 0x36C6, 0x36DC, 0x36F2, 0x3709, 0x3720, 0x3736,
+    0x374D, 0x3765, 0x377C, 0x3794, 0x37AB, 0x37C3, 0x37DB, 0x37F3, 0x3806, 0x3812, 0x381F, 0x382B,
+    0x3838, 0x3844, 0x3851, 0x385E, 0x386B, 0x3877, 0x3885, 0x3892, 0x389F, 0x38AC, 0x38BA, 0x38C7,
+    0x38D5, 0x38E2, 0x38F0, 0x38FE, 0x390C, 0x391A, 0x3928, 0x3936, 0x3944, 0x3953, 0x3961, 0x3970,
+    0x397E, 0x398D, 0x399C, 0x39AB, 0x39BA, 0x39C9, 0x39D8, 0x39E7, 0x39F7, 0x3A06, 0x3A16, 0x3A25,
+    0x3A35, 0x3A45, 0x3A55, 0x3A65, 0x3A75, 0x3A85, 0x3A95, 0x3AA5, 0x3AB6, 0x3AC6, 0x3AD7, 0x3AE8,
+    0x3AF9, 0x3B09, 0x3B1A, 0x3B2C, 0x3B3D, 0x3B4E, 0x3B5F, 0x3B71, 0x3B82, 0x3B94, 0x3BA6, 0x3BB8,
+    0x3BCA, 0x3BDC, 0x3BEE, 0x3C00,
+};
+
+// 8-bit value / 255, as float and as IEEE half.
+static const float qoi_unorm8_to_f32[256] = {
+    0.0f, 0.00392156886f, 0.00784313772f, 0.0117647061f, 0.0156862754f, 0.0196078438f,
+    0.0235294122f, 0.0274509806f, 0.0313725509f, 0.0352941193f, 0.0392156877f, 0.0431372561f,
+    0.0470588244f, 0.0509803928f, 0.0549019612f, 0.0588235296f, 0.0627451017f, 0.0666666701f,
+    0.0705882385f, 0.0745098069f, 0.0784313753f, 0.0823529437f, 0.0862745121f, 0.0901960805f,
+    0.0941176489f, 0.0980392173f, 0.101960786f, 0.105882354f, 0.109803922f, 0.113725491f,
+    0.117647059f, 0.121568628f, 0.125490203f, 0.129411772f, 0.13333334f, 0.137254909f,
+    0.141176477f, 0.145098045f, 0.149019614f, 0.152941182f, 0.156862751f, 0.160784319f,
+    0.164705887f, 0.168627456f, 0.172549024f, 0.176470593f, 0.180392161f, 0.184313729f,
+    0.188235298f, 0.192156866f, 0.196078435f, 0.200000003f, 0.203921571f, 0.20784314f,
+    0.211764708f, 0.215686277f, 0.219607845f, 0.223529413f, 0.227450982f, 0.23137255f,
+    0.235294119f, 0.239215687f, 0.243137255f, 0.247058824f, 0.250980407f, 0.254901975f,
+    0.258823544f, 0.262745112f, 0.266666681f, 0.270588249f, 0.274509817f, 0.278431386f,
+    0.282352954f, 0.286274523f, 0.290196091f, 0.294117659f, 0.298039228f, 0.301960796f,
+    0.305882365f, 0.309803933f, 0.313725501f, 0.31764707f, 0.321568638f, 0.325490206f,
+    0.329411775f, 0.333333343f, 0.337254912f, 0.34117648f, 0.345098048f, 0.349019617f,
+    0.352941185f, 0.356862754f, 0.360784322f, 0.36470589f, 0.368627459f, 0.372549027f,
+    0.376470596f, 0.380392164f, 0.384313732f, 0.388235301f, 0.392156869f, 0.396078438f,
+    0.400000006f, 0.403921574f, 0.407843143f, 0.411764711f, 0.41568628f, 0.419607848f,
+    0.423529416f, 0.427450985f, 0.431372553f, 0.435294122f, 0.43921569f, 0.443137258f,
+    0.447058827f, 0.450980395f, 0.454901963f, 0.458823532f, 0.4627451f, 0.466666669f,
+    0.470588237f, 0.474509805f, 0.478431374f, 0.482352942f, 0.486274511f, 0.490196079f,
+    0.494117647f, 0.498039216f, 0.501960814f, 0.505882382f, 0.509803951f, 0.513725519f,
+    0.517647088f, 0.521568656f, 0.525490224f, 0.529411793f, 0.533333361f, 0.53725493f,
+    0.541176498f, 0.545098066f, 0.549019635f, 0.552941203f, 0.556862772f, 0.56078434f,
+    0.564705908f, 0.568627477f, 0.572549045f, 0.576470613f, 0.580392182f, 0.58431375f,
+    0.588235319f, 0.592156887f, 0.596078455f, 0.600000024f, 0.603921592f, 0.607843161f,
+    0.611764729f, 0.615686297f, 0.619607866f, 0.623529434f, 0.627451003f, 0.631372571f,
+    0.635294139f, 0.639215708f, 0.643137276f, 0.647058845f, 0.650980413f, 0.654901981f,
+    0.65882355f, 0.662745118f, 0.666666687f, 0.670588255f, 0.674509823f, 0.678431392f,
+    0.68235296f, 0.686274529f, 0.690196097f, 0.694117665f, 0.698039234f, 0.701960802f,
+    0.70588237f, 0.709803939f, 0.713725507f, 0.717647076f, 0.721568644f, 0.725490212f,
+    0.729411781f, 0.733333349f, 0.737254918f, 0.741176486f, 0.745098054f, 0.749019623f,
+    0.752941191f, 0.75686276f, 0.760784328f, 0.764705896f, 0.768627465f, 0.772549033f,
+    0.776470602f, 0.78039217f, 0.784313738f, 0.788235307f, 0.792156875f, 0.796078444f,
+    0.800000012f, 0.80392158f, 0.807843149f, 0.811764717f, 0.815686285f, 0.819607854f,
+    0.823529422f, 0.827450991f, 0.831372559f, 0.835294127f, 0.839215696f, 0.843137264f,
+    0.847058833f, 0.850980401f, 0.854901969f, 0.858823538f, 0.862745106f, 0.866666675f,
+    0.870588243f, 0.874509811f, 0.87843138f, 0.882352948f, 0.886274517f, 0.890196085f,
+    0.894117653f, 0.898039222f, 0.90196079f, 0.905882359f, 0.909803927f, 0.913725495f,
+    0.917647064f, 0.921568632f, 0.925490201f, 0.929411769f, 0.933333337f, 0.937254906f,
+    0.941176474f, 0.945098042f, 0.949019611f, 0.952941179f, 0.956862748f, 0.960784316f,
+    0.964705884f, 0.968627453f, 0.972549021f, 0.97647059f, 0.980392158f, 0.984313726f,
+    0.988235295f, 0.992156863f, 0.996078432f, 1.0f,
+};
+
+static const uint16_t qoi_unorm8_to_f16[256] = {
+    0x0000, 0x1C04, 0x2004, 0x2206, 0x2404, 0x2505, 0x2606, 0x2707, 0x2804, 0x2885, 0x2905, 0x2986,
+    0x2A06, 0x2A87, 0x2B07, 0x2B88, 0x2C04, 0x2C44, 0x2C85, 0x2CC5, 0x2D05, 0x2D45, 0x2D86, 0x2DC6,
+    0x2E06, 0x2E46, 0x2E87, 0x2EC7, 0x2F07, 0x2F47, 0x2F88, 0x2FC8, 0x3004, 0x3024, 0x3044, 0x3064,
+    0x3085, 0x30A5, 0x30C5, 0x30E5, 0x3105, 0x3125, 0x3145, 0x3165, 0x3186, 0x31A6, 0x31C6, 0x31E6,
+    0x3206, 0x3226, 0x3246, 0x3266, 0x3287, 0x32A7, 0x32C7, 0x32E7, 0x3307, 0x3327, 0x3347, 0x3367,
+    0x3388, 0x33A8, 0x33C8, 0x33E8, 0x3404, 0x3414, 0x3424, 0x3434, 0x3444, 0x3454, 0x3464, 0x3474,
+    0x3485, 0x3495, 0x34A5, 0x34B5, 0x34C5, 0x34D5, 0x34E5, 0x34F5, 0x3505, 0x3515, 0x3525, 0x3535,
+    0x3545, 0x3555, 0x3565, 0x3575, 0x3586, 0x3596, 0x35A6, 0x35B6, 0x35C6, 0x35D6, 0x35E6, 0x35F6,
+    0x3606, 0x3616, 0x3626, 0x3636, 0x3646, 0x3656, 0x3666, 0x3676, 0x3687, 0x3697, 0x36A7, 0x36B7,
+    0x36C7, 0x36D7, 0x36E7, 0x36F7, 0x3707, 0x3717, 0x3727, 0x3737, 0x3747, 0x3757, 0x3767, 0x3777,
+    0x3788, 0x3798, 0x37A8, 0x37B8, 0x37C8, 0x37D8, 0x37E8, 0x37F8, 0x3804, 0x380C, 0x3814, 0x381C,
+    0x3824, 0x382C, 0x3834, 0x383C, 0x3844, 0x384C, 0x3854, 0x385C, 0x3864, 0x386C, 0x3874, 0x387C,
+    0x3885, 0x388D, 0x3895, 0x389D, 0x38A5, 0x38AD, 0x38B5, 0x38BD, 0x38C5, 0x38CD, 0x38D5, 0x38DD,
+    0x38E5, 0x38ED, 0x38F5, 0x38FD, 0x3905, 0x390D, 0x3915, 0x391D, 0x3925, 0x392D, 0x3935, 0x393D,
+    0x3945, 0x394D, 0x3955, 0x395D, 0x3965, 0x396D, 0x3975, 0x397D, 0x3986, 0x398E, 0x3996, 0x399E,
+    0x39A6, 0x39AE, 0x39B6, 0x39BE, 0x39C6, 0x39CE, 0x39D6, 0x39DE, 0x39E6, 0x39EE, 0x39F6, 0x39FE,
+    0x3A06, 0x3A0E, 0x3A16, 0x3A1E, 0x3A26, 0x3A2E, 0x3A36, 0x3A3E, 0x3A46, 0x3A4E, 0x3A56, 0x3A5E,
+    0x3A66, 0x3A6E, 0x3A76, 0x3A7E, 0x3A87, 0x3A8F, 0x3A97, 0x3A9F, 0x3AA7, 0x3AAF, 0x3AB7, 0x3ABF,
+    0x3AC7, 0x3ACF, 0x3AD7, 0x3ADF, 0x3AE7, 0x3AEF, 0x3AF7, 0x3AFF, 0x3B07, 0x3B0F, 0x3B17, 0x3B1F,
+    0x3B27, 0x3B2F, 0x3B37, 0x3B3F, 0x3B47, 0x3B4F, 0x3B57, 0x3B5F, 0x3B67, 0x3B6F, 0x3B77, 0x3B7F,
+    0x3B88, 0x3B90, 0x3B98, 0x3BA0, 0x3BA8, 0x3BB0, 0x3BB8, 0x3BC0, 0x3BC8, 0x3BD0, 0x3BD8, 0x3BE0,
+    0x3BE8, 0x3BF0, 0x3BF8, 0x3C00,
+};
+
+// Rounded c * a / 255, exact for all 8-bit inputs.
+static inline uint8_t qoi_premultiply_u8(uint32_t c, uint32_t a) {
+    uint32_t t = c * a + 128;
+    return (uint8_t)((t + (t >> 8)) >> 8);
+}
+
+typedef void (*qoi_premultiply_fn)(const QOIPixel *src, size_t count, uint8_t *dst);
+
+static void qoi_premultiply_scalar(const QOIPixel *src, size_t count, uint8_t *dst) {
+    for (size_t i = 0; i < count; i++, dst += 4) {
+        dst[0] = qoi_premultiply_u8(src[i].r, src[i].a);
+        dst[1] = qoi_premultiply_u8(src[i].g, src[i].a);
+        dst[2] = qoi_premultiply_u8(src[i].b, src[i].a);
+        dst[3] = src[i].a;
+    }
+}
+
+#if defined(QOI_X86_DISPATCH)
+// Four pixels per step, widened to 16-bit lanes with alpha broadcast across
+// each pixel; the original alpha bytes are blended back in.
+__attribute__((target("sse2")))
+static void qoi_premultiply_sse2(const QOIPixel *src, size_t count, uint8_t *dst) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias = _mm_set1_epi16(128);
+    const __m128i alpha_mask = _mm_set1_epi32((int)0xFF000000u);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i px = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i lo = _mm_unpacklo_epi8(px, zero);
+        __m128i hi = _mm_unpackhi_epi8(px, zero);
+        __m128i alpha_lo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, 0xFF), 0xFF);
+        __m128i alpha_hi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, 0xFF), 0xFF);
+        lo = _mm_add_epi16(_mm_mullo_epi16(lo, alpha_lo), bias);
+        hi = _mm_add_epi16(_mm_mullo_epi16(hi, alpha_hi), bias);
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+        __m128i out = _mm_packus_epi16(lo, hi);
+        out = _mm_or_si128(_mm_andnot_si128(alpha_mask, out), _mm_and_si128(alpha_mask, px));
+        _mm_storeu_si128((__m128i *)(dst + i * 4), out);
+    }
+    qoi_premultiply_scalar(src + i, count - i, dst + i * 4);
+}
+#endif
+
+static qoi_premultiply_fn qoi_detect_premultiply_kernel(void) {
+#if defined(QOI_X86_DISPATCH)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        return qoi_premultiply_sse2;
+    }
+#endif
+    return qoi_premultiply_scalar;
+}
+
+// qoi_store_pixels runs once per chunk, so the CPU is only probed on the first
+// call. Threads racing on the first call all store the same pointer.
+static qoi_premultiply_fn qoi_select_premultiply_kernel(void) {
+    static qoi_premultiply_fn kernel = NULL;
+    if (!kernel) {
+        kernel = qoi_detect_premultiply_kernel();
+    }
+    return kernel;
+}
+
+// Float to IEEE half, rounding to nearest even.
+static uint16_t qoi_float_to_half(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t mantissa = bits & 0x7FFFFF;
+    int exponent = (int)((bits >> 23) & 0xFF) - 127 + 15;
+
+    if (exponent == 0xFF - 127 + 15) {
+        return (uint16_t)(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+    }
+    if (exponent >= 31) {
+        return (uint16_t)(sign | 0x7C00);
+    }
+    if (exponent <= 0) {
+        if (exponent < -10) {
+            return (uint16_t)sign;
         }
+        mantissa |= 0x800000;
+        unsigned shift = (unsigned)(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        half += rest > halfway || (rest == halfway && (half & 1));
+        return (uint16_t)(sign | half);
+    }
+    // A carry out of the mantissa correctly bumps the exponent.
+    uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1FFF;
+    half += rest > 0x1000 || (rest == 0x1000 && (half & 1));
+    return (uint16_t)half;
+}
+
+static void qoi_store_f32(const QOIPixel *src, size_t count, uint8_t *dst, const float *color_lut, int premultiply) {
+    for (size_t i = 0; i < count; i++, dst += 16) {
+        float a = qoi_unorm8_to_f32[src[i].a];
+        float scale = premultiply ? a : 1.0f;
+        float px[4] = {
+            color_lut[src[i].r] * scale,
+            color_lut[src[i].g] * scale,
+            color_lut[src[i].b] * scale,
+            a
+        };
+        memcpy(dst, px, sizeof(px));
+    }
+}
 
-        if (byte1 == EOF) {
-            fprintf(stderr, "Error: Unexpected EOF during pixel decoding. Decoded %u of %u pixels.\n", decoded_pixel_count, num_pixels_to_decode);
-            free(decoded_pixels_data);
-            return NULL;
+static void qoi_store_f16(const QOIPixel *src, size_t count, uint8_t *dst, const uint16_t *color_lut) {
+    for (size_t i = 0; i < count; i++, dst += 8) {
+        uint64_t px = (uint64_t)color_lut[src[i].r] |
+                      (uint64_t)color_lut[src[i].g] << 16 |
+                      (uint64_t)color_lut[src[i].b] << 32 |
+                      (uint64_t)qoi_unorm8_to_f16[src[i].a] << 48;
+        memcpy(dst, &px, sizeof(px));
+    }
+}
+
+// Premultiplied halves need the product rounded once, so they go through
+// float. Stored per pixel as four uint16_t, matching qoi_store_f16().
+typedef void (*qoi_store_f16_premultiplied_fn)(const QOIPixel *src, size_t count, uint8_t *dst, const float *color_lut);
+
+static void qoi_store_f16_premultiplied_scalar(const QOIPixel *src, size_t count, uint8_t *dst, const float *color_lut) {
+    for (size_t i = 0; i < count; i++, dst += 8) {
+        float a = qoi_unorm8_to_f32[src[i].a];
+        uint16_t px[4] = {
+            qoi_float_to_half(color_lut[src[i].r] * a),
+            qoi_float_to_half(color_lut[src[i].g] * a),
+            qoi_float_to_half(color_lut[src[i].b] * a),
+            qoi_unorm8_to_f16[src[i].a]
+        };
+        memcpy(dst, px, sizeof(px));
+    }
+}
+
+#if defined(QOI_X86_DISPATCH)
+__attribute__((target("f16c")))
+static void qoi_store_f16_premultiplied_f16c(const QOIPixel *src, size_t count, uint8_t *dst, const float *color_lut) {
+    for (size_t i = 0; i < count; i++, dst += 8) {
+        // Alpha rides along as 1.0 * a.
+        __m128 px = _mm_set_ps(1.0f, color_lut[src[i].b], color_lut[src[i].g], color_lut[src[i].r]);
+        px = _mm_mul_ps(px, _mm_set1_ps(qoi_unorm8_to_f32[src[i].a]));
+        _mm_storel_epi64((__m128i *)dst, _mm_cvtps_ph(px, _MM_FROUND_TO_NEAREST_INT));
+    }
+}
+#endif
+
+static qoi_store_f16_premultiplied_fn qoi_detect_f16_premultiplied_kernel(void) {
+#if defined(QOI_X86_DISPATCH)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("f16c")) {
+        return qoi_store_f16_premultiplied_f16c;
+    }
+#endif
+    return qoi_store_f16_premultiplied_scalar;
+}
+
+// Probed once, like qoi_select_premultiply_kernel.
+static qoi_store_f16_premultiplied_fn qoi_select_f16_premultiplied_kernel(void) {
+    static qoi_store_f16_premultiplied_fn kernel = NULL;
+    if (!kernel) {
+        kernel = qoi_detect_f16_premultiplied_kernel();
+    }
+    return kernel;
+}
+
+static void qoi_store_pixels(const QOIPixel *src, size_t count, uint8_t *dst, QOIPixelLayout layout, uint8_t colorspace) {
+    int srgb = colorspace == QOI_SRGB;
+    switch (layout) {
+    case QOI_LAYOUT_RGB:
+        for (size_t i = 0; i < count; i++, dst += 3) {
+            dst[0] = src[i].r;
+            dst[1] = src[i].g;
+            dst[2] = src[i].b;
+        }
+        break;
+    case QOI_LAYOUT_BGRA:
+    case QOI_LAYOUT_BGRX:
+        for (size_t i = 0; i < count; i++, dst += 4) {
+            dst[0] = src[i].b;
+            dst[1] = src[i].g;
+            dst[2] = src[i].r;
+            dst[3] = layout == QOI_LAYOUT_BGRA ? src[i].a : 255;
         }
+        break;
+    case QOI_LAYOUT_RGBA_PREMULTIPLIED:
+        qoi_select_premultiply_kernel()(src, count, dst);
+        break;
+    case QOI_LAYOUT_RGBA16F:
+        qoi_store_f16(src, count, dst, srgb ? qoi_srgb_to_linear_f16 : qoi_unorm8_to_f16);
+        break;
+    case QOI_LAYOUT_RGBA16F_PREMULTIPLIED:
+        qoi_select_f16_premultiplied_kernel()(src, count, dst, srgb ? qoi_srgb_to_linear_f32 : qoi_unorm8_to_f32);
+        break;
+    case QOI_LAYOUT_RGBA32F:
+    case QOI_LAYOUT_RGBA32F_PREMULTIPLIED:
+        qoi_store_f32(src, count, dst, srgb ? qoi_srgb_to_linear_f32 : qoi_unorm8_to_f32,
+                      layout == QOI_LAYOUT_RGBA32F_PREMULTIPLIED);
+        break;
+    default:
+        memcpy(dst, src, count * sizeof(QOIPixel));
+        break;
+    }
+}
 
-        QOIPixel current_pixel_val = previous_pixel;
-        int pixels_in_this_chunk = 1;
+int qoi_decode_into(const uint8_t *data,
+                    size_t data_size,
+                    void *pixels,
+                    size_t row_stride,
+                    size_t pixels_capacity,
+                    QOIPixelLayout layout,
+                    uint32_t *out_width,
+                    uint32_t *out_height,
+                    uint8_t *out_channels,
+                    uint8_t *out_colorspace) {
+    if (!data || !pixels || !out_width || !out_height || !out_channels || !out_colorspace ||
+        layout < QOI_LAYOUT_RGB || layout > QOI_LAYOUT_RGBA32F_PREMULTIPLIED) {
+        return 1;
+    }
 
-        if (byte1 == QOI_OP_RGB_BYTE) {
-            unsigned char rgb_buffer[3];
-            if (fread(rgb_buffer, 1, 3, infile_ptr) != 3) { fprintf(stderr, "Error: EOF reading QOI_OP_RGB payload.\n"); free(decoded_pixels_data); return NULL; }
-            current_pixel_val.r = rgb_buffer[0];
-            current_pixel_val.g = rgb_buffer[1];
-            current_pixel_val.b = rgb_buffer[2];
-            current_pixel_val.a = previous_pixel.a;
-        } else if (byte1 == QOI_OP_RGBA_BYTE) {
-            unsigned char rgba_buffer[4];
-            if (fread(rgba_buffer, 1, 4, infile_ptr) != 4) { fprintf(stderr, "Error: EOF reading QOI_OP_RGBA payload.\n"); free(decoded_pixels_data); return NULL; }
-            current_pixel_val.r = rgba_buffer[0];
-            current_pixel_val.g = rgba_buffer[1];
-            current_pixel_val.b = rgba_buffer[2];
-            current_pixel_val.a = rgba_buffer[3];
-        } else {
-            uint8_t tag = (byte1 >> 6) & 0x03;
+    QOI_STATS_TIMER(stats_timer);
+    if (qoi_parse_header(data, data_size, out_width, out_height, out_channels, out_colorspace) != 0) {
+        return 1;
+    }
 
-            if (tag == QOI_OP_INDEX_TAG) {
-                uint8_t index_val = byte1 & 0x3F;
-                current_pixel_val = index_array[index_val];
-            } else if (tag == QOI_OP_DIFF_TAG) {
-                uint8_t dr_bias = (byte1 >> 4) & 0x03;
-                uint8_t dg_bias = (byte1 >> 2) & 0x03;
-                uint8_t db_bias = (byte1 >> 0) & 0x03;
-
-                current_pixel_val.r = previous_pixel.r + (dr_bias - 2);
-                current_pixel_val.g = previous_pixel.g + (dg_bias - 2);
-                current_pixel_val.b = previous_pixel.b + (db_bias - 2);
-                current_pixel_val.a = previous_pixel.a;
-            } else if (tag == QOI_OP_LUMA_TAG) {
-                int byte2 = fgetc(infile_ptr);
-                if (byte2 == EOF) { fprintf(stderr, "Error: EOF reading QOI_OP_LUMA byte2.\n"); free(decoded_pixels_data); return NULL; }
+    uint32_t width = *out_width;
+    uint32_t height = *out_height;
+    size_t bytes_per_pixel = qoi_layout_bytes_per_pixel(layout);
+    size_t row_bytes = (size_t)width * bytes_per_pixel;
+    if (row_bytes / bytes_per_pixel != width || row_stride < row_bytes ||
+        (height - 1) > (SIZE_MAX - row_bytes) / row_stride ||
+        pixels_capacity < (size_t)(height - 1) * row_stride + row_bytes) {
+        fprintf(stderr, "Error: Destination buffer too small for %ux%u image.\n", width, height);
+        return 1;
+    }
 
-                uint8_t dg_bias = byte1 & 0x3F;
-                uint8_t dr_dg_bias = (byte2 >> 4) & 0x0F;
-                uint8_t db_dg_bias = (byte2 >> 0) & 0x0F;
+    QOIDecodeState state;
+    qoi_decode_state_init(&state);
 
-                int dg_val = dg_bias - 32;
-                int dr_val = (dr_dg_bias - 8) + dg_val;
-                int db_val = (db_dg_bias - 8) + dg_val;
+    const uint8_t *in = data + QOI_HEADER_SIZE;
+    const uint8_t *in_end = data + data_size;
+    uint8_t *row = (uint8_t *)pixels;
+    QOIPixel chunk[QOI_CONVERT_CHUNK_PIXELS];
+    QOI_STATS_PHASE(decode, HEADER, stats_timer);
 
-                current_pixel_val.r = previous_pixel.r + dr_val;
-                current_pixel_val.g = previous_pixel.g + dg_val;
-                current_pixel_val.b = previous_pixel.b + db_val;
-                current_pixel_val.a = previous_pixel.a;
-            } else if (tag == QOI_OP_RUN_TAG) {
-                uint8_t run_length = (byte1 & 0x3F) + 1;
-                pixels_in_this_chunk = run_length;
-                current_pixel_val = previous_pixel;
-            } else {
-                fprintf(stderr, "Error: Unknown QOI tag encountered: %02x\n", tag);
-                free(decoded_pixels_data);
-                return NULL;
+    for (uint32_t y = 0; y < height; y++, row += row_stride) {
+        if (layout == QOI_LAYOUT_RGBA) {
+            if (qoi_decode_pixels(&state, &in, in_end, (QOIPixel *)row, width) != width) {
+                fprintf(stderr, "Error: Unexpected EOF during pixel decoding at row %u.\n", y);
+                return 1;
             }
+            continue;
         }
 
-        for (int i = 0; i < pixels_in_this_chunk; ++i) {
-            if (decoded_pixel_count < num_pixels_to_decode) {
-                decoded_pixels_data[decoded_pixel_count] = current_pixel_val;
-                decoded_pixel_count++;
-            } else {
-                fprintf(stderr, "Error: Decoded more pixels than specified in header. Stream may be corrupt.\n");
-                free(decoded_pixels_data);
-                return NULL;
+        for (uint32_t x = 0; x < width; ) {
+            size_t count = width - x;
+            if (count > QOI_CONVERT_CHUNK_PIXELS) {
+                count = QOI_CONVERT_CHUNK_PIXELS;
             }
+            if (qoi_decode_pixels(&state, &in, in_end, chunk, count) != count) {
+                fprintf(stderr, "Error: Unexpected EOF during pixel decoding at row %u.\n", y);
+                return 1;
+            }
+            QOI_STATS_PHASE(decode, PIXELS, stats_timer);
+            qoi_store_pixels(chunk, count, row + (size_t)x * bytes_per_pixel, layout, *out_colorspace);
+            QOI_STATS_PHASE(decode, CONVERT, stats_timer);
+            x += (uint32_t)count;
         }
+    }
 
-        uint8_t hash_idx = qoi_calculate_hash_static(current_pixel_val);
-        index_array[hash_idx] = current_pixel_val;
-        previous_pixel = current_pixel_val;
+    if (state.run_remaining > 0) {
+        fprintf(stderr, "Error: Decoded more pixels than specified in header. Stream may be corrupt.\n");
+        return 1;
+    }
+    QOI_STATS_PHASE(decode, PIXELS, stats_timer);
+    qoi_check_end_marker(in, in_end);
+    QOI_STATS_PHASE(decode, TRAILER, stats_timer);
+    return 0;
+}
+
+// Largest supported qoi_decode_scaled() reduction (1/8).
+#define QOI_MAX_SCALE_SHIFT 3
+
+// The scaled decoder keeps each pixel packed as r | g << 8 | b << 16 | a << 24
+// so it stays in one register. Block sums split it into two words of 16-bit
+// lanes: "even" (r, b) and "odd" (g, a); 64 pixels of 255 still fit a lane.
+#define QOI_SCALE_LANES 0x00FF00FFu
+
+typedef struct QOIScaleState {
+    uint32_t *sums;          // even and odd sums per output column.
+    QOIPixel *row;           // Averages for layouts other than RGBA.
+    uint32_t width;          // Source dimensions.
+    uint32_t height;
+    uint32_t out_width;
+    unsigned shift;
+    uint32_t x, y;           // Next source pixel.
+    uint32_t px;
+    uint32_t index_array[QOI_INDEX_SIZE];
+    uint8_t *dst;
+    size_t row_stride;
+    QOIPixelLayout layout;
+    uint8_t colorspace;
+} QOIScaleState;
+
+// Packed r, g, b deltas of every QOI_OP_DIFF, each byte already biased by -2.
+static const uint32_t qoi_scale_diff_delta[64] = {
+    0x00FEFEFE, 0x00FFFEFE, 0x0000FEFE, 0x0001FEFE, 0x00FEFFFE, 0x00FFFFFE, 0x0000FFFE, 0x0001FFFE,
+    0x00FE00FE, 0x00FF00FE, 0x000000FE, 0x000100FE, 0x00FE01FE, 0x00FF01FE, 0x000001FE, 0x000101FE,
+    0x00FEFEFF, 0x00FFFEFF, 0x0000FEFF, 0x0001FEFF, 0x00FEFFFF, 0x00FFFFFF, 0x0000FFFF, 0x0001FFFF,
+    0x00FE00FF, 0x00FF00FF, 0x000000FF, 0x000100FF, 0x00FE01FF, 0x00FF01FF, 0x000001FF, 0x000101FF,
+    0x00FEFE00, 0x00FFFE00, 0x0000FE00, 0x0001FE00, 0x00FEFF00, 0x00FFFF00, 0x0000FF00, 0x0001FF00,
+    0x00FE0000, 0x00FF0000, 0x00000000, 0x00010000, 0x00FE0100, 0x00FF0100, 0x00000100, 0x00010100,
+    0x00FEFE01, 0x00FFFE01, 0x0000FE01, 0x0001FE01, 0x00FEFF01, 0x00FFFF01, 0x0000FF01, 0x0001FF01,
+    0x00FE0001, 0x00FF0001, 0x00000001, 0x00010001, 0x00FE0101, 0x00FF0101, 0x00000101, 0x00010101,
+};
+
+// Adds two packed pixels byte by byte, each byte wrapping on its own.
+static inline uint32_t qoi_scale_add_bytes(uint32_t a, uint32_t b) {
+    return ((a & 0x7F7F7F7Fu) + (b & 0x7F7F7F7Fu)) ^ ((a ^ b) & 0x80808080u);
+}
+
+// qoi_hash_pixel() from the lanes: the high lane of each product collects
+// r * 3 + b * 7 and g * 5 + a * 11.
+static inline uint32_t qoi_scale_hash(uint32_t even, uint32_t odd) {
+    return (((even * (7u | 3u << 16)) >> 16) + ((odd * (11u | 5u << 16)) >> 16)) % QOI_INDEX_SIZE;
+}
+
+// Rounded sum / count as a multiply and shift; exact because sums never
+// exceed 255 * 64.
+static inline uint32_t qoi_scale_reciprocal(uint32_t count) {
+    return ((1u << 24) + count - 1) / count;
+}
+
+static inline uint32_t qoi_scale_average(uint32_t sum, uint32_t count, uint32_t reciprocal) {
+    return ((sum + count / 2) * reciprocal) >> 24;
+}
+
+// Called after each source row; writes an output row and clears the sums
+// once a block row is complete or the image ends.
+static void qoi_scale_end_row(QOIScaleState *scale) {
+    uint32_t block = 1u << scale->shift;
+    scale->x = 0;
+    scale->y++;
+    if ((scale->y & (block - 1)) != 0 && scale->y != scale->height) {
+        return;
+    }
+
+    uint32_t rows = ((scale->y - 1) & (block - 1)) + 1;
+    uint32_t full_count = rows << scale->shift;
+    uint32_t full_reciprocal = qoi_scale_reciprocal(full_count);
+    uint32_t last_columns = scale->width - ((scale->out_width - 1) << scale->shift);
+    QOIPixel *average = scale->layout == QOI_LAYOUT_RGBA ? (QOIPixel *)scale->dst : scale->row;
+    uint32_t *sum = scale->sums;
+
+    for (uint32_t column = 0; column < scale->out_width; column++, sum += 2) {
+        uint32_t count = full_count;
+        uint32_t reciprocal = full_reciprocal;
+        if (column == scale->out_width - 1 && last_columns != block) {
+            count = rows * last_columns;
+            reciprocal = qoi_scale_reciprocal(count);
+        }
+        average[column].r = (uint8_t)qoi_scale_average(sum[0] & 0xFFFF, count, reciprocal);
+        average[column].g = (uint8_t)qoi_scale_average(sum[1] & 0xFFFF, count, reciprocal);
+        average[column].b = (uint8_t)qoi_scale_average(sum[0] >> 16, count, reciprocal);
+        average[column].a = (uint8_t)qoi_scale_average(sum[1] >> 16, count, reciprocal);
+        sum[0] = sum[1] = 0;
+    }
+    if (scale->layout != QOI_LAYOUT_RGBA) {
+        qoi_store_pixels(scale->row, scale->out_width, scale->dst, scale->layout, scale->colorspace);
+    }
+    scale->dst += scale->row_stride;
+}
+
+// Adds a run to the sums of every block it covers, splitting it at row ends.
+// Returns the number of pixels left over past the end of the image.
+static uint32_t qoi_scale_add_run(QOIScaleState *scale, uint32_t run_length) {
+    uint32_t even = scale->px & QOI_SCALE_LANES;
+    uint32_t odd = (scale->px >> 8) & QOI_SCALE_LANES;
+    unsigned shift = scale->shift;
+    uint32_t block_mask = (1u << shift) - 1;
+
+    while (run_length > 0 && scale->y < scale->height) {
+        uint32_t x = scale->x;
+        uint32_t count = scale->width - x;
+        if (count > run_length) {
+            count = run_length;
+        }
+        uint32_t end = x + count;
+        uint32_t *sum = scale->sums + ((size_t)(x >> shift) << 1);
 
-        if (decoded_pixel_count == num_pixels_to_decode && stream_end_bytes_read_ahead == 0) {
-            size_t bytes_actually_read = fread(stream_end_check_buffer, 1, 8, infile_ptr);
-            if (ferror(infile_ptr)) {
-                perror("Error reading potential end-of-stream marker");
-                free(decoded_pixels_data);
+        // Partial block at the start, whole blocks, then a partial block.
+        uint32_t head = (x & block_mask) ? (block_mask + 1) - (x & block_mask) : 0;
+        if (head > count) {
+            head = count;
+        }
+        if (head > 0) {
+            sum[0] += even * head;
+            sum[1] += odd * head;
+            sum += 2;
+            x += head;
+        }
+        uint32_t blocks = (end - x) >> shift;
+        uint32_t block_even = even << shift;
+        uint32_t block_odd = odd << shift;
+        for (uint32_t i = 0; i < blocks; i++, sum += 2) {
+            sum[0] += block_even;
+            sum[1] += block_odd;
+        }
+        x += blocks << shift;
+        if (x < end) {
+            sum[0] += even * (end - x);
+            sum[1] += odd * (end - x);
+        }
+
+        run_length -= count;
+        scale->x = end;
+        if (end == scale->width) {
+            qoi_scale_end_row(scale);
+        }
+    }
+    return run_length;
+}
+
+// Decodes opcodes starting before stop until the image is complete. Every
+// opcode starting before stop must have all QOI_MAX_OPCODE_BYTES readable,
+// though it may end past stop. Returns the position after the last opcode,
+// or NULL if a run extends past the last pixel.
+static const uint8_t *qoi_scale_decode_ops(QOIScaleState *scale, const uint8_t *in, const uint8_t *stop) {
+    uint32_t px = scale->px;
+    uint32_t *index_array = scale->index_array;
+    unsigned shift = scale->shift;
+    uint32_t *sums = scale->sums;
+    uint32_t block_mask = (1u << shift) - 1;
+    uint32_t x = scale->x;
+    uint32_t width = scale->width;
+    // Running sums of the block x is in, added to sums when it is left, so
+    // consecutive pixels do not wait on each other's stores. Locals rather
+    // than scale fields throughout: stores to sums could alias them.
+    uint32_t block_even = 0, block_odd = 0;
+    uint8_t byte1;
+
+#define QOI_SCALE_FLUSH_BLOCK(column)                                       \
+    {                                                                       \
+        uint32_t *sum = sums + ((size_t)(column) << 1);                     \
+        sum[0] += block_even;                                               \
+        sum[1] += block_odd;                                                \
+        block_even = block_odd = 0;                                         \
+    }
+#define QOI_SCALE_OP_INDEX                                                  \
+    px = index_array[byte1 & 0x3F];
+#define QOI_SCALE_OP_DIFF                                                   \
+    px = qoi_scale_add_bytes(px, qoi_scale_diff_delta[byte1 & 0x3F]);
+#define QOI_SCALE_OP_LUMA                                                   \
+    {                                                                       \
+        uint8_t byte2 = *in++;                                              \
+        int dg_val = (byte1 & 0x3F) - 32;                                   \
+        int dr_val = dg_val - 8 + ((byte2 >> 4) & 0x0F);                    \
+        int db_val = dg_val - 8 + (byte2 & 0x0F);                           \
+        px = qoi_scale_add_bytes(px, ((uint32_t)dr_val & 0xFF) |            \
+                                     ((uint32_t)dg_val & 0xFF) << 8 |       \
+                                     ((uint32_t)db_val & 0xFF) << 16);      \
+    }
+#define QOI_SCALE_OP_RGB                                                    \
+    px = (px & 0xFF000000u) | (uint32_t)in[0] | (uint32_t)in[1] << 8 |      \
+         (uint32_t)in[2] << 16;                                             \
+    in += 3;
+#define QOI_SCALE_OP_RGBA                                                   \
+    px = (uint32_t)in[0] | (uint32_t)in[1] << 8 | (uint32_t)in[2] << 16 |   \
+         (uint32_t)in[3] << 24;                                             \
+    in += 4;
+#define QOI_SCALE_OP_RUN                                                    \
+    {                                                                       \
+        uint32_t run_length = (byte1 & 0x3F) + 1;                           \
+        uint32_t even = px & QOI_SCALE_LANES;                               \
+        uint32_t odd = (px >> 8) & QOI_SCALE_LANES;                         \
+        index_array[qoi_scale_hash(even, odd)] = px;                        \
+        if (run_length < width - x &&                                       \
+            ((x ^ (x + run_length - 1)) >> shift) == 0) {                   \
+            /* Common case: the whole run lands in one block. */            \
+            block_even += even * run_length;                                \
+            block_odd += odd * run_length;                                  \
+            x += run_length;                                                \
+            if ((x & block_mask) == 0) {                                    \
+                QOI_SCALE_FLUSH_BLOCK((x - 1) >> shift)                     \
+            }                                                               \
+        } else {                                                            \
+            QOI_SCALE_FLUSH_BLOCK(x >> shift)                               \
+            scale->x = x;                                                   \
+            scale->px = px;                                                 \
+            if (qoi_scale_add_run(scale, run_length) != 0) {                \
+                return NULL;                                                \
+            }                                                               \
+            if (scale->y == scale->height) {                                \
+                return in;                                                  \
+            }                                                               \
+            x = scale->x;                                                   \
+        }                                                                   \
+    }
+#define QOI_SCALE_EMIT_PIXEL                                                \
+    {                                                                       \
+        uint32_t even = px & QOI_SCALE_LANES;                               \
+        uint32_t odd = (px >> 8) & QOI_SCALE_LANES;                         \
+        index_array[qoi_scale_hash(even, odd)] = px;                        \
+        block_even += even;                                                 \
+        block_odd += odd;                                                   \
+        if ((++x & block_mask) == 0 || x == width) {                        \
+            QOI_SCALE_FLUSH_BLOCK((x - 1) >> shift)                         \
+            if (x == width) {                                               \
+                qoi_scale_end_row(scale);                                   \
+                x = 0;                                                      \
+                if (scale->y == scale->height) {                            \
+                    goto done;                                              \
+                }                                                           \
+            }                                                               \
+        }                                                                   \
+    }
+
+#if defined(QOI_COMPUTED_GOTO)
+    static const void *const dispatch_table[6] = {
+        __extension__ &&op_index, __extension__ &&op_diff, __extension__ &&op_luma,
+        __extension__ &&op_run, __extension__ &&op_rgb, __extension__ &&op_rgba
+    };
+#define QOI_SCALE_DISPATCH_NEXT()                                           \
+    if (in >= stop) {                                                       \
+        goto done;                                                          \
+    }                                                                       \
+    byte1 = *in++;                                                          \
+    __extension__ ({ goto *dispatch_table[qoi_opcode_class[byte1]]; })
+
+    QOI_SCALE_DISPATCH_NEXT();
+op_index:
+    QOI_SCALE_OP_INDEX
+    QOI_SCALE_EMIT_PIXEL
+    QOI_SCALE_DISPATCH_NEXT();
+op_diff:
+    QOI_SCALE_OP_DIFF
+    QOI_SCALE_EMIT_PIXEL
+    QOI_SCALE_DISPATCH_NEXT();
+op_luma:
+    QOI_SCALE_OP_LUMA
+    QOI_SCALE_EMIT_PIXEL
+    QOI_SCALE_DISPATCH_NEXT();
+op_run:
+    QOI_SCALE_OP_RUN
+    QOI_SCALE_DISPATCH_NEXT();
+op_rgb:
+    QOI_SCALE_OP_RGB
+    QOI_SCALE_EMIT_PIXEL
+    QOI_SCALE_DISPATCH_NEXT();
+op_rgba:
+    QOI_SCALE_OP_RGBA
+    QOI_SCALE_EMIT_PIXEL
+    QOI_SCALE_DISPATCH_NEXT();
+#undef QOI_SCALE_DISPATCH_NEXT
+#else
+    while (in < stop) {
+        byte1 = *in++;
+        switch (qoi_opcode_class[byte1]) {
+        case QOI_CLASS_INDEX: QOI_SCALE_OP_INDEX QOI_SCALE_EMIT_PIXEL break;
+        case QOI_CLASS_DIFF:  QOI_SCALE_OP_DIFF  QOI_SCALE_EMIT_PIXEL break;
+        case QOI_CLASS_LUMA:  QOI_SCALE_OP_LUMA  QOI_SCALE_EMIT_PIXEL break;
+        case QOI_CLASS_RUN:   QOI_SCALE_OP_RUN                       break;
+        case QOI_CLASS_RGB:   QOI_SCALE_OP_RGB   QOI_SCALE_EMIT_PIXEL break;
+        default:              QOI_SCALE_OP_RGBA  QOI_SCALE_EMIT_PIXEL break;
+        }
+    }
+#endif
+
+done:
+    QOI_SCALE_FLUSH_BLOCK(x >> shift)
+    scale->px = px;
+    scale->x = x;
+    return in;
+
+#undef QOI_SCALE_FLUSH_BLOCK
+#undef QOI_SCALE_OP_INDEX
+#undef QOI_SCALE_OP_DIFF
+#undef QOI_SCALE_OP_LUMA
+#undef QOI_SCALE_OP_RGB
+#undef QOI_SCALE_OP_RGBA
+#undef QOI_SCALE_OP_RUN
+#undef QOI_SCALE_EMIT_PIXEL
+}
+
+int qoi_decode_scaled(const uint8_t *data,
+                      size_t data_size,
+                      unsigned scale_shift,
+                      void *pixels,
+                      size_t row_stride,
+                      size_t pixels_capacity,
+                      QOIPixelLayout layout,
+                      uint32_t *out_width,
+                      uint32_t *out_height,
+                      uint8_t *out_channels,
+                      uint8_t *out_colorspace) {
+    if (!data || !pixels || !out_width || !out_height || !out_channels || !out_colorspace ||
+        scale_shift > QOI_MAX_SCALE_SHIFT || layout < QOI_LAYOUT_RGB || layout > QOI_LAYOUT_RGBA32F_PREMULTIPLIED) {
+        return 1;
+    }
+
+    uint32_t width, height;
+    if (qoi_parse_header(data, data_size, &width, &height, out_channels, out_colorspace) != 0) {
+        return 1;
+    }
+
+    uint32_t block = 1u << scale_shift;
+    uint32_t scaled_width = (uint32_t)(((uint64_t)width + block - 1) >> scale_shift);
+    uint32_t scaled_height = (uint32_t)(((uint64_t)height + block - 1) >> scale_shift);
+    *out_width = scaled_width;
+    *out_height = scaled_height;
+
+    size_t bytes_per_pixel = qoi_layout_bytes_per_pixel(layout);
+    size_t row_bytes = (size_t)scaled_width * bytes_per_pixel;
+    if (row_bytes / bytes_per_pixel != scaled_width || row_stride < row_bytes ||
+        (scaled_height - 1) > (SIZE_MAX - row_bytes) / row_stride ||
+        pixels_capacity < (size_t)(scaled_height - 1) * row_stride + row_bytes) {
+        fprintf(stderr, "Error: Destination buffer too small for %ux%u image.\n", scaled_width, scaled_height);
+        return 1;
+    }
+
+    QOIScaleState *scale = (QOIScaleState *)malloc(sizeof(QOIScaleState));
+    uint32_t *sums = (uint32_t *)calloc(scaled_width, 2 * sizeof(uint32_t));
+    QOIPixel *row = layout != QOI_LAYOUT_RGBA
+        ? (QOIPixel *)malloc((size_t)scaled_width * sizeof(QOIPixel))
+        : NULL;
+    if (!scale || !sums || (layout != QOI_LAYOUT_RGBA && !row)) {
+        fprintf(stderr, "Error: Could not allocate memory for scaled decoding.\n");
+        free(scale);
+        free(sums);
+        free(row);
+        return 1;
+    }
+    scale->sums = sums;
+    scale->row = row;
+    scale->width = width;
+    scale->height = height;
+    scale->out_width = scaled_width;
+    scale->shift = scale_shift;
+    scale->x = 0;
+    scale->y = 0;
+    scale->px = 0xFF000000u;
+    memset(scale->index_array, 0, sizeof(scale->index_array));
+    scale->dst = (uint8_t *)pixels;
+    scale->row_stride = row_stride;
+    scale->layout = layout;
+    scale->colorspace = *out_colorspace;
+
+    // Decode in place while a whole opcode is always readable, then finish
+    // from a zero-padded copy of the last few bytes; an opcode that reads
+    // into the padding means the input is truncated.
+    const uint8_t *in = data + QOI_HEADER_SIZE;
+    const uint8_t *in_end = data + data_size;
+    int truncated = 0;
+    if (in_end - in >= QOI_MAX_OPCODE_BYTES) {
+        in = qoi_scale_decode_ops(scale, in, in_end - (QOI_MAX_OPCODE_BYTES - 1));
+    }
+    if (in && scale->y < height) {
+        uint8_t tail[2 * QOI_MAX_OPCODE_BYTES] = {0};
+        size_t tail_size = (size_t)(in_end - in);
+        memcpy(tail, in, tail_size);
+        const uint8_t *tail_in = qoi_scale_decode_ops(scale, tail, tail + tail_size);
+        if (!tail_in) {
+            in = NULL;
+        } else if (tail_in > tail + tail_size) {
+            truncated = 1;
+        } else {
+            in += tail_in - tail;
+        }
+    }
+    uint32_t rows_decoded = scale->y;
+    free(sums);
+    free(row);
+    free(scale);
+
+    if (!in) {
+        fprintf(stderr, "Error: Decoded more pixels than specified in header. Stream may be corrupt.\n");
+        return 1;
+    }
+    if (truncated || rows_decoded < height) {
+        fprintf(stderr, "Error: Unexpected EOF during pixel decoding at row %u.\n", rows_decoded);
+        return 1;
+    }
+    qoi_check_end_marker(in, in_end);
+    return 0;
+}
+
+QOIPixel* qoi_decode_from_file(FILE *infile_ptr,
+                               uint32_t *out_width,
+                               uint32_t *out_height,
+                               uint8_t *out_channels,
+                               uint8_t *out_colorspace) {
+    if (!infile_ptr || !out_width || !out_height || !out_channels || !out_colorspace) {
+        return NULL;
+    }
+
+    size_t file_capacity = 64 * 1024;
+    size_t file_size = 0;
+    uint8_t *file_data = (uint8_t *)malloc(file_capacity);
+    if (file_data == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for QOI file data.\n");
+        return NULL;
+    }
+
+    for (;;) {
+        if (file_size == file_capacity) {
+            if (file_capacity > SIZE_MAX / 2) {
+                fprintf(stderr, "Error: QOI file too large to read into memory.\n");
+                free(file_data);
+                return NULL;
+            }
+            uint8_t *grown_data = (uint8_t *)realloc(file_data, file_capacity * 2);
+            if (grown_data == NULL) {
+                fprintf(stderr, "Error: Could not allocate memory for QOI file data.\n");
+                free(file_data);
                 return NULL;
             }
-            stream_end_bytes_read_ahead = bytes_actually_read;
+            file_data = grown_data;
+            file_capacity *= 2;
+        }
+        size_t bytes_read = fread(file_data + file_size, 1, file_capacity - file_size, infile_ptr);
+        file_size += bytes_read;
+        if (bytes_read == 0) {
+            break;
         }
     }
 
-    if (decoded_pixel_count != num_pixels_to_decode) {
-        fprintf(stderr, "Error: Decoded pixel count (%u) does not match expected (%u).\n", decoded_pixel_count, num_pixels_to_decode);
-        free(decoded_pixels_data);
+    if (ferror(infile_ptr)) {
+        perror("Error reading QOI file");
+        free(file_data);
         return NULL;
     }
 
-    const unsigned char QOI_END_MARKER[8] = {0,0,0,0,0,0,0,1};
-    if (stream_end_bytes_read_ahead == 8) {
-        if (memcmp(stream_end_check_buffer, QOI_END_MARKER, 8) != 0) {
-            fprintf(stderr, "Warning: End-of-stream marker mismatch. File might be corrupt or have extra data.\n");
-        }
-    } else {
-        fprintf(stderr, "Warning: Could not fully read/verify end-of-stream marker (read %d bytes of 8). File might be truncated.\n", stream_end_bytes_read_ahead);
+    QOIPixel *decoded_pixels_data = qoi_decode_from_memory(file_data, file_size,
+                                                           out_width, out_height,
+                                                           out_channels, out_colorspace);
+    free(file_data);
+    return decoded_pixels_data;
+}
+
+QOIPixel* qoi_decode_path(const char *path,
+                          uint32_t *out_width,
+                          uint32_t *out_height,
+                          uint8_t *out_channels,
+                          uint8_t *out_colorspace) {
+    if (!path || !out_width || !out_height || !out_channels || !out_colorspace) {
+        return NULL;
     }
 
-    if (stream_end_bytes_read_ahead == 8) {
-        if (fgetc(infile_ptr) != EOF) {
-            fprintf(stderr, "Warning: Additional data found after QOI end-of-stream marker.\n");
-        }
+#if defined(_WIN32)
+    FILE *infile_ptr = fopen(path, "rb");
+    if (!infile_ptr) {
+        perror("Error opening QOI file");
+        return NULL;
+    }
+    QOIPixel *decoded_pixels_data = qoi_decode_from_file(infile_ptr, out_width, out_height,
+                                                         out_channels, out_colorspace);
+    fclose(infile_ptr);
+    return decoded_pixels_data;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("Error opening QOI file");
+        return NULL;
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+        perror("Error reading QOI file size");
+        close(fd);
+        return NULL;
+    }
+    if (file_stat.st_size < QOI_HEADER_SIZE + QOI_PADDING_SIZE ||
+        (unsigned long long)file_stat.st_size > SIZE_MAX) {
+        fprintf(stderr, "Error: QOI file '%s' has invalid size.\n", path);
+        close(fd);
+        return NULL;
+    }
+    size_t file_size = (size_t)file_stat.st_size;
+
+    void *mapping = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        perror("Error mapping QOI file");
+        return NULL;
+    }
+    posix_madvise(mapping, file_size, POSIX_MADV_SEQUENTIAL);
+
+    const uint8_t *data = (const uint8_t *)mapping;
+    // Stop the opcode loop short of a well-formed end marker; the trailer is
+    // still checked from the last opcode, exactly as qoi_decode_from_memory does.
+    size_t opcode_bytes = file_size;
+    if (memcmp(data + file_size - QOI_PADDING_SIZE, QOI_END_MARKER, QOI_PADDING_SIZE) == 0) {
+        opcode_bytes -= QOI_PADDING_SIZE;
     }
 
+    QOIPixel *decoded_pixels_data = qoi_decode_buffer(data, opcode_bytes, data + file_size, out_width, out_height,
+                                                      out_channels, out_colorspace);
+    munmap(mapping, file_size);
     return decoded_pixels_data;
+#endif
 }
\ No newline at end of file
@@ -1,137 +1,376 @@
-#include "qoi_utils.h"
+#include "qoi_internal.h"
+#include <stdlib.h>
 #include <string.h>
 
-static uint8_t qoi_hash_pixel(QOIPixel px) {
-    return (px.r * 3 + px.g * 5 + px.b * 7 + px.a * 11) % QOI_INDEX_SIZE;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define QOI_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+// Returns how many leading pixels of the span equal value in every byte that
+// is set in mask.
+typedef size_t (*qoi_run_length_fn)(const QOIPixel *pixels, size_t count, QOIPixel value, QOIPixel mask);
+
+static size_t qoi_run_length_scalar(const QOIPixel *pixels, size_t count, QOIPixel value, QOIPixel mask) {
+    uint32_t packed_value, packed_mask;
+    memcpy(&packed_value, &value, sizeof(packed_value));
+    memcpy(&packed_mask, &mask, sizeof(packed_mask));
+    packed_value &= packed_mask;
+
+    size_t run = 0;
+    for (; run < count; run++) {
+        uint32_t packed_pixel;
+        memcpy(&packed_pixel, &pixels[run], sizeof(packed_pixel));
+        if ((packed_pixel & packed_mask) != packed_value) {
+            break;
+        }
+    }
+    return run;
+}
+
+#if defined(QOI_X86_DISPATCH)
+__attribute__((target("sse2")))
+static size_t qoi_run_length_sse2(const QOIPixel *pixels, size_t count, QOIPixel value, QOIPixel mask) {
+    uint32_t packed_value, packed_mask;
+    memcpy(&packed_value, &value, sizeof(packed_value));
+    memcpy(&packed_mask, &mask, sizeof(packed_mask));
+    const __m128i needle = _mm_set1_epi32((int)(packed_value & packed_mask));
+    const __m128i lanes = _mm_set1_epi32((int)packed_mask);
+
+    size_t run = 0;
+    while (count - run >= 4) {
+        __m128i block = _mm_and_si128(_mm_loadu_si128((const __m128i *)(pixels + run)), lanes);
+        unsigned mismatch = ~(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi32(block, needle)) & 0xFFFF;
+        if (mismatch) {
+            return run + (size_t)(__builtin_ctz(mismatch) / 4);
+        }
+        run += 4;
+    }
+    return run + qoi_run_length_scalar(pixels + run, count - run, value, mask);
+}
+
+__attribute__((target("avx2")))
+static size_t qoi_run_length_avx2(const QOIPixel *pixels, size_t count, QOIPixel value, QOIPixel mask) {
+    uint32_t packed_value, packed_mask;
+    memcpy(&packed_value, &value, sizeof(packed_value));
+    memcpy(&packed_mask, &mask, sizeof(packed_mask));
+    const __m256i needle = _mm256_set1_epi32((int)(packed_value & packed_mask));
+    const __m256i lanes = _mm256_set1_epi32((int)packed_mask);
+
+    size_t run = 0;
+    while (count - run >= 8) {
+        __m256i block = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(pixels + run)), lanes);
+        unsigned mismatch = ~(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi32(block, needle));
+        if (mismatch) {
+            return run + (size_t)(__builtin_ctz(mismatch) / 4);
+        }
+        run += 8;
+    }
+    return run + qoi_run_length_sse2(pixels + run, count - run, value, mask);
 }
+#endif
 
-static int qoi_pixels_are_equal(QOIPixel p1, QOIPixel p2) {
-    return (p1.r == p2.r && p1.g == p2.g && p1.b == p2.b && p1.a == p2.a);
+static qoi_run_length_fn qoi_detect_run_length_kernel(void) {
+#if defined(QOI_X86_DISPATCH)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return qoi_run_length_avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return qoi_run_length_sse2;
+    }
+#endif
+    return qoi_run_length_scalar;
+}
+
+// The row-at-a-time encoders come through here once per span, so the CPU is
+// only probed on the first call. Threads racing on the first call all store
+// the same pointer.
+static qoi_run_length_fn qoi_select_run_length_kernel(void) {
+    static qoi_run_length_fn kernel = NULL;
+    if (!kernel) {
+        kernel = qoi_detect_run_length_kernel();
+    }
+    return kernel;
 }
 
-static uint8_t qoi_make_chunk(uint8_t two_bit_tag, uint8_t payload) {
-    return (two_bit_tag << 6) | payload;
+// Run detection for tightly packed 3-byte RGB input.
+static size_t qoi_run_length_rgb(const uint8_t *src, size_t count, QOIPixel value) {
+    size_t run = 0;
+    while (run < count && src[0] == value.r && src[1] == value.g && src[2] == value.b) {
+        run++;
+        src += 3;
+    }
+    return run;
+}
+
+// Shared source of the specialised encoder kernels. channels (3 or 4) and
+// src_bytes (3 for packed RGB, 4 for QOIPixel) are constants at each
+// instantiation below, so every alpha and layout test is resolved at compile
+// time. Runs are measured with the widest kernel the CPU supports and emitted
+// in bulk; every other pixel goes through the scalar encoder step.
+static QOI_ALWAYS_INLINE uint8_t *qoi_encode_span_template(QOIEncodeState *state,
+                                                           const uint8_t *src,
+                                                           size_t count,
+                                                           uint8_t *out,
+                                                           qoi_run_length_fn run_length,
+                                                           const int channels,
+                                                           const int src_bytes) {
+    QOIPixel mask, opaque = {0, 0, 0, 255};
+    mask.r = mask.g = mask.b = 255;
+    mask.a = channels == 3 ? 0 : 255;
+    uint32_t packed_opaque;
+    memcpy(&packed_opaque, &opaque, sizeof(packed_opaque));
+
+    size_t px_index = 0;
+    while (px_index < count) {
+        for (; px_index < count; px_index++) {
+            const uint8_t *px = src + px_index * src_bytes;
+            QOIPixel current_pixel;
+            if (src_bytes == 4) {
+                uint32_t packed_current, packed_previous;
+                memcpy(&packed_current, px, sizeof(packed_current));
+                if (channels == 3) {
+                    packed_current |= packed_opaque;
+                }
+                memcpy(&packed_previous, &state->previous_pixel, sizeof(packed_previous));
+                if (packed_current == packed_previous) {
+                    break;
+                }
+                memcpy(&current_pixel, &packed_current, sizeof(current_pixel));
+            } else {
+                // previous_pixel is always opaque on this path.
+                if (px[0] == state->previous_pixel.r && px[1] == state->previous_pixel.g &&
+                    px[2] == state->previous_pixel.b) {
+                    break;
+                }
+                current_pixel.r = px[0];
+                current_pixel.g = px[1];
+                current_pixel.b = px[2];
+                current_pixel.a = 255;
+            }
+            out = qoi_encode_changed_pixel(state, current_pixel, out, src_bytes == 3 ? 3 : channels);
+        }
+        if (px_index == count) {
+            break;
+        }
+
+        size_t run;
+        if (src_bytes == 4) {
+            run = run_length((const QOIPixel *)(src + px_index * 4), count - px_index, state->previous_pixel, mask);
+        } else {
+            run = qoi_run_length_rgb(src + px_index * 3, count - px_index, state->previous_pixel);
+        }
+        out = qoi_encode_run(state, run, out);
+        px_index += run;
+    }
+    return out;
 }
 
-static void qoi_write_header(
-    uint32_t width,
-    uint32_t height,
-    uint8_t channels,
-    uint8_t colorspace,
-    FILE *outfile_ptr) {
+static uint8_t *qoi_encode_span_rgba(QOIEncodeState *state, const QOIPixel *pixels, size_t count,
+                                     uint8_t *out, qoi_run_length_fn run_length) {
+    return qoi_encode_span_template(state, (const uint8_t *)pixels, count, out, run_length, 4, 4);
+}
 
-    char magic[4] = {'q', 'o', 'i', 'f'};
-    fwrite(magic, sizeof(char), 4, outfile_ptr);
+// Opaque images: the alpha byte of the input is ignored.
+static uint8_t *qoi_encode_span_rgbx(QOIEncodeState *state, const QOIPixel *pixels, size_t count,
+                                     uint8_t *out, qoi_run_length_fn run_length) {
+    return qoi_encode_span_template(state, (const uint8_t *)pixels, count, out, run_length, 3, 4);
+}
 
-    fputc((width >> 24) & 0xFF, outfile_ptr);
-    fputc((width >> 16) & 0xFF, outfile_ptr);
-    fputc((width >> 8) & 0xFF, outfile_ptr);
-    fputc(width & 0xFF, outfile_ptr);
+static uint8_t *qoi_encode_span_rgb(QOIEncodeState *state, const uint8_t *pixels, size_t count, uint8_t *out) {
+    return qoi_encode_span_template(state, pixels, count, out, NULL, 3, 3);
+}
 
-    fputc((height >> 24) & 0xFF, outfile_ptr);
-    fputc((height >> 16) & 0xFF, outfile_ptr);
-    fputc((height >> 8) & 0xFF, outfile_ptr);
-    fputc(height & 0xFF, outfile_ptr);
+uint8_t *qoi_encode_pixels(QOIEncodeState *state,
+                           const QOIPixel *pixels,
+                           size_t count,
+                           uint8_t channels,
+                           uint8_t *out) {
+    if (channels == 3) {
+        return qoi_encode_span_rgbx(state, pixels, count, out, qoi_select_run_length_kernel());
+    }
+    return qoi_encode_span_rgba(state, pixels, count, out, qoi_select_run_length_kernel());
+}
 
-    fputc(channels, outfile_ptr);
-    fputc(colorspace, outfile_ptr);
+size_t qoi_encode_max_size(uint32_t width, uint32_t height, uint8_t channels) {
+    // QOI_OP_RGB for opaque images, QOI_OP_RGBA otherwise.
+    const size_t worst_case_bytes_per_pixel = channels == 3 ? 4 : 5;
+    if (width == 0 || height == 0) {
+        return 0;
+    }
+    if ((size_t)width > SIZE_MAX / height) {
+        return 0;
+    }
+    size_t num_pixels = (size_t)width * height;
+    if (num_pixels > (SIZE_MAX - QOI_HEADER_SIZE - QOI_PADDING_SIZE) / worst_case_bytes_per_pixel) {
+        return 0;
+    }
+    return QOI_HEADER_SIZE + num_pixels * worst_case_bytes_per_pixel + QOI_PADDING_SIZE;
 }
 
-int qoi_encode_to_file(const QOIPixel *image_data,
-                       uint32_t width,
-                       uint32_t height,
-                       uint8_t channels,
-                       uint8_t colorspace,
-                       FILE *outfile_ptr) {
+int qoi_encode_to_memory(const QOIPixel *image_data,
+                         uint32_t width,
+                         uint32_t height,
+                         uint8_t channels,
+                         uint8_t colorspace,
+                         uint8_t *out_buffer,
+                         size_t out_capacity,
+                         size_t *out_size) {
 
-    if (!image_data || !outfile_ptr || width == 0 || height == 0) {
+    if (!image_data || !out_buffer || !out_size || width == 0 || height == 0) {
         return 1;
     }
 
-    uint32_t num_pixels = width * height;
+    size_t required_capacity = qoi_encode_max_size(width, height, channels);
+    if (required_capacity == 0 || out_capacity < required_capacity) {
+        return 1;
+    }
 
-    qoi_write_header(width, height, channels, colorspace, outfile_ptr);
+    // qoi_encode_max_size() has checked that the count fits a size_t.
+    size_t num_pixels = (size_t)width * height;
 
-    QOIPixel previous_pixel = {0, 0, 0, 255};
-    QOIPixel index_array[QOI_INDEX_SIZE];
-    memset(index_array, 0, sizeof(index_array));
+    QOI_STATS_TIMER(stats_timer);
+    uint8_t *out = qoi_write_header(width, height, channels, colorspace, out_buffer);
 
-    uint8_t run_count = 0;
-    for (uint32_t px_index = 0; px_index < num_pixels; px_index++) {
-        QOIPixel current_pixel = image_data[px_index];
+    QOIEncodeState state;
+    qoi_encode_state_init(&state);
+    QOI_STATS_PHASE(encode, HEADER, stats_timer);
 
-        if (qoi_pixels_are_equal(current_pixel, previous_pixel)) {
-            run_count++;
-            if (run_count == QOI_MAX_RUN_LENGTH) {
-                uint8_t chunk_byte = qoi_make_chunk(QOI_OP_RUN_TAG, run_count - 1);
-                fputc(chunk_byte, outfile_ptr);
-                run_count = 0;
-            }
-        } else {
-            if (run_count > 0) {
-                uint8_t chunk_byte = qoi_make_chunk(QOI_OP_RUN_TAG, run_count - 1);
-                fputc(chunk_byte, outfile_ptr);
-                run_count = 0;
-            }
+    out = qoi_encode_pixels(&state, image_data, num_pixels, channels, out);
+    out = qoi_encode_flush_run(&state, out);
+    QOI_STATS_PHASE(encode, PIXELS, stats_timer);
 
-            uint8_t hash_idx = qoi_hash_pixel(current_pixel);
-            if (qoi_pixels_are_equal(index_array[hash_idx], current_pixel)) {
-                uint8_t chunk_byte = qoi_make_chunk(QOI_OP_INDEX_TAG, hash_idx);
-                fputc(chunk_byte, outfile_ptr);
-            } else {
-                if (previous_pixel.a == current_pixel.a) {
-                    int dr = current_pixel.r - previous_pixel.r;
-                    int dg = current_pixel.g - previous_pixel.g;
-                    int db = current_pixel.b - previous_pixel.b;
-
-                    if (dr >= -2 && dr <= 1 &&
-                        dg >= -2 && dg <= 1 &&
-                        db >= -2 && db <= 1) {
-                        uint8_t payload = ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2);
-                        uint8_t chunk_byte = qoi_make_chunk(QOI_OP_DIFF_TAG, payload);
-                        fputc(chunk_byte, outfile_ptr);
-                    } else {
-                        int dr_dg = dr - dg;
-                        int db_dg = db - dg;
-                        if (dg >= -32 && dg <= 31 &&
-                            dr_dg >= -8 && dr_dg <= 7 &&
-                            db_dg >= -8 && db_dg <= 7) {
-
-                            uint8_t chunk_byte1 = qoi_make_chunk(QOI_OP_LUMA_TAG, (uint8_t)(dg + 32));
-                            fputc(chunk_byte1, outfile_ptr);
-                            uint8_t chunk_byte2 = (uint8_t)((dr_dg + 8) << 4) | (uint8_t)(db_dg + 8);
-                            fputc(chunk_byte2, outfile_ptr);
-                        }
-                        else {
-                            fputc(QOI_OP_RGB_BYTE, outfile_ptr);
-                            fputc(current_pixel.r, outfile_ptr);
-                            fputc(current_pixel.g, outfile_ptr);
-                            fputc(current_pixel.b, outfile_ptr);
-                        }
-                    }
-                }
-                else {
-                    fputc(QOI_OP_RGBA_BYTE, outfile_ptr);
-                    fputc(current_pixel.r, outfile_ptr);
-                    fputc(current_pixel.g, outfile_ptr);
-                    fputc(current_pixel.b, outfile_ptr);
-                    fputc(current_pixel.a, outfile_ptr);
-                }
+    out = qoi_write_end_marker(out);
+    QOI_STATS_PHASE(encode, TRAILER, stats_timer);
+
+    *out_size = (size_t)(out - out_buffer);
+    return 0;
+}
+
+// Pixels converted per step for BGRA/BGRX sources.
+#define QOI_CONVERT_CHUNK_PIXELS 512
+
+static void qoi_load_pixels(const uint8_t *src, size_t count, QOIPixel *dst, QOIPixelLayout layout) {
+    switch (layout) {
+    case QOI_LAYOUT_BGRA:
+    case QOI_LAYOUT_BGRX:
+        for (size_t i = 0; i < count; i++, src += 4) {
+            dst[i].r = src[2];
+            dst[i].g = src[1];
+            dst[i].b = src[0];
+            dst[i].a = layout == QOI_LAYOUT_BGRA ? src[3] : 255;
+        }
+        break;
+    default:
+        memcpy(dst, src, count * sizeof(QOIPixel));
+        break;
+    }
+}
+
+int qoi_encode_from_layout(const void *pixels,
+                           uint32_t width,
+                           uint32_t height,
+                           size_t row_stride,
+                           QOIPixelLayout layout,
+                           uint8_t channels,
+                           uint8_t colorspace,
+                           uint8_t *out_buffer,
+                           size_t out_capacity,
+                           size_t *out_size) {
+
+    if (!pixels || !out_buffer || !out_size || width == 0 || height == 0 ||
+        layout < QOI_LAYOUT_RGB || layout > QOI_LAYOUT_BGRX) {
+        return 1;
+    }
+
+    size_t bytes_per_pixel = qoi_layout_bytes_per_pixel(layout);
+    if (row_stride / bytes_per_pixel < width) {
+        return 1;
+    }
+
+    size_t required_capacity = qoi_encode_max_size(width, height, channels);
+    if (required_capacity == 0 || out_capacity < required_capacity) {
+        return 1;
+    }
+
+    QOI_STATS_TIMER(stats_timer);
+    uint8_t *out = qoi_write_header(width, height, channels, colorspace, out_buffer);
+
+    QOIEncodeState state;
+    qoi_encode_state_init(&state);
+    qoi_run_length_fn run_length = qoi_select_run_length_kernel();
+    QOI_STATS_PHASE(encode, HEADER, stats_timer);
+
+    const uint8_t *row = (const uint8_t *)pixels;
+    QOIPixel chunk[QOI_CONVERT_CHUNK_PIXELS];
+
+    // BGRX and RGB input carry no alpha, so they always take an opaque kernel.
+    int opaque = channels == 3 || layout == QOI_LAYOUT_BGRX;
+
+    for (uint32_t y = 0; y < height; y++, row += row_stride) {
+        if (layout == QOI_LAYOUT_RGB) {
+            out = qoi_encode_span_rgb(&state, row, width, out);
+            continue;
+        }
+        if (layout == QOI_LAYOUT_RGBA) {
+            out = opaque ? qoi_encode_span_rgbx(&state, (const QOIPixel *)row, width, out, run_length)
+                         : qoi_encode_span_rgba(&state, (const QOIPixel *)row, width, out, run_length);
+            continue;
+        }
+
+        for (uint32_t x = 0; x < width; ) {
+            size_t count = width - x;
+            if (count > QOI_CONVERT_CHUNK_PIXELS) {
+                count = QOI_CONVERT_CHUNK_PIXELS;
             }
-            index_array[hash_idx] = current_pixel;
+            qoi_load_pixels(row + (size_t)x * bytes_per_pixel, count, chunk, layout);
+            QOI_STATS_PHASE(encode, CONVERT, stats_timer);
+            out = opaque ? qoi_encode_span_rgbx(&state, chunk, count, out, run_length)
+                         : qoi_encode_span_rgba(&state, chunk, count, out, run_length);
+            QOI_STATS_PHASE(encode, PIXELS, stats_timer);
+            x += (uint32_t)count;
         }
-        previous_pixel = current_pixel;
     }
+    out = qoi_encode_flush_run(&state, out);
+    QOI_STATS_PHASE(encode, PIXELS, stats_timer);
+
+    out = qoi_write_end_marker(out);
+    QOI_STATS_PHASE(encode, TRAILER, stats_timer);
 
-    if (run_count > 0) {
-        uint8_t chunk_byte = qoi_make_chunk(QOI_OP_RUN_TAG, run_count - 1);
-        fputc(chunk_byte, outfile_ptr);
+    *out_size = (size_t)(out - out_buffer);
+    return 0;
+}
+
+int qoi_encode_to_file(const QOIPixel *image_data,
+                       uint32_t width,
+                       uint32_t height,
+                       uint8_t channels,
+                       uint8_t colorspace,
+                       FILE *outfile_ptr) {
+
+    if (!image_data || !outfile_ptr || width == 0 || height == 0) {
+        return 1;
     }
 
-    const uint8_t END_OF_STREAM[8] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01};
-    fwrite(END_OF_STREAM, sizeof(uint8_t), 8, outfile_ptr);
+    size_t buffer_capacity = qoi_encode_max_size(width, height, channels);
+    if (buffer_capacity == 0) {
+        return 1;
+    }
+    uint8_t *encoded_buffer = (uint8_t *)malloc(buffer_capacity);
+    if (!encoded_buffer) {
+        return 1;
+    }
+
+    size_t encoded_size = 0;
+    int status = qoi_encode_to_memory(image_data, width, height, channels, colorspace,
+                                      encoded_buffer, buffer_capacity, &encoded_size);
+    if (status == 0 && fwrite(encoded_buffer, 1, encoded_size, outfile_ptr) != encoded_size) {
+        status = 1;
+    }
+    free(encoded_buffer);
 
-    if (ferror(outfile_ptr)) {
+    if (status != 0 || ferror(outfile_ptr)) {
         return 1;
     }
 
@@ -0,0 +1,221 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L
+#endif
+#if !defined(_FILE_OFFSET_BITS)
+#define _FILE_OFFSET_BITS 64
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+#include "qoi_stream.h"
+
+// 72000 x 60000 is 4.32 gigapixels, past the 2^32 pixel count.
+#define DEFAULT_WIDTH 72000
+#define DEFAULT_HEIGHT 60000
+#define DEFAULT_STRIP_ROWS 16
+
+typedef struct Generator {
+    uint32_t width, height;
+    uint32_t strip_rows;
+    QOIPixel *strip;
+    uint64_t checksum;
+    double seconds;          // Spent generating rows.
+} Generator;
+
+typedef struct Checker {
+    uint32_t width;
+    uint32_t rows;
+    uint64_t checksum;
+} Checker;
+
+static double now_seconds(void) {
+#if defined(_WIN32)
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+// Mosaic-like content: 64x64 tiles of random color with a shallow gradient
+// that steps every 8 pixels, giving runs, diffs and a few full pixels.
+static void generate_row(QOIPixel *row, uint32_t width, uint32_t y) {
+    uint32_t band = (y >> 6) * 0x9E3779B1u;
+    for (uint32_t x = 0; x < width; x++) {
+        uint32_t tile = ((x >> 6) * 0x85EBCA77u) ^ band;
+        uint32_t shade = ((x & 63) + (y & 63)) >> 3;
+        row[x].r = (uint8_t)(tile + shade);
+        row[x].g = (uint8_t)((tile >> 8) + shade);
+        row[x].b = (uint8_t)((tile >> 16) + shade);
+        row[x].a = 255;
+    }
+}
+
+// Order-sensitive within and across rows, cheap enough not to dominate.
+static uint64_t checksum_row(uint64_t checksum, const QOIPixel *row, uint32_t width, uint32_t y) {
+    uint64_t sum = 0;
+    for (uint32_t x = 0; x < width; x++) {
+        uint32_t px;
+        memcpy(&px, &row[x], sizeof(px));
+        sum += (uint64_t)px * (x + 1);
+    }
+    return checksum * 0x100000001B3ull + sum + y;
+}
+
+static int generate_rows(uint32_t y,
+                         const QOIPixel **rows,
+                         uint32_t *row_count,
+                         size_t *row_stride,
+                         void *user_data) {
+    Generator *generator = (Generator *)user_data;
+    uint32_t count = generator->height - y < generator->strip_rows ? generator->height - y : generator->strip_rows;
+    double start = now_seconds();
+    for (uint32_t i = 0; i < count; i++) {
+        QOIPixel *row = generator->strip + (size_t)i * generator->width;
+        generate_row(row, generator->width, y + i);
+        generator->checksum = checksum_row(generator->checksum, row, generator->width, y + i);
+    }
+    generator->seconds += now_seconds() - start;
+    *rows = generator->strip;
+    *row_count = count;
+    *row_stride = (size_t)generator->width * sizeof(QOIPixel);
+    return 0;
+}
+
+static int check_row(const QOIPixel *row, uint32_t y, void *user_data) {
+    Checker *checker = (Checker *)user_data;
+    checker->checksum = checksum_row(checker->checksum, row, checker->width, y);
+    checker->rows++;
+    return 0;
+}
+
+static void print_usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "Encodes a synthetic image row by row to a file, decodes it back the same way\n"
+            "and reports throughput; the image is never held in memory.\n"
+            "  -W <width>   image width (default %u)\n"
+            "  -H <height>  image height (default %u)\n"
+            "  -r <rows>    rows per strip handed to the encoder (default %u)\n"
+            "  -o <path>    output file (default qoi_gigapixel.qoi)\n"
+            "  --keep       keep the output file\n",
+            program, DEFAULT_WIDTH, DEFAULT_HEIGHT, DEFAULT_STRIP_ROWS);
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t width = DEFAULT_WIDTH;
+    uint32_t height = DEFAULT_HEIGHT;
+    uint32_t strip_rows = DEFAULT_STRIP_ROWS;
+    const char *path = "qoi_gigapixel.qoi";
+    int keep = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "-W") == 0 || strcmp(argv[i], "-H") == 0 || strcmp(argv[i], "-r") == 0) &&
+            i + 1 < argc) {
+            // long is 32 bits on Windows, so parse wider than any dimension.
+            char *end;
+            errno = 0;
+            unsigned long long value = strtoull(argv[i + 1], &end, 10);
+            if (errno != 0 || end == argv[i + 1] || *end != '\0' || argv[i + 1][0] == '-' ||
+                value == 0 || value > UINT32_MAX) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            if (argv[i][1] == 'W') {
+                width = (uint32_t)value;
+            } else if (argv[i][1] == 'H') {
+                height = (uint32_t)value;
+            } else {
+                strip_rows = (uint32_t)value;
+            }
+            i++;
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            path = argv[++i];
+        } else if (strcmp(argv[i], "--keep") == 0) {
+            keep = 1;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    double pixels = (double)width * height;
+    size_t strip_pixels = (size_t)width * strip_rows;
+    if (strip_pixels / strip_rows != width || strip_pixels > SIZE_MAX / sizeof(QOIPixel)) {
+        fprintf(stderr, "Error: Strip of %u rows is too large.\n", strip_rows);
+        return 1;
+    }
+    Generator generator = {width, height, strip_rows, NULL, 0, 0.0};
+    generator.strip = (QOIPixel *)malloc(strip_pixels * sizeof(QOIPixel));
+    if (!generator.strip) {
+        fprintf(stderr, "Error: Could not allocate a strip of %u rows.\n", strip_rows);
+        return 1;
+    }
+    printf("Image: %u x %u (%.2f gigapixels), strips of %u rows, file %s\n",
+           width, height, pixels / 1e9, strip_rows, path);
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Could not create '%s'.\n", path);
+        free(generator.strip);
+        return 1;
+    }
+    uint64_t encoded_size = 0;
+    double start = now_seconds();
+    int status = qoi_encode_rows_to_fd(generate_rows, &generator, width, height, 4, 0, fd, &encoded_size);
+    double encode_seconds = now_seconds() - start;
+    if (close(fd) != 0) {
+        status = 1;
+    }
+    free(generator.strip);
+    if (status != 0) {
+        fprintf(stderr, "Error: Encoding failed.\n");
+        remove(path);
+        return 1;
+    }
+    double codec_seconds = encode_seconds - generator.seconds;
+    printf("Encode: %8.2f s  %8.1f MP/s (%.2f s generating rows, %.1f MP/s without)\n",
+           encode_seconds, pixels / encode_seconds / 1e6, generator.seconds, pixels / codec_seconds / 1e6);
+    printf("Output: %llu bytes, %.3f bytes per pixel\n",
+           (unsigned long long)encoded_size, (double)encoded_size / pixels);
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Could not open '%s'.\n", path);
+        return 1;
+    }
+    Checker checker = {width, 0, 0};
+    uint32_t decoded_width, decoded_height;
+    uint8_t channels, colorspace;
+    start = now_seconds();
+    status = qoi_decode_rows_from_fd(fd, check_row, &checker, &decoded_width, &decoded_height, &channels, &colorspace);
+    double decode_seconds = now_seconds() - start;
+    close(fd);
+    if (!keep) {
+        remove(path);
+    }
+    if (status != 0) {
+        fprintf(stderr, "Error: Decoding failed.\n");
+        return 1;
+    }
+    printf("Decode: %8.2f s  %8.1f MP/s (including the row checksum)\n",
+           decode_seconds, pixels / decode_seconds / 1e6);
+
+    int match = decoded_width == width && decoded_height == height &&
+                checker.rows == height && checker.checksum == generator.checksum;
+    printf("Round trip: %s\n", match ? "OK" : "MISMATCH");
+    return match ? 0 : 1;
+}
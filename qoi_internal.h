@@ -0,0 +1,294 @@
+#ifndef QOI_INTERNAL_H
+#define QOI_INTERNAL_H
+
+// Helpers shared between the encoder and decoder translation units.
+// Not part of the public API.
+
+#include "qoi_utils.h"
+#include <string.h>
+
+static inline uint8_t qoi_hash_pixel(QOIPixel px) {
+    return (px.r * 3 + px.g * 5 + px.b * 7 + px.a * 11) % QOI_INDEX_SIZE;
+}
+
+static inline int qoi_pixels_are_equal(QOIPixel p1, QOIPixel p2) {
+    return (p1.r == p2.r && p1.g == p2.g && p1.b == p2.b && p1.a == p2.a);
+}
+
+static inline uint8_t qoi_make_chunk(uint8_t two_bit_tag, uint8_t payload) {
+    return (two_bit_tag << 6) | payload;
+}
+
+static inline uint8_t *qoi_write_u32_be(uint8_t *out, uint32_t value) {
+    out[0] = (value >> 24) & 0xFF;
+    out[1] = (value >> 16) & 0xFF;
+    out[2] = (value >> 8) & 0xFF;
+    out[3] = value & 0xFF;
+    return out + 4;
+}
+
+static inline uint8_t *qoi_write_u64_be(uint8_t *out, uint64_t value) {
+    out = qoi_write_u32_be(out, (uint32_t)(value >> 32));
+    return qoi_write_u32_be(out, (uint32_t)value);
+}
+
+static inline uint32_t qoi_read_u32_be(const uint8_t *in) {
+    return ((uint32_t)in[0] << 24) |
+           ((uint32_t)in[1] << 16) |
+           ((uint32_t)in[2] << 8) |
+           ((uint32_t)in[3]);
+}
+
+// Every opcode byte yields at most one full run, so a header claiming more
+// pixels than payload_bytes can encode is corrupt. Lets callers reject it
+// before allocating for it.
+static inline int qoi_pixel_count_fits(uint32_t width, uint32_t height, size_t payload_bytes) {
+    return (uint64_t)width * height <= (uint64_t)payload_bytes * QOI_MAX_RUN_LENGTH;
+}
+
+static inline uint64_t qoi_read_u64_be(const uint8_t *in) {
+    return ((uint64_t)qoi_read_u32_be(in) << 32) | qoi_read_u32_be(in + 4);
+}
+
+static inline uint8_t *qoi_write_header(
+    uint32_t width,
+    uint32_t height,
+    uint8_t channels,
+    uint8_t colorspace,
+    uint8_t *out) {
+
+    *out++ = 'q';
+    *out++ = 'o';
+    *out++ = 'i';
+    *out++ = 'f';
+    out = qoi_write_u32_be(out, width);
+    out = qoi_write_u32_be(out, height);
+    *out++ = channels;
+    *out++ = colorspace;
+    return out;
+}
+
+static inline uint8_t *qoi_write_end_marker(uint8_t *out) {
+    const uint8_t END_OF_STREAM[8] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01};
+    memcpy(out, END_OF_STREAM, sizeof(END_OF_STREAM));
+    return out + sizeof(END_OF_STREAM);
+}
+
+#if defined(__GNUC__)
+#define QOI_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define QOI_ALWAYS_INLINE inline
+#endif
+
+// Statistics hooks (see qoi_stats.h). They expand to nothing unless the
+// library is built with QOI_ENABLE_STATS.
+#if defined(QOI_ENABLE_STATS)
+#include "qoi_stats.h"
+
+extern QOIStats *qoi_stats_active;
+double qoi_stats_now(void);
+
+static inline void qoi_stats_count_opcode(QOICodecStats *stats, int op, int bytes) {
+    stats->opcode_count[op]++;
+    stats->opcode_bytes[op] += (uint64_t)bytes;
+}
+
+static inline void qoi_stats_count_run(QOICodecStats *stats, size_t length) {
+    qoi_stats_count_opcode(stats, QOI_STATS_OP_RUN, 1);
+    stats->run_histogram[length]++;
+}
+
+#define QOI_STATS_OPCODE(side, op, bytes) \
+    do { if (qoi_stats_active) qoi_stats_count_opcode(&qoi_stats_active->side, QOI_STATS_OP_##op, bytes); } while (0)
+#define QOI_STATS_RUN(side, length) \
+    do { if (qoi_stats_active) qoi_stats_count_run(&qoi_stats_active->side, length); } while (0)
+#define QOI_STATS_INDEX_PROBE(hit, collision) \
+    do { \
+        if (qoi_stats_active) { \
+            qoi_stats_active->encode.index_lookups++; \
+            qoi_stats_active->encode.index_hits += (hit); \
+            qoi_stats_active->encode.index_collisions += (collision); \
+        } \
+    } while (0)
+// QOI_STATS_TIMER declares a timestamp; QOI_STATS_PHASE charges the time since
+// then to a phase and restarts the timestamp.
+#define QOI_STATS_TIMER(timer) double timer = qoi_stats_active ? qoi_stats_now() : 0.0
+#define QOI_STATS_PHASE(side, phase, timer) \
+    do { \
+        if (qoi_stats_active) { \
+            double qoi_stats_end = qoi_stats_now(); \
+            qoi_stats_active->side.phase_seconds[QOI_STATS_PHASE_##phase] += qoi_stats_end - (timer); \
+            (timer) = qoi_stats_end; \
+        } \
+    } while (0)
+#else
+#define QOI_STATS_OPCODE(side, op, bytes) ((void)0)
+#define QOI_STATS_RUN(side, length) ((void)0)
+#define QOI_STATS_INDEX_PROBE(hit, collision) ((void)0)
+#define QOI_STATS_TIMER(timer) ((void)0)
+#define QOI_STATS_PHASE(side, phase, timer) ((void)0)
+#endif
+
+// Encoder state carried from one pixel to the next.
+typedef struct QOIEncodeState {
+    QOIPixel previous_pixel;
+    QOIPixel index_array[QOI_INDEX_SIZE];
+    uint8_t run_count;
+#if defined(QOI_ENABLE_STATS)
+    uint64_t index_occupied; // Bit n is set once index_array[n] has been written.
+#endif
+} QOIEncodeState;
+
+static inline void qoi_encode_state_init(QOIEncodeState *state) {
+    memset(state->index_array, 0, sizeof(state->index_array));
+    state->previous_pixel.r = 0;
+    state->previous_pixel.g = 0;
+    state->previous_pixel.b = 0;
+    state->previous_pixel.a = 255;
+    state->run_count = 0;
+#if defined(QOI_ENABLE_STATS)
+    state->index_occupied = 0;
+#endif
+}
+
+// Encodes a pixel known to differ from state->previous_pixel. channels must be
+// a constant 3 or 4 at every call site; with 3 the caller has already set the
+// alpha to 255, and the alpha hashing and QOI_OP_RGBA branch fold away.
+static QOI_ALWAYS_INLINE uint8_t *qoi_encode_changed_pixel(QOIEncodeState *state,
+                                                           QOIPixel current_pixel,
+                                                           uint8_t *out,
+                                                           const int channels) {
+    QOIPixel previous_pixel = state->previous_pixel;
+
+    if (state->run_count > 0) {
+        *out++ = qoi_make_chunk(QOI_OP_RUN_TAG, state->run_count - 1);
+        QOI_STATS_RUN(encode, state->run_count);
+        state->run_count = 0;
+    }
+
+    uint8_t hash_idx = channels == 3
+        ? (current_pixel.r * 3 + current_pixel.g * 5 + current_pixel.b * 7 + 255 * 11) % QOI_INDEX_SIZE
+        : qoi_hash_pixel(current_pixel);
+    if (qoi_pixels_are_equal(state->index_array[hash_idx], current_pixel)) {
+        *out++ = qoi_make_chunk(QOI_OP_INDEX_TAG, hash_idx);
+        QOI_STATS_INDEX_PROBE(1, 0);
+        QOI_STATS_OPCODE(encode, INDEX, 1);
+    } else {
+        QOI_STATS_INDEX_PROBE(0, (state->index_occupied >> hash_idx) & 1);
+        if (channels == 3 || previous_pixel.a == current_pixel.a) {
+            int dr = current_pixel.r - previous_pixel.r;
+            int dg = current_pixel.g - previous_pixel.g;
+            int db = current_pixel.b - previous_pixel.b;
+
+            if (dr >= -2 && dr <= 1 &&
+                dg >= -2 && dg <= 1 &&
+                db >= -2 && db <= 1) {
+                uint8_t payload = ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2);
+                *out++ = qoi_make_chunk(QOI_OP_DIFF_TAG, payload);
+                QOI_STATS_OPCODE(encode, DIFF, 1);
+            } else {
+                int dr_dg = dr - dg;
+                int db_dg = db - dg;
+                if (dg >= -32 && dg <= 31 &&
+                    dr_dg >= -8 && dr_dg <= 7 &&
+                    db_dg >= -8 && db_dg <= 7) {
+
+                    *out++ = qoi_make_chunk(QOI_OP_LUMA_TAG, (uint8_t)(dg + 32));
+                    *out++ = (uint8_t)((dr_dg + 8) << 4) | (uint8_t)(db_dg + 8);
+                    QOI_STATS_OPCODE(encode, LUMA, 2);
+                }
+                else {
+                    *out++ = QOI_OP_RGB_BYTE;
+                    *out++ = current_pixel.r;
+                    *out++ = current_pixel.g;
+                    *out++ = current_pixel.b;
+                    QOI_STATS_OPCODE(encode, RGB, 4);
+                }
+            }
+        }
+        else {
+            *out++ = QOI_OP_RGBA_BYTE;
+            *out++ = current_pixel.r;
+            *out++ = current_pixel.g;
+            *out++ = current_pixel.b;
+            *out++ = current_pixel.a;
+            QOI_STATS_OPCODE(encode, RGBA, 5);
+        }
+    }
+    state->index_array[hash_idx] = current_pixel;
+#if defined(QOI_ENABLE_STATS)
+    state->index_occupied |= (uint64_t)1 << hash_idx;
+#endif
+    state->previous_pixel = current_pixel;
+    return out;
+}
+
+// Adds run_length repeats of previous_pixel, emitting full QOI_MAX_RUN_LENGTH
+// runs; the remainder stays pending so a later changed pixel or
+// qoi_encode_flush_run() emits it.
+static inline uint8_t *qoi_encode_run(QOIEncodeState *state, size_t run_length, uint8_t *out) {
+    size_t total = state->run_count + run_length;
+    while (total >= QOI_MAX_RUN_LENGTH) {
+        *out++ = qoi_make_chunk(QOI_OP_RUN_TAG, QOI_MAX_RUN_LENGTH - 1);
+        QOI_STATS_RUN(encode, QOI_MAX_RUN_LENGTH);
+        total -= QOI_MAX_RUN_LENGTH;
+    }
+    state->run_count = (uint8_t)total;
+    return out;
+}
+
+static inline uint8_t *qoi_encode_flush_run(QOIEncodeState *state, uint8_t *out) {
+    if (state->run_count > 0) {
+        *out++ = qoi_make_chunk(QOI_OP_RUN_TAG, state->run_count - 1);
+        QOI_STATS_RUN(encode, state->run_count);
+        state->run_count = 0;
+    }
+    return out;
+}
+
+// Decoder state carried from one opcode to the next. run_remaining holds the
+// part of a QOI_OP_RUN that did not fit into the previous output span.
+typedef struct QOIDecodeState {
+    QOIPixel previous_pixel;
+    QOIPixel index_array[QOI_INDEX_SIZE];
+    uint32_t run_remaining;
+} QOIDecodeState;
+
+static inline void qoi_decode_state_init(QOIDecodeState *state) {
+    memset(state->index_array, 0, sizeof(state->index_array));
+    state->previous_pixel.r = 0;
+    state->previous_pixel.g = 0;
+    state->previous_pixel.b = 0;
+    state->previous_pixel.a = 255;
+    state->run_remaining = 0;
+}
+
+// Decodes opcodes from *in_ptr until out_count pixels have been written or
+// the input runs out; an opcode is only consumed if all of its bytes are
+// present. A run that extends past out_count is left in state->run_remaining
+// and written first by the next call. Returns the number of pixels written
+// and advances *in_ptr past the consumed opcodes.
+size_t qoi_decode_pixels(QOIDecodeState *state,
+                         const uint8_t **in_ptr,
+                         const uint8_t *in_end,
+                         QOIPixel *out,
+                         size_t out_count);
+
+// Encodes count pixels with the kernel specialised for channels. With 3
+// channels the input alpha is ignored and treated as 255, so the output never
+// needs more than channels + 1 bytes per pixel, plus one byte for a run that
+// was already pending in state. Defined in qoi_encode.c.
+uint8_t *qoi_encode_pixels(QOIEncodeState *state,
+                           const QOIPixel *pixels,
+                           size_t count,
+                           uint8_t channels,
+                           uint8_t *out);
+
+// Runs job(context, i) for every i in [0, job_count) on up to thread_count
+// threads (0 means one per online CPU). Returns 0 if every job returned 0.
+int qoi_parallel_for(uint32_t job_count,
+                     unsigned thread_count,
+                     int (*job)(void *context, uint32_t job_index),
+                     void *context);
+
+#endif
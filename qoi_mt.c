@@ -0,0 +1,347 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include "qoi_mt.h"
+#include "qoi_internal.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+static const unsigned char QOI_END_MARKER[8] = {0,0,0,0,0,0,0,1};
+
+typedef struct QOIParallelJobs {
+    int (*job)(void *context, uint32_t job_index);
+    void *context;
+    uint32_t job_count;
+    uint32_t next_job;
+    int failed;
+    pthread_mutex_t lock;
+} QOIParallelJobs;
+
+static unsigned qoi_online_cpu_count(void) {
+#if defined(_SC_NPROCESSORS_ONLN)
+    long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpu_count > 0) {
+        return (unsigned)cpu_count;
+    }
+#endif
+    return 1;
+}
+
+static void *qoi_parallel_worker(void *arg) {
+    QOIParallelJobs *jobs = (QOIParallelJobs *)arg;
+
+    for (;;) {
+        pthread_mutex_lock(&jobs->lock);
+        uint32_t job_index = jobs->next_job;
+        int stop = jobs->failed || job_index >= jobs->job_count;
+        if (!stop) {
+            jobs->next_job++;
+        }
+        pthread_mutex_unlock(&jobs->lock);
+        if (stop) {
+            break;
+        }
+
+        if (jobs->job(jobs->context, job_index) != 0) {
+            pthread_mutex_lock(&jobs->lock);
+            jobs->failed = 1;
+            pthread_mutex_unlock(&jobs->lock);
+        }
+    }
+    return NULL;
+}
+
+int qoi_parallel_for(uint32_t job_count,
+                     unsigned thread_count,
+                     int (*job)(void *context, uint32_t job_index),
+                     void *context) {
+    if (thread_count == 0) {
+        thread_count = qoi_online_cpu_count();
+    }
+    if (thread_count > job_count) {
+        thread_count = job_count;
+    }
+
+    if (thread_count <= 1) {
+        for (uint32_t i = 0; i < job_count; i++) {
+            if (job(context, i) != 0) {
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+    QOIParallelJobs jobs;
+    jobs.job = job;
+    jobs.context = context;
+    jobs.job_count = job_count;
+    jobs.next_job = 0;
+    jobs.failed = 0;
+    if (pthread_mutex_init(&jobs.lock, NULL) != 0) {
+        return 1;
+    }
+
+    pthread_t *threads = (pthread_t *)malloc((thread_count - 1) * sizeof(pthread_t));
+    unsigned started = 0;
+    if (threads) {
+        while (started < thread_count - 1 &&
+               pthread_create(&threads[started], NULL, qoi_parallel_worker, &jobs) == 0) {
+            started++;
+        }
+    }
+
+    // The calling thread works too, so progress is made even if no extra
+    // threads could be started.
+    qoi_parallel_worker(&jobs);
+
+    for (unsigned i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    pthread_mutex_destroy(&jobs.lock);
+
+    return jobs.failed;
+}
+
+typedef struct QOIMTEncodeJob {
+    const QOIPixel *pixel_data;
+    uint32_t width;
+    uint32_t height;
+    uint32_t band_height;
+    uint8_t channels;
+    uint8_t *output;
+    size_t band_capacity;
+    size_t payload_start;
+    size_t *band_sizes;
+} QOIMTEncodeJob;
+
+static int qoi_mt_encode_band(void *context, uint32_t band) {
+    QOIMTEncodeJob *job = (QOIMTEncodeJob *)context;
+
+    uint32_t first_row = band * job->band_height;
+    uint32_t row_count = job->height - first_row;
+    if (row_count > job->band_height) {
+        row_count = job->band_height;
+    }
+
+    const QOIPixel *px = job->pixel_data + (size_t)first_row * job->width;
+    size_t num_pixels = (size_t)row_count * job->width;
+    uint8_t *band_start = job->output + job->payload_start + (size_t)band * job->band_capacity;
+    uint8_t *out = band_start;
+
+    QOIEncodeState state;
+    qoi_encode_state_init(&state);
+    out = qoi_encode_pixels(&state, px, num_pixels, job->channels, out);
+    out = qoi_encode_flush_run(&state, out);
+    out = qoi_write_end_marker(out);
+
+    job->band_sizes[band] = (size_t)(out - band_start);
+    return 0;
+}
+
+uint8_t* qoi_mt_encode(const QOIPixel *pixel_data,
+                       uint32_t width,
+                       uint32_t height,
+                       uint8_t channels,
+                       uint8_t colorspace,
+                       uint32_t band_height,
+                       unsigned thread_count,
+                       size_t *out_size) {
+    if (!pixel_data || !out_size || width == 0 || height == 0) {
+        return NULL;
+    }
+    if (band_height == 0) {
+        band_height = QOI_MT_DEFAULT_BAND_HEIGHT;
+    }
+    if (band_height > height) {
+        band_height = height;
+    }
+
+    uint32_t band_count = height / band_height + (height % band_height != 0);
+
+    // Each band gets a worst-case slot; the bands are packed together
+    // afterwards so the container has no gaps.
+    size_t band_capacity = qoi_encode_max_size(width, band_height, channels);
+    if (band_capacity == 0) {
+        return NULL;
+    }
+    band_capacity -= QOI_HEADER_SIZE;
+
+    size_t payload_start = QOI_MT_HEADER_SIZE + ((size_t)band_count + 1) * 8;
+    if (band_capacity > (SIZE_MAX - payload_start) / band_count) {
+        return NULL;
+    }
+
+    uint8_t *output = (uint8_t *)malloc(payload_start + (size_t)band_count * band_capacity);
+    size_t *band_sizes = (size_t *)malloc(band_count * sizeof(size_t));
+    if (!output || !band_sizes) {
+        free(output);
+        free(band_sizes);
+        return NULL;
+    }
+
+    QOIMTEncodeJob job;
+    job.pixel_data = pixel_data;
+    job.width = width;
+    job.height = height;
+    job.band_height = band_height;
+    job.channels = channels;
+    job.output = output;
+    job.band_capacity = band_capacity;
+    job.payload_start = payload_start;
+    job.band_sizes = band_sizes;
+
+    if (qoi_parallel_for(band_count, thread_count, qoi_mt_encode_band, &job) != 0) {
+        free(output);
+        free(band_sizes);
+        return NULL;
+    }
+
+    uint8_t *out = output;
+    *out++ = 'q';
+    *out++ = 'o';
+    *out++ = 'i';
+    *out++ = 'm';
+    out = qoi_write_u32_be(out, width);
+    out = qoi_write_u32_be(out, height);
+    *out++ = channels;
+    *out++ = colorspace;
+    out = qoi_write_u32_be(out, band_height);
+    out = qoi_write_u32_be(out, band_count);
+
+    size_t packed_offset = payload_start;
+    for (uint32_t band = 0; band < band_count; band++) {
+        memmove(output + packed_offset, output + payload_start + (size_t)band * band_capacity, band_sizes[band]);
+        out = qoi_write_u64_be(out, packed_offset);
+        packed_offset += band_sizes[band];
+    }
+    qoi_write_u64_be(out, packed_offset);
+    free(band_sizes);
+
+    uint8_t *shrunk = (uint8_t *)realloc(output, packed_offset);
+    if (shrunk) {
+        output = shrunk;
+    }
+    *out_size = packed_offset;
+    return output;
+}
+
+typedef struct QOIMTDecodeJob {
+    const uint8_t *data;
+    const uint8_t *offset_table;
+    uint32_t width;
+    uint32_t height;
+    uint32_t band_height;
+    QOIPixel *pixels;
+} QOIMTDecodeJob;
+
+static int qoi_mt_decode_band(void *context, uint32_t band) {
+    QOIMTDecodeJob *job = (QOIMTDecodeJob *)context;
+
+    uint64_t band_start = qoi_read_u64_be(job->offset_table + (size_t)band * 8);
+    uint64_t band_end = qoi_read_u64_be(job->offset_table + (size_t)band * 8 + 8);
+    const uint8_t *in = job->data + band_start;
+    const uint8_t *in_end = job->data + band_end - QOI_PADDING_SIZE;
+
+    uint32_t first_row = band * job->band_height;
+    uint32_t row_count = job->height - first_row;
+    if (row_count > job->band_height) {
+        row_count = job->band_height;
+    }
+    size_t num_pixels = (size_t)row_count * job->width;
+
+    QOIDecodeState state;
+    qoi_decode_state_init(&state);
+    size_t decoded = qoi_decode_pixels(&state, &in, in_end,
+                                       job->pixels + (size_t)first_row * job->width, num_pixels);
+
+    if (decoded != num_pixels || state.run_remaining > 0 || in != in_end ||
+        memcmp(in_end, QOI_END_MARKER, QOI_PADDING_SIZE) != 0) {
+        fprintf(stderr, "Error: QOI-MT band %u is corrupt.\n", band);
+        return 1;
+    }
+    return 0;
+}
+
+QOIPixel* qoi_mt_decode(const uint8_t *data,
+                        size_t data_size,
+                        uint32_t *out_width,
+                        uint32_t *out_height,
+                        uint8_t *out_channels,
+                        uint8_t *out_colorspace,
+                        unsigned thread_count) {
+    if (!data || !out_width || !out_height || !out_channels || !out_colorspace) {
+        return NULL;
+    }
+
+    if (data_size < QOI_MT_HEADER_SIZE ||
+        data[0] != 'q' || data[1] != 'o' || data[2] != 'i' || data[3] != 'm') {
+        fprintf(stderr, "Error: Invalid QOI-MT header.\n");
+        return NULL;
+    }
+
+    *out_width = qoi_read_u32_be(data + 4);
+    *out_height = qoi_read_u32_be(data + 8);
+    *out_channels = data[12];
+    *out_colorspace = data[13];
+    uint32_t band_height = qoi_read_u32_be(data + 14);
+    uint32_t band_count = qoi_read_u32_be(data + 18);
+
+    if (*out_width == 0 || *out_height == 0 || *out_channels < 3 || *out_channels > 4 || *out_colorspace > 1 ||
+        band_height == 0 || band_count != *out_height / band_height + (*out_height % band_height != 0)) {
+        fprintf(stderr, "Error: Invalid image dimensions or band layout in QOI-MT header.\n");
+        return NULL;
+    }
+
+    size_t payload_start = QOI_MT_HEADER_SIZE + ((size_t)band_count + 1) * 8;
+    if (payload_start > data_size) {
+        fprintf(stderr, "Error: QOI-MT band offset table is truncated.\n");
+        return NULL;
+    }
+
+    const uint8_t *offset_table = data + QOI_MT_HEADER_SIZE;
+    uint64_t previous_offset = payload_start;
+    for (uint32_t band = 0; band < band_count; band++) {
+        uint64_t band_start = qoi_read_u64_be(offset_table + (size_t)band * 8);
+        uint64_t band_end = qoi_read_u64_be(offset_table + (size_t)band * 8 + 8);
+        if (band_start != previous_offset || band_end < band_start + QOI_PADDING_SIZE || band_end > data_size) {
+            fprintf(stderr, "Error: QOI-MT band offset table is corrupt.\n");
+            return NULL;
+        }
+        previous_offset = band_end;
+    }
+
+    if (!qoi_pixel_count_fits(*out_width, *out_height, data_size - payload_start)) {
+        fprintf(stderr, "Error: QOI-MT header dimensions do not match the data size.\n");
+        return NULL;
+    }
+    if ((size_t)*out_width > SIZE_MAX / sizeof(QOIPixel) / *out_height) {
+        fprintf(stderr, "Error: Image dimensions too large for memory allocation.\n");
+        return NULL;
+    }
+    QOIPixel *decoded_pixels_data = (QOIPixel *)malloc((size_t)*out_width * *out_height * sizeof(QOIPixel));
+    if (decoded_pixels_data == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for decoded pixels.\n");
+        return NULL;
+    }
+
+    QOIMTDecodeJob job;
+    job.data = data;
+    job.offset_table = offset_table;
+    job.width = *out_width;
+    job.height = *out_height;
+    job.band_height = band_height;
+    job.pixels = decoded_pixels_data;
+
+    if (qoi_parallel_for(band_count, thread_count, qoi_mt_decode_band, &job) != 0) {
+        free(decoded_pixels_data);
+        return NULL;
+    }
+    return decoded_pixels_data;
+}
@@ -0,0 +1,42 @@
+#ifndef QOI_MT_H
+#define QOI_MT_H
+
+#include "qoi_utils.h"
+
+// QOI-MT container: the image is split into horizontal bands that are encoded
+// independently (each starting from a fresh QOI state), so bands can be
+// encoded and decoded on separate threads.
+//
+// Layout (all integers big-endian):
+//   magic "qoim", width u32, height u32, channels u8, colorspace u8,
+//   band_height u32, band_count u32,
+//   band_count + 1 u64 offsets from the start of the container (the last one
+//   is the end of the final band),
+//   band payloads: QOI opcode stream for band_height rows + 8-byte end marker.
+
+#define QOI_MT_HEADER_SIZE 22
+#define QOI_MT_DEFAULT_BAND_HEIGHT 256
+
+// Encodes into a newly allocated container; free() the result. band_height 0
+// selects QOI_MT_DEFAULT_BAND_HEIGHT, thread_count 0 uses one thread per
+// online CPU.
+uint8_t* qoi_mt_encode(const QOIPixel *pixel_data,
+                       uint32_t width,
+                       uint32_t height,
+                       uint8_t channels,
+                       uint8_t colorspace,
+                       uint32_t band_height,
+                       unsigned thread_count,
+                       size_t *out_size);
+
+// Decodes a container into a newly allocated RGBA buffer; free() the result.
+// thread_count 1 decodes on the calling thread, 0 uses one thread per online CPU.
+QOIPixel* qoi_mt_decode(const uint8_t *data,
+                        size_t data_size,
+                        uint32_t *width,
+                        uint32_t *height,
+                        uint8_t *channels,
+                        uint8_t *colorspace,
+                        unsigned thread_count);
+
+#endif
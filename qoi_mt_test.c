@@ -0,0 +1,111 @@
+#include "qoi_mt.h"
+#include "qoi_internal.h"
+#include "qoi_test.h"
+
+// Round trips QOI-MT containers across band layouts and thread counts, then
+// feeds truncated, corrupted and implausible containers to qoi_mt_decode(),
+// which must reject them without reading outside the buffer.
+
+static QOIPixel *decode(const uint8_t *data, size_t size, unsigned thread_count,
+                        uint32_t *width, uint32_t *height, uint8_t *channels) {
+    uint8_t colorspace;
+    return qoi_mt_decode(data, size, width, height, channels, &colorspace, thread_count);
+}
+
+static void check_round_trip(uint32_t width, uint32_t height, uint8_t channels, uint32_t band_height) {
+    QOIPixel *pixels = qoi_test_image(width, height, width * 31 + height, channels == 3);
+    size_t size;
+    uint8_t *container = qoi_mt_encode(pixels, width, height, channels, 0, band_height, 2, &size);
+    QOI_CHECK(container != NULL);
+    if (!container) {
+        free(pixels);
+        return;
+    }
+    // The encoder clamps the band height to the image height.
+    uint32_t expected_band_height = band_height ? band_height : QOI_MT_DEFAULT_BAND_HEIGHT;
+    if (expected_band_height > height) {
+        expected_band_height = height;
+    }
+    QOI_CHECK(qoi_read_u32_be(container + 14) == expected_band_height);
+    QOI_CHECK(qoi_read_u32_be(container + 18) == (height + expected_band_height - 1) / expected_band_height);
+
+    static const unsigned thread_counts[] = {1, 3, 0};
+    for (int t = 0; t < 3; t++) {
+        uint32_t decoded_width, decoded_height;
+        uint8_t decoded_channels;
+        QOIPixel *decoded = decode(container, size, thread_counts[t], &decoded_width, &decoded_height, &decoded_channels);
+        QOI_CHECK(decoded && decoded_width == width && decoded_height == height && decoded_channels == channels &&
+                  memcmp(decoded, pixels, (size_t)width * height * sizeof(QOIPixel)) == 0);
+        free(decoded);
+    }
+    free(container);
+    free(pixels);
+}
+
+int main(void) {
+    check_round_trip(1, 1, 4, 0);
+    check_round_trip(97, 300, 4, 0);   // Last band shorter than the rest.
+    check_round_trip(64, 64, 3, 1);    // One row per band.
+    check_round_trip(50, 20, 4, 1000); // One band taller than the image.
+    check_round_trip(333, 77, 3, 16);
+
+    uint32_t width = 80, height = 90;
+    QOIPixel *pixels = qoi_test_image(width, height, 7, 0);
+    size_t size;
+    uint8_t *container = qoi_mt_encode(pixels, width, height, 4, 0, 32, 1, &size);
+    QOI_CHECK(container != NULL);
+    if (container) {
+        uint32_t w, h;
+        uint8_t c;
+        uint8_t *copy = (uint8_t *)malloc(size);
+
+        // Every truncation loses the end of the last band.
+        for (size_t length = 0; length < size; length += 1 + length / 32) {
+            memcpy(copy, container, length);
+            QOIPixel *decoded = decode(copy, length, 1, &w, &h, &c);
+            QOI_CHECK(decoded == NULL);
+            free(decoded);
+        }
+
+        // Header fields the decoder must not trust.
+        struct { size_t offset; uint32_t value; int bytes; } bad_fields[] = {
+            {4, 0, 4},             // Zero width.
+            {4, 0x10000, 4},       // Far more pixels than the payload can hold.
+            {8, 0xFFFFFFFFu, 4},   // Height inconsistent with band_count.
+            {12, 5, 1},            // Channels.
+            {13, 2, 1},            // Colorspace.
+            {14, 0, 4},            // Zero band height.
+            {18, 7, 4},            // Band count.
+            {22 + 12, 0, 4},       // Band offsets out of order.
+        };
+        for (size_t i = 0; i < sizeof(bad_fields) / sizeof(bad_fields[0]); i++) {
+            memcpy(copy, container, size);
+            uint8_t *field = copy + bad_fields[i].offset;
+            if (bad_fields[i].bytes == 1) {
+                field[0] = (uint8_t)bad_fields[i].value;
+            } else {
+                qoi_write_u32_be(field, bad_fields[i].value);
+            }
+            QOIPixel *decoded = decode(copy, size, 1, &w, &h, &c);
+            QOI_CHECK(decoded == NULL);
+            free(decoded);
+        }
+
+        // Random bit flips: a decode may only succeed with the original size.
+        uint32_t state = 99;
+        for (int round = 0; round < 3000; round++) {
+            memcpy(copy, container, size);
+            uint32_t r = qoi_test_random(&state);
+            size_t table_end = QOI_MT_HEADER_SIZE + ((size_t)(height + 31) / 32 + 1) * 8;
+            size_t at = r % 2 ? (r >> 1) % table_end : (r >> 1) % size;
+            copy[at] ^= (uint8_t)(1u << (qoi_test_random(&state) % 8));
+            QOIPixel *decoded = decode(copy, size, 1 + round % 2, &w, &h, &c);
+            QOI_CHECK(!decoded || (uint64_t)w * h <= (uint64_t)size * QOI_MAX_RUN_LENGTH);
+            free(decoded);
+        }
+        free(copy);
+    }
+    free(container);
+    free(pixels);
+    return qoi_test_report("qoi_mt_test");
+}
@@ -0,0 +1,400 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include <ctype.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+#include "qoi_archive.h"
+
+#define DEFAULT_BENCH_PASSES 5
+
+typedef struct NameList {
+    char **paths;  // File to read.
+    char **names;  // Archive entry name: path below the root, without ".qoi".
+    size_t count;
+    size_t capacity;
+} NameList;
+
+static double now_seconds(void) {
+#if defined(_WIN32)
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static int has_qoi_extension(const char *path) {
+    size_t length = strlen(path);
+    return length >= 4 && path[length - 4] == '.' &&
+           tolower((unsigned char)path[length - 3]) == 'q' &&
+           tolower((unsigned char)path[length - 2]) == 'o' &&
+           tolower((unsigned char)path[length - 1]) == 'i';
+}
+
+static const char *path_basename(const char *path) {
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+static int name_list_add(NameList *list, const char *path, const char *relative_path) {
+    if (list->count == list->capacity) {
+        size_t new_capacity = list->capacity ? list->capacity * 2 : 256;
+        char **grown_paths = (char **)realloc(list->paths, new_capacity * sizeof(char *));
+        if (!grown_paths) {
+            return 1;
+        }
+        list->paths = grown_paths;
+        char **grown_names = (char **)realloc(list->names, new_capacity * sizeof(char *));
+        if (!grown_names) {
+            return 1;
+        }
+        list->names = grown_names;
+        list->capacity = new_capacity;
+    }
+
+    size_t name_length = strlen(relative_path);
+    if (has_qoi_extension(relative_path)) {
+        name_length -= 4;
+    }
+    char *path_copy = (char *)malloc(strlen(path) + 1);
+    char *name = (char *)malloc(name_length + 1);
+    if (!path_copy || !name) {
+        free(path_copy);
+        free(name);
+        return 1;
+    }
+    strcpy(path_copy, path);
+    memcpy(name, relative_path, name_length);
+    name[name_length] = '\0';
+
+    list->paths[list->count] = path_copy;
+    list->names[list->count] = name;
+    list->count++;
+    return 0;
+}
+
+static void name_list_free(NameList *list) {
+    for (size_t i = 0; i < list->count; i++) {
+        free(list->paths[i]);
+        free(list->names[i]);
+    }
+    free(list->paths);
+    free(list->names);
+}
+
+// Adds path if it is a file, or every *.qoi file below it if it is a
+// directory. root_length is the length of the prefix stripped to form names.
+static int collect_inputs(const char *path, size_t root_length, int explicit_file, NameList *list) {
+    struct stat path_info;
+    if (stat(path, &path_info) != 0) {
+        fprintf(stderr, "Error: Cannot access '%s'.\n", path);
+        return 1;
+    }
+
+    if (!S_ISDIR(path_info.st_mode)) {
+        if (explicit_file) {
+            return name_list_add(list, path, path_basename(path));
+        }
+        if (has_qoi_extension(path)) {
+            return name_list_add(list, path, path + root_length);
+        }
+        return 0;
+    }
+
+    DIR *dir = opendir(path);
+    if (!dir) {
+        fprintf(stderr, "Error: Cannot open directory '%s'.\n", path);
+        return 1;
+    }
+
+    int status = 0;
+    struct dirent *entry;
+    while (status == 0 && (entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        size_t child_length = strlen(path) + 1 + strlen(entry->d_name) + 1;
+        char *child = (char *)malloc(child_length);
+        if (!child) {
+            status = 1;
+            break;
+        }
+        snprintf(child, child_length, "%s/%s", path, entry->d_name);
+        status = collect_inputs(child, root_length, 0, list);
+        free(child);
+    }
+    closedir(dir);
+    return status;
+}
+
+// Reads path into *buffer, growing it as needed. Returns the file size, or
+// 0 on failure.
+static size_t read_file_into(const char *path, uint8_t **buffer, size_t *capacity) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return 0;
+    }
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0) {
+        size = ftell(f);
+    }
+    size_t result = 0;
+    if (size > 0 && fseek(f, 0, SEEK_SET) == 0) {
+        if ((size_t)size > *capacity) {
+            uint8_t *grown = (uint8_t *)realloc(*buffer, (size_t)size);
+            if (grown) {
+                *buffer = grown;
+                *capacity = (size_t)size;
+            }
+        }
+        if ((size_t)size <= *capacity && fread(*buffer, 1, (size_t)size, f) == (size_t)size) {
+            result = (size_t)size;
+        }
+    }
+    fclose(f);
+    return result;
+}
+
+static int add_inputs(QOIArchiveWriter *writer, int argc, char *argv[]) {
+    NameList inputs = {NULL, NULL, 0, 0};
+    int status = 0;
+    for (int arg = 0; arg < argc; arg++) {
+        // Children are named "root/name", so strip the root and its separator.
+        if (collect_inputs(argv[arg], strlen(argv[arg]) + 1, 1, &inputs) != 0) {
+            status = 1;
+        }
+    }
+
+    uint8_t *buffer = NULL;
+    size_t capacity = 0;
+    size_t added = 0;
+    for (size_t i = 0; i < inputs.count; i++) {
+        size_t size = read_file_into(inputs.paths[i], &buffer, &capacity);
+        if (size == 0) {
+            fprintf(stderr, "Error: Could not read '%s'.\n", inputs.paths[i]);
+            status = 1;
+            continue;
+        }
+        if (qoi_archive_writer_add(writer, inputs.names[i], buffer, size) != 0) {
+            status = 1;
+            continue;
+        }
+        added++;
+    }
+    printf("Added %zu of %zu files.\n", added, inputs.count);
+
+    free(buffer);
+    name_list_free(&inputs);
+    return status;
+}
+
+static int list_archive(const char *path) {
+    QOIArchive archive;
+    if (qoi_archive_open(&archive, path) != 0) {
+        return 1;
+    }
+    uint32_t cursor = 0;
+    QOIArchiveEntry entry;
+    while (qoi_archive_next(&archive, &cursor, &entry) == 0) {
+        printf("%-40.*s %5ux%-5u %10zu bytes  offset %zu\n", (int)entry.name_length, entry.name,
+               entry.width, entry.height, entry.size, (size_t)(entry.data - archive.data));
+    }
+    printf("%u entries, %u buckets, %zu bytes\n", archive.entry_count, archive.bucket_count, archive.size);
+    qoi_archive_close(&archive);
+    return 0;
+}
+
+// Decodes every archive entry from the mapped archive, and the same images
+// from loose files under loose_dir (named "<loose_dir>/<entry name>.qoi"),
+// timing passes over the whole set.
+static int bench_archive(const char *archive_path, const char *loose_dir, int passes) {
+    double open_start = now_seconds();
+    QOIArchive archive;
+    if (qoi_archive_open(&archive, archive_path) != 0) {
+        return 1;
+    }
+    double open_seconds = now_seconds() - open_start;
+
+    // Name and loose path of every entry, and the largest decoded size.
+    NameList entries = {NULL, NULL, 0, 0};
+    size_t max_pixels_size = 0;
+    double total_pixels = 0;
+    int status = 0;
+    uint32_t cursor = 0;
+    QOIArchiveEntry entry;
+    while (status == 0 && qoi_archive_next(&archive, &cursor, &entry) == 0) {
+        size_t path_length = strlen(loose_dir) + 1 + entry.name_length + 5;
+        char *loose_path = (char *)malloc(path_length);
+        char *name = (char *)malloc(entry.name_length + 1);
+        if (!loose_path || !name) {
+            free(loose_path);
+            free(name);
+            status = 1;
+            break;
+        }
+        snprintf(loose_path, path_length, "%s/%.*s.qoi", loose_dir, (int)entry.name_length, entry.name);
+        memcpy(name, entry.name, entry.name_length);
+        name[entry.name_length] = '\0';
+        status = name_list_add(&entries, loose_path, name);
+        free(loose_path);
+        free(name);
+
+        size_t pixels_size = (size_t)entry.width * entry.height * sizeof(QOIPixel);
+        if (pixels_size > max_pixels_size) {
+            max_pixels_size = pixels_size;
+        }
+        total_pixels += (double)entry.width * entry.height;
+    }
+
+    void *pixels = max_pixels_size ? malloc(max_pixels_size) : NULL;
+    uint8_t *file_buffer = NULL;
+    size_t file_capacity = 0;
+    double *archive_times = (double *)malloc((size_t)passes * sizeof(double));
+    double *loose_times = (double *)malloc((size_t)passes * sizeof(double));
+    if (status != 0 || entries.count == 0 || !pixels || !archive_times || !loose_times) {
+        fprintf(stderr, "Error: Nothing to benchmark in '%s'.\n", archive_path);
+        status = 1;
+    }
+
+    for (int pass = 0; status == 0 && pass < passes; pass++) {
+        uint32_t width, height;
+        uint8_t channels, colorspace;
+
+        double start = now_seconds();
+        for (size_t i = 0; i < entries.count; i++) {
+            QOIArchiveEntry found;
+            if (qoi_archive_find(&archive, entries.names[i], strlen(entries.names[i]), &found) != 0 ||
+                qoi_decode_into(found.data, found.size, pixels, (size_t)found.width * sizeof(QOIPixel),
+                                max_pixels_size, QOI_LAYOUT_RGBA, &width, &height, &channels, &colorspace) != 0) {
+                fprintf(stderr, "Error: Could not decode archive entry '%s'.\n", entries.names[i]);
+                status = 1;
+                break;
+            }
+        }
+        archive_times[pass] = now_seconds() - start;
+
+        start = now_seconds();
+        for (size_t i = 0; status == 0 && i < entries.count; i++) {
+            size_t size = read_file_into(entries.paths[i], &file_buffer, &file_capacity);
+            QOIInfo info;
+            if (size == 0 || qoi_read_info(file_buffer, size, &info) != QOI_OK ||
+                qoi_decode_into(file_buffer, size, pixels, (size_t)info.width * sizeof(QOIPixel), max_pixels_size,
+                                QOI_LAYOUT_RGBA, &width, &height, &channels, &colorspace) != 0) {
+                fprintf(stderr, "Error: Could not decode loose file '%s'.\n", entries.paths[i]);
+                status = 1;
+            }
+        }
+        loose_times[pass] = now_seconds() - start;
+    }
+
+    if (status == 0) {
+        qsort(archive_times, (size_t)passes, sizeof(double), compare_doubles);
+        qsort(loose_times, (size_t)passes, sizeof(double), compare_doubles);
+        double archive_median = archive_times[passes / 2];
+        double loose_median = loose_times[passes / 2];
+        printf("%zu images, %.2f MP, median of %d passes (archive open %.3f ms)\n",
+               entries.count, total_pixels / 1000000.0, passes, open_seconds * 1000.0);
+        printf("archive: %10.0f images/s  %8.1f MP/s  %7.2f us/image\n",
+               entries.count / archive_median, total_pixels / archive_median / 1000000.0,
+               archive_median / entries.count * 1000000.0);
+        printf("loose:   %10.0f images/s  %8.1f MP/s  %7.2f us/image\n",
+               entries.count / loose_median, total_pixels / loose_median / 1000000.0,
+               loose_median / entries.count * 1000000.0);
+        printf("speedup: %.2fx\n", loose_median / archive_median);
+    }
+
+    free(loose_times);
+    free(archive_times);
+    free(file_buffer);
+    free(pixels);
+    name_list_free(&entries);
+    qoi_archive_close(&archive);
+    return status;
+}
+
+static void print_usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s create [-a alignment] <archive> <file.qoi | directory>...\n"
+            "       %s append <archive> <file.qoi | directory>...\n"
+            "       %s list <archive>\n"
+            "       %s bench [-n passes] <archive> <loose directory>\n"
+            "Directories are searched recursively for *.qoi; entries are named by their path\n"
+            "below the directory without the extension. bench decodes every entry from the\n"
+            "archive and from <loose directory>/<name>.qoi (default %d passes).\n",
+            program, program, program, program, DEFAULT_BENCH_PASSES);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    const char *command = argv[1];
+    int arg = 2;
+
+    if (strcmp(command, "create") == 0 || strcmp(command, "append") == 0) {
+        uint32_t alignment = 0;
+        if (strcmp(command, "create") == 0 && strcmp(argv[arg], "-a") == 0 && arg + 1 < argc) {
+            alignment = (uint32_t)atoi(argv[arg + 1]);
+            arg += 2;
+        }
+        if (argc - arg < 2) {
+            print_usage(argv[0]);
+            return 1;
+        }
+
+        QOIArchiveWriter writer;
+        int opened = strcmp(command, "create") == 0
+            ? qoi_archive_writer_create(&writer, argv[arg], alignment)
+            : qoi_archive_writer_append(&writer, argv[arg]);
+        if (opened != 0) {
+            return 1;
+        }
+        int status = add_inputs(&writer, argc - arg - 1, argv + arg + 1);
+        if (qoi_archive_writer_finish(&writer) != 0) {
+            status = 1;
+        }
+        return status;
+    }
+
+    if (strcmp(command, "list") == 0) {
+        return list_archive(argv[arg]);
+    }
+
+    if (strcmp(command, "bench") == 0) {
+        int passes = DEFAULT_BENCH_PASSES;
+        if (strcmp(argv[arg], "-n") == 0 && arg + 1 < argc) {
+            passes = atoi(argv[arg + 1]);
+            arg += 2;
+        }
+        if (argc - arg != 2 || passes < 1) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        return bench_archive(argv[arg], argv[arg + 1], passes);
+    }
+
+    print_usage(argv[0]);
+    return 1;
+}
@@ -0,0 +1,288 @@
+#include "qoi_seek.h"
+#include "qoi_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define QOI_SEEK_HEADER_SIZE 20
+#define QOI_SEEK_ENTRY_SIZE (8 + 8 + 4 + 1 + QOI_INDEX_SIZE * 4)
+
+int qoi_encode_to_memory_indexed(const QOIPixel *image_data,
+                                 uint32_t width,
+                                 uint32_t height,
+                                 uint8_t channels,
+                                 uint8_t colorspace,
+                                 uint8_t *out_buffer,
+                                 size_t out_capacity,
+                                 size_t *out_size,
+                                 uint32_t rows_per_entry,
+                                 QOISeekIndex *index) {
+
+    if (!image_data || !out_buffer || !out_size || !index ||
+        width == 0 || height == 0 || rows_per_entry == 0) {
+        return 1;
+    }
+
+    size_t required_capacity = qoi_encode_max_size(width, height, channels);
+    if (required_capacity == 0 || out_capacity < required_capacity) {
+        return 1;
+    }
+
+    uint32_t entry_count = height / rows_per_entry + (height % rows_per_entry != 0);
+    QOISeekEntry *entries = (QOISeekEntry *)malloc(entry_count * sizeof(QOISeekEntry));
+    if (!entries) {
+        return 1;
+    }
+
+    uint8_t *out = qoi_write_header(width, height, channels, colorspace, out_buffer);
+
+    QOIEncodeState state;
+    qoi_encode_state_init(&state);
+
+    const QOIPixel *row = image_data;
+    for (uint32_t y = 0; y < height; y++, row += width) {
+        if (y % rows_per_entry == 0) {
+            QOISeekEntry *entry = &entries[y / rows_per_entry];
+            entry->byte_offset = (uint64_t)(out - out_buffer);
+            entry->pixel_offset = (uint64_t)y * width;
+            entry->previous_pixel = state.previous_pixel;
+            memcpy(entry->index_array, state.index_array, sizeof(entry->index_array));
+            entry->run_skip = state.run_count;
+        }
+        out = qoi_encode_pixels(&state, row, width, channels, out);
+    }
+    out = qoi_encode_flush_run(&state, out);
+    out = qoi_write_end_marker(out);
+
+    index->width = width;
+    index->height = height;
+    index->rows_per_entry = rows_per_entry;
+    index->entry_count = entry_count;
+    index->entries = entries;
+
+    *out_size = (size_t)(out - out_buffer);
+    return 0;
+}
+
+void qoi_seek_index_free(QOISeekIndex *index) {
+    if (!index) {
+        return;
+    }
+    free(index->entries);
+    index->entries = NULL;
+    index->entry_count = 0;
+}
+
+uint8_t* qoi_seek_index_serialize(const QOISeekIndex *index, size_t *out_size) {
+    if (!index || !index->entries || !out_size) {
+        return NULL;
+    }
+
+    size_t total_size = QOI_SEEK_HEADER_SIZE + (size_t)index->entry_count * QOI_SEEK_ENTRY_SIZE;
+    uint8_t *buffer = (uint8_t *)malloc(total_size);
+    if (!buffer) {
+        return NULL;
+    }
+
+    uint8_t *out = buffer;
+    *out++ = 'q';
+    *out++ = 'o';
+    *out++ = 'i';
+    *out++ = 'x';
+    out = qoi_write_u32_be(out, index->width);
+    out = qoi_write_u32_be(out, index->height);
+    out = qoi_write_u32_be(out, index->rows_per_entry);
+    out = qoi_write_u32_be(out, index->entry_count);
+
+    for (uint32_t i = 0; i < index->entry_count; i++) {
+        const QOISeekEntry *entry = &index->entries[i];
+        out = qoi_write_u64_be(out, entry->byte_offset);
+        out = qoi_write_u64_be(out, entry->pixel_offset);
+        memcpy(out, &entry->previous_pixel, 4);
+        out += 4;
+        *out++ = entry->run_skip;
+        memcpy(out, entry->index_array, QOI_INDEX_SIZE * 4);
+        out += QOI_INDEX_SIZE * 4;
+    }
+
+    *out_size = total_size;
+    return buffer;
+}
+
+int qoi_seek_index_parse(const uint8_t *data, size_t data_size, QOISeekIndex *index) {
+    if (!data || !index || data_size < QOI_SEEK_HEADER_SIZE ||
+        data[0] != 'q' || data[1] != 'o' || data[2] != 'i' || data[3] != 'x') {
+        return 1;
+    }
+
+    uint32_t width = qoi_read_u32_be(data + 4);
+    uint32_t height = qoi_read_u32_be(data + 8);
+    uint32_t rows_per_entry = qoi_read_u32_be(data + 12);
+    uint32_t entry_count = qoi_read_u32_be(data + 16);
+
+    if (width == 0 || height == 0 || rows_per_entry == 0 ||
+        entry_count != height / rows_per_entry + (height % rows_per_entry != 0) ||
+        (data_size - QOI_SEEK_HEADER_SIZE) / QOI_SEEK_ENTRY_SIZE < entry_count) {
+        return 1;
+    }
+
+    QOISeekEntry *entries = (QOISeekEntry *)malloc(entry_count * sizeof(QOISeekEntry));
+    if (!entries) {
+        return 1;
+    }
+
+    const uint8_t *in = data + QOI_SEEK_HEADER_SIZE;
+    for (uint32_t i = 0; i < entry_count; i++) {
+        QOISeekEntry *entry = &entries[i];
+        entry->byte_offset = qoi_read_u64_be(in);
+        entry->pixel_offset = qoi_read_u64_be(in + 8);
+        memcpy(&entry->previous_pixel, in + 16, 4);
+        entry->run_skip = in[20];
+        memcpy(entry->index_array, in + 21, QOI_INDEX_SIZE * 4);
+        in += QOI_SEEK_ENTRY_SIZE;
+    }
+
+    index->width = width;
+    index->height = height;
+    index->rows_per_entry = rows_per_entry;
+    index->entry_count = entry_count;
+    index->entries = entries;
+    return 0;
+}
+
+// The sidecar is untrusted: its dimensions must match the QOI header before
+// anything is sized from them.
+static int qoi_seek_index_matches(const uint8_t *data, size_t data_size, const QOISeekIndex *index) {
+    if (data_size < QOI_HEADER_SIZE ||
+        data[0] != 'q' || data[1] != 'o' || data[2] != 'i' || data[3] != 'f' ||
+        qoi_read_u32_be(data + 4) != index->width ||
+        qoi_read_u32_be(data + 8) != index->height) {
+        fprintf(stderr, "Error: Seek index does not match the QOI header.\n");
+        return 0;
+    }
+    return 1;
+}
+
+int qoi_decode_rows_indexed(const uint8_t *data,
+                            size_t data_size,
+                            const QOISeekIndex *index,
+                            uint32_t first_row,
+                            uint32_t row_count,
+                            QOIPixel *out) {
+    if (!data || !index || !index->entries || !out || row_count == 0) {
+        return 1;
+    }
+    if (!qoi_seek_index_matches(data, data_size, index)) {
+        return 1;
+    }
+    if (first_row >= index->height || row_count > index->height - first_row) {
+        return 1;
+    }
+
+    uint32_t width = index->width;
+    uint32_t entry_number = first_row / index->rows_per_entry;
+    const QOISeekEntry *entry = &index->entries[entry_number];
+    uint32_t entry_row = entry_number * index->rows_per_entry;
+
+    if (entry->byte_offset < QOI_HEADER_SIZE || entry->byte_offset >= data_size ||
+        entry->pixel_offset != (uint64_t)entry_row * width) {
+        fprintf(stderr, "Error: Seek index entry %u is out of range.\n", entry_number);
+        return 1;
+    }
+
+    QOIDecodeState state;
+    state.previous_pixel = entry->previous_pixel;
+    memcpy(state.index_array, entry->index_array, sizeof(state.index_array));
+    state.run_remaining = 0;
+
+    const uint8_t *in = data + entry->byte_offset;
+    const uint8_t *in_end = data + data_size;
+
+    if (entry->run_skip > 0) {
+        uint8_t byte1 = *in;
+        uint32_t run_length = (byte1 & 0x3F) + 1;
+        if (((byte1 >> 6) & 0x03) != QOI_OP_RUN_TAG || byte1 == QOI_OP_RGB_BYTE ||
+            byte1 == QOI_OP_RGBA_BYTE || entry->run_skip > run_length) {
+            fprintf(stderr, "Error: Seek index entry %u does not point at a run.\n", entry_number);
+            return 1;
+        }
+        state.run_remaining = run_length - entry->run_skip;
+        in++;
+    }
+
+    if (first_row > entry_row) {
+        QOIPixel *scratch_row = (QOIPixel *)malloc(width * sizeof(QOIPixel));
+        if (!scratch_row) {
+            return 1;
+        }
+        for (uint32_t y = entry_row; y < first_row; y++) {
+            if (qoi_decode_pixels(&state, &in, in_end, scratch_row, width) != width) {
+                free(scratch_row);
+                fprintf(stderr, "Error: Unexpected EOF during pixel decoding.\n");
+                return 1;
+            }
+        }
+        free(scratch_row);
+    }
+
+    size_t num_pixels = (size_t)row_count * width;
+    if (qoi_decode_pixels(&state, &in, in_end, out, num_pixels) != num_pixels) {
+        fprintf(stderr, "Error: Unexpected EOF during pixel decoding.\n");
+        return 1;
+    }
+    return 0;
+}
+
+typedef struct QOISeekDecodeJob {
+    const uint8_t *data;
+    size_t data_size;
+    const QOISeekIndex *index;
+    QOIPixel *pixels;
+} QOISeekDecodeJob;
+
+static int qoi_seek_decode_segment(void *context, uint32_t entry_number) {
+    QOISeekDecodeJob *job = (QOISeekDecodeJob *)context;
+    const QOISeekIndex *index = job->index;
+
+    uint32_t first_row = entry_number * index->rows_per_entry;
+    uint32_t row_count = index->height - first_row;
+    if (row_count > index->rows_per_entry) {
+        row_count = index->rows_per_entry;
+    }
+    return qoi_decode_rows_indexed(job->data, job->data_size, index, first_row, row_count,
+                                   job->pixels + (size_t)first_row * index->width);
+}
+
+QOIPixel* qoi_decode_parallel_indexed(const uint8_t *data,
+                                      size_t data_size,
+                                      const QOISeekIndex *index,
+                                      unsigned thread_count) {
+    if (!data || !index || !index->entries || !qoi_seek_index_matches(data, data_size, index)) {
+        return NULL;
+    }
+    if (!qoi_pixel_count_fits(index->width, index->height, data_size - QOI_HEADER_SIZE)) {
+        fprintf(stderr, "Error: QOI header dimensions do not match the data size.\n");
+        return NULL;
+    }
+    if ((size_t)index->width > SIZE_MAX / sizeof(QOIPixel) / index->height) {
+        fprintf(stderr, "Error: Image dimensions too large for memory allocation.\n");
+        return NULL;
+    }
+
+    QOIPixel *decoded_pixels_data = (QOIPixel *)malloc((size_t)index->width * index->height * sizeof(QOIPixel));
+    if (decoded_pixels_data == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for decoded pixels.\n");
+        return NULL;
+    }
+
+    QOISeekDecodeJob job;
+    job.data = data;
+    job.data_size = data_size;
+    job.index = index;
+    job.pixels = decoded_pixels_data;
+
+    if (qoi_parallel_for(index->entry_count, thread_count, qoi_seek_decode_segment, &job) != 0) {
+        free(decoded_pixels_data);
+        return NULL;
+    }
+    return decoded_pixels_data;
+}
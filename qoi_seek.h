@@ -0,0 +1,63 @@
+#ifndef QOI_SEEK_H
+#define QOI_SEEK_H
+
+#include "qoi_utils.h"
+
+// Sidecar seek index for standard QOI files. Every rows_per_entry rows the
+// encoder records the decoder state needed to resume at that row, so an
+// unmodified QOI stream can be decoded in parallel segments or cropped to a
+// row range without decoding from the start.
+
+typedef struct QOISeekEntry {
+    uint64_t byte_offset;    // Offset of the next opcode from the start of the QOI file.
+    uint64_t pixel_offset;   // Index of the first pixel this entry resumes at.
+    QOIPixel previous_pixel;
+    QOIPixel index_array[QOI_INDEX_SIZE];
+    uint8_t run_skip;        // Pixels of the run at byte_offset that precede pixel_offset.
+} QOISeekEntry;
+
+typedef struct QOISeekIndex {
+    uint32_t width, height;
+    uint32_t rows_per_entry;
+    uint32_t entry_count;
+    QOISeekEntry *entries;
+} QOISeekIndex;
+
+// Same output as qoi_encode_to_memory(); additionally fills index with one
+// entry per rows_per_entry rows. Release the index with qoi_seek_index_free().
+int qoi_encode_to_memory_indexed(const QOIPixel *pixel_data,
+                                 uint32_t width,
+                                 uint32_t height,
+                                 uint8_t channels,
+                                 uint8_t colorspace,
+                                 uint8_t *out_buffer,
+                                 size_t out_capacity,
+                                 size_t *out_size,
+                                 uint32_t rows_per_entry,
+                                 QOISeekIndex *index);
+
+void qoi_seek_index_free(QOISeekIndex *index);
+
+// Sidecar file format (big-endian): magic "qoix", width u32, height u32,
+// rows_per_entry u32, entry_count u32, then per entry: byte_offset u64,
+// pixel_offset u64, previous_pixel rgba, run_skip u8, 64 rgba index entries.
+uint8_t* qoi_seek_index_serialize(const QOISeekIndex *index, size_t *out_size);
+int qoi_seek_index_parse(const uint8_t *data, size_t data_size, QOISeekIndex *index);
+
+// Decodes rows [first_row, first_row + row_count) of a QOI file into out,
+// starting from the nearest preceding index entry.
+int qoi_decode_rows_indexed(const uint8_t *data,
+                            size_t data_size,
+                            const QOISeekIndex *index,
+                            uint32_t first_row,
+                            uint32_t row_count,
+                            QOIPixel *out);
+
+// Decodes the whole image, one index segment per job, on up to thread_count
+// threads (0 means one per online CPU). free() the result. Requires qoi_mt.c.
+QOIPixel* qoi_decode_parallel_indexed(const uint8_t *data,
+                                      size_t data_size,
+                                      const QOISeekIndex *index,
+                                      unsigned thread_count);
+
+#endif
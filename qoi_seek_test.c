@@ -0,0 +1,134 @@
+#include "qoi_seek.h"
+#include "qoi_test.h"
+
+// Checks that the indexed encoder matches the plain one, that the sidecar
+// survives serialize/parse, and that row ranges and parallel decodes match
+// the source. Truncated and bit-flipped sidecars must be rejected by
+// qoi_seek_index_parse() or, when they still parse, must not make the
+// indexed decoders read outside the QOI file.
+
+static int entries_equal(const QOISeekIndex *a, const QOISeekIndex *b) {
+    if (a->width != b->width || a->height != b->height ||
+        a->rows_per_entry != b->rows_per_entry || a->entry_count != b->entry_count) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < a->entry_count; i++) {
+        const QOISeekEntry *x = &a->entries[i];
+        const QOISeekEntry *y = &b->entries[i];
+        if (x->byte_offset != y->byte_offset || x->pixel_offset != y->pixel_offset ||
+            x->run_skip != y->run_skip || memcmp(&x->previous_pixel, &y->previous_pixel, 4) != 0 ||
+            memcmp(x->index_array, y->index_array, sizeof(x->index_array)) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void check_image(uint32_t width, uint32_t height, uint8_t channels, uint32_t rows_per_entry) {
+    QOIPixel *pixels = qoi_test_image(width, height, width + height * 7, channels == 3);
+    size_t capacity = qoi_encode_max_size(width, height, channels);
+    uint8_t *plain = (uint8_t *)malloc(capacity);
+    uint8_t *indexed = (uint8_t *)malloc(capacity);
+    size_t plain_size = 0, indexed_size = 0;
+    QOISeekIndex index;
+    QOI_CHECK(qoi_encode_to_memory(pixels, width, height, channels, 0, plain, capacity, &plain_size) == 0);
+    QOI_CHECK(qoi_encode_to_memory_indexed(pixels, width, height, channels, 0, indexed, capacity, &indexed_size,
+                                           rows_per_entry, &index) == 0);
+    QOI_CHECK(indexed_size == plain_size && memcmp(indexed, plain, plain_size) == 0);
+
+    size_t sidecar_size;
+    uint8_t *sidecar = qoi_seek_index_serialize(&index, &sidecar_size);
+    QOISeekIndex parsed;
+    QOI_CHECK(sidecar && qoi_seek_index_parse(sidecar, sidecar_size, &parsed) == 0);
+    if (qoi_test_failures == 0) {
+        QOI_CHECK(entries_equal(&index, &parsed));
+
+        // Row ranges starting on, just after and just before entry boundaries.
+        QOIPixel *rows = (QOIPixel *)malloc((size_t)width * height * sizeof(QOIPixel));
+        uint32_t starts[] = {0, 1, rows_per_entry - 1, rows_per_entry, rows_per_entry + 1, height / 2, height - 1};
+        for (size_t i = 0; i < sizeof(starts) / sizeof(starts[0]); i++) {
+            uint32_t first = starts[i] < height ? starts[i] : height - 1;
+            uint32_t counts[] = {1, rows_per_entry, height - first};
+            for (size_t j = 0; j < 3; j++) {
+                uint32_t count = counts[j] < height - first ? counts[j] : height - first;
+                QOI_CHECK(qoi_decode_rows_indexed(plain, plain_size, &parsed, first, count, rows) == 0 &&
+                          memcmp(rows, pixels + (size_t)first * width, (size_t)count * width * sizeof(QOIPixel)) == 0);
+            }
+        }
+        QOI_CHECK(qoi_decode_rows_indexed(plain, plain_size, &parsed, height, 1, rows) != 0);
+        free(rows);
+
+        for (unsigned threads = 1; threads <= 3; threads++) {
+            QOIPixel *decoded = qoi_decode_parallel_indexed(plain, plain_size, &parsed, threads);
+            QOI_CHECK(decoded && memcmp(decoded, pixels, (size_t)width * height * sizeof(QOIPixel)) == 0);
+            free(decoded);
+        }
+        qoi_seek_index_free(&parsed);
+    }
+    free(sidecar);
+    qoi_seek_index_free(&index);
+    free(indexed);
+    free(plain);
+    free(pixels);
+}
+
+int main(void) {
+    check_image(1, 1, 4, 1);
+    check_image(120, 97, 4, 16);
+    check_image(64, 64, 3, 1);
+    check_image(200, 50, 4, 64); // One entry.
+    check_image(31, 300, 3, 7);
+
+    // Corrupted sidecars for one image.
+    uint32_t width = 90, height = 80;
+    QOIPixel *pixels = qoi_test_image(width, height, 3, 0);
+    size_t capacity = qoi_encode_max_size(width, height, 4);
+    uint8_t *qoi = (uint8_t *)malloc(capacity);
+    size_t qoi_size;
+    QOISeekIndex index;
+    QOI_CHECK(qoi_encode_to_memory_indexed(pixels, width, height, 4, 0, qoi, capacity, &qoi_size, 8, &index) == 0);
+    size_t sidecar_size;
+    uint8_t *sidecar = qoi_seek_index_serialize(&index, &sidecar_size);
+    qoi_seek_index_free(&index);
+    QOI_CHECK(sidecar != NULL);
+    if (sidecar) {
+        uint8_t *copy = (uint8_t *)malloc(sidecar_size);
+        QOIPixel *rows = (QOIPixel *)malloc((size_t)width * height * sizeof(QOIPixel));
+        QOISeekIndex parsed;
+
+        for (size_t length = 0; length < sidecar_size; length += 1 + length / 16) {
+            memcpy(copy, sidecar, length);
+            QOI_CHECK(qoi_seek_index_parse(copy, length, &parsed) != 0);
+        }
+
+        // An index for a different image must not be applied.
+        memcpy(copy, sidecar, sidecar_size);
+        copy[7] ^= 1;
+        if (qoi_seek_index_parse(copy, sidecar_size, &parsed) == 0) {
+            QOI_CHECK(qoi_decode_rows_indexed(qoi, qoi_size, &parsed, 0, 1, rows) != 0);
+            qoi_seek_index_free(&parsed);
+        }
+
+        uint32_t state = 4242;
+        for (int round = 0; round < 3000; round++) {
+            memcpy(copy, sidecar, sidecar_size);
+            for (int flips = 1 + round % 3; flips > 0; flips--) {
+                uint32_t r = qoi_test_random(&state);
+                copy[(r >> 3) % sidecar_size] ^= (uint8_t)(1u << (r % 8));
+            }
+            if (qoi_seek_index_parse(copy, sidecar_size, &parsed) != 0) {
+                continue;
+            }
+            uint32_t first = qoi_test_random(&state) % height;
+            qoi_decode_rows_indexed(qoi, qoi_size, &parsed, first, height - first, rows);
+            free(qoi_decode_parallel_indexed(qoi, qoi_size, &parsed, 1));
+            qoi_seek_index_free(&parsed);
+        }
+        free(rows);
+        free(copy);
+    }
+    free(sidecar);
+    free(qoi);
+    free(pixels);
+    return qoi_test_report("qoi_seek_test");
+}
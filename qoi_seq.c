@@ -0,0 +1,406 @@
+#include "qoi_seq.h"
+#include "qoi_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Largest LEB128 encoding of a u32.
+#define QOI_SEQ_MAX_VARINT_BYTES 5
+
+static uint8_t *qoi_seq_write_varint(uint8_t *out, uint32_t value) {
+    while (value >= 0x80) {
+        *out++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (uint8_t)value;
+    return out;
+}
+
+// Returns the position after the varint, or NULL if it is truncated or does
+// not fit in 32 bits.
+static const uint8_t *qoi_seq_read_varint(const uint8_t *in, const uint8_t *in_end, uint32_t *value) {
+    uint32_t result = 0;
+    for (unsigned shift = 0; shift < 7 * QOI_SEQ_MAX_VARINT_BYTES && in < in_end; shift += 7) {
+        uint8_t byte = *in++;
+        if (shift == 28 && (byte & 0x70) != 0) {
+            return NULL;
+        }
+        result |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return in;
+        }
+    }
+    return NULL;
+}
+
+// Number of leading pixels that are the same in both frames.
+static size_t qoi_seq_equal_length(const QOIPixel *a, const QOIPixel *b, size_t count) {
+    size_t length = 0;
+    // Eight pixels per step; a fixed-size memcmp compiles to a few wide loads.
+    while (count - length >= 8 && memcmp(a + length, b + length, 8 * sizeof(QOIPixel)) == 0) {
+        length += 8;
+    }
+    while (length < count && qoi_pixels_are_equal(a[length], b[length])) {
+        length++;
+    }
+    return length;
+}
+
+int qoi_seq_encoder_init(QOISeqEncoder *encoder,
+                         uint32_t width,
+                         uint32_t height,
+                         uint8_t channels,
+                         uint8_t colorspace,
+                         uint32_t keyframe_interval) {
+    if (!encoder) {
+        return 1;
+    }
+    memset(encoder, 0, sizeof(*encoder));
+    if (width == 0 || height == 0 || channels < 3 || channels > 4 || colorspace > 1) {
+        return 1;
+    }
+    if (width > UINT32_MAX / height) {
+        fprintf(stderr, "Error: Image dimensions (width * height) too large, would overflow uint32_t.\n");
+        return 1;
+    }
+
+    size_t num_pixels = (size_t)width * height;
+    size_t max_qoi_size = qoi_encode_max_size(width, height, channels);
+    size_t max_spans = num_pixels / (QOI_SEQ_MIN_SKIP + 1) + 1;
+    if (max_qoi_size == 0 || num_pixels > SIZE_MAX / sizeof(QOIPixel) ||
+        max_spans > (SIZE_MAX - max_qoi_size - QOI_SEQ_FRAME_HEADER_SIZE - 4) / (2 * QOI_SEQ_MAX_VARINT_BYTES)) {
+        fprintf(stderr, "Error: Image dimensions too large for memory allocation.\n");
+        return 1;
+    }
+
+    encoder->width = width;
+    encoder->height = height;
+    encoder->channels = channels;
+    encoder->colorspace = colorspace;
+    encoder->keyframe_interval = keyframe_interval ? keyframe_interval : QOI_SEQ_DEFAULT_KEYFRAME_INTERVAL;
+    encoder->spans_capacity = max_spans * 2 * QOI_SEQ_MAX_VARINT_BYTES;
+    // A delta record is laid out in place: the opcodes go after room for the
+    // largest span table and are moved down once the table is known.
+    encoder->output_capacity = QOI_SEQ_FRAME_HEADER_SIZE + 4 + encoder->spans_capacity + max_qoi_size;
+
+    encoder->previous = (QOIPixel *)malloc(num_pixels * sizeof(QOIPixel));
+    encoder->spans = (uint8_t *)malloc(encoder->spans_capacity);
+    encoder->output = (uint8_t *)malloc(encoder->output_capacity);
+    if (!encoder->previous || !encoder->spans || !encoder->output) {
+        fprintf(stderr, "Error: Could not allocate memory for QOI sequence encoder.\n");
+        qoi_seq_encoder_free(encoder);
+        return 1;
+    }
+    return 0;
+}
+
+void qoi_seq_encoder_free(QOISeqEncoder *encoder) {
+    if (!encoder) {
+        return;
+    }
+    free(encoder->previous);
+    free(encoder->spans);
+    free(encoder->output);
+    memset(encoder, 0, sizeof(*encoder));
+}
+
+void qoi_seq_encoder_write_header(const QOISeqEncoder *encoder, uint8_t header[QOI_SEQ_HEADER_SIZE]) {
+    uint8_t *out = header;
+    *out++ = 'q';
+    *out++ = 'o';
+    *out++ = 'i';
+    *out++ = 's';
+    out = qoi_write_u32_be(out, encoder->width);
+    out = qoi_write_u32_be(out, encoder->height);
+    *out++ = encoder->channels;
+    *out++ = encoder->colorspace;
+    qoi_write_u32_be(out, encoder->keyframe_interval);
+}
+
+static uint8_t *qoi_seq_write_frame_header(uint8_t *out, QOISeqFrameKind kind, uint32_t frame_number,
+                                           size_t payload_size) {
+    *out++ = (uint8_t)kind;
+    out = qoi_write_u32_be(out, frame_number);
+    return qoi_write_u32_be(out, (uint32_t)payload_size);
+}
+
+// Encodes the spans that differ from encoder->previous and brings previous
+// up to date. Returns the payload size.
+static size_t qoi_seq_encode_delta(QOISeqEncoder *encoder, const QOIPixel *pixels) {
+    size_t num_pixels = (size_t)encoder->width * encoder->height;
+    QOIPixel *previous = encoder->previous;
+    uint8_t *payload = encoder->output + QOI_SEQ_FRAME_HEADER_SIZE;
+    uint8_t *ops_start = payload + 4 + encoder->spans_capacity;
+    uint8_t *ops = ops_start;
+    uint8_t *spans = encoder->spans;
+    uint32_t span_count = 0;
+
+    QOIEncodeState state;
+    qoi_encode_state_init(&state);
+
+    size_t pos = 0;
+    while (pos < num_pixels) {
+        size_t skip = qoi_seq_equal_length(pixels + pos, previous + pos, num_pixels - pos);
+        pos += skip;
+        if (pos == num_pixels) {
+            break;
+        }
+
+        // The changed region ends at the first gap of QOI_SEQ_MIN_SKIP
+        // unchanged pixels, or at the end of the frame.
+        size_t start = pos;
+        while (pos < num_pixels) {
+            if (!qoi_pixels_are_equal(pixels[pos], previous[pos])) {
+                pos++;
+                continue;
+            }
+            size_t limit = num_pixels - pos < QOI_SEQ_MIN_SKIP ? num_pixels - pos : QOI_SEQ_MIN_SKIP;
+            size_t equal = qoi_seq_equal_length(pixels + pos, previous + pos, limit);
+            if (equal == limit) {
+                break;
+            }
+            pos += equal;
+        }
+
+        size_t count = pos - start;
+        spans = qoi_seq_write_varint(spans, (uint32_t)skip);
+        spans = qoi_seq_write_varint(spans, (uint32_t)count);
+        span_count++;
+        ops = qoi_encode_pixels(&state, pixels + start, count, encoder->channels, ops);
+        memcpy(previous + start, pixels + start, count * sizeof(QOIPixel));
+    }
+    ops = qoi_encode_flush_run(&state, ops);
+
+    size_t spans_size = (size_t)(spans - encoder->spans);
+    size_t ops_size = (size_t)(ops - ops_start);
+    qoi_write_u32_be(payload, span_count);
+    memcpy(payload + 4, encoder->spans, spans_size);
+    memmove(payload + 4 + spans_size, ops_start, ops_size);
+    return 4 + spans_size + ops_size;
+}
+
+int qoi_seq_encode_frame(QOISeqEncoder *encoder,
+                         const QOIPixel *pixels,
+                         int force_keyframe,
+                         const uint8_t **out_data,
+                         size_t *out_size) {
+    if (!encoder || !encoder->output || !pixels || !out_data || !out_size) {
+        return 1;
+    }
+
+    uint32_t frame_number = encoder->frame_number;
+    QOISeqFrameKind kind = force_keyframe || frame_number % encoder->keyframe_interval == 0
+        ? QOI_SEQ_KEYFRAME : QOI_SEQ_DELTA;
+    size_t payload_size;
+
+    if (kind == QOI_SEQ_KEYFRAME) {
+        if (qoi_encode_to_memory(pixels, encoder->width, encoder->height, encoder->channels,
+                                 encoder->colorspace, encoder->output + QOI_SEQ_FRAME_HEADER_SIZE,
+                                 encoder->output_capacity - QOI_SEQ_FRAME_HEADER_SIZE, &payload_size) != 0) {
+            return 1;
+        }
+        memcpy(encoder->previous, pixels, (size_t)encoder->width * encoder->height * sizeof(QOIPixel));
+    } else {
+        payload_size = qoi_seq_encode_delta(encoder, pixels);
+    }
+    if (payload_size > UINT32_MAX) {
+        fprintf(stderr, "Error: QOI sequence frame too large.\n");
+        return 1;
+    }
+
+    qoi_seq_write_frame_header(encoder->output, kind, frame_number, payload_size);
+    encoder->frame_number++;
+    *out_data = encoder->output;
+    *out_size = QOI_SEQ_FRAME_HEADER_SIZE + payload_size;
+    return 0;
+}
+
+int qoi_seq_decoder_init(QOISeqDecoder *decoder, const uint8_t *header, size_t header_size) {
+    if (!decoder || !header) {
+        return 1;
+    }
+    memset(decoder, 0, sizeof(*decoder));
+
+    if (header_size < QOI_SEQ_HEADER_SIZE ||
+        header[0] != 'q' || header[1] != 'o' || header[2] != 'i' || header[3] != 's') {
+        fprintf(stderr, "Error: Invalid QOI sequence header.\n");
+        return 1;
+    }
+    decoder->width = qoi_read_u32_be(header + 4);
+    decoder->height = qoi_read_u32_be(header + 8);
+    decoder->channels = header[12];
+    decoder->colorspace = header[13];
+    decoder->keyframe_interval = qoi_read_u32_be(header + 14);
+
+    if (decoder->width == 0 || decoder->height == 0 || decoder->channels < 3 || decoder->channels > 4 ||
+        decoder->colorspace > 1 || decoder->width > UINT32_MAX / decoder->height) {
+        fprintf(stderr, "Error: Invalid image dimensions in QOI sequence header.\n");
+        return 1;
+    }
+    if ((size_t)decoder->width > SIZE_MAX / sizeof(QOIPixel) / decoder->height) {
+        fprintf(stderr, "Error: Image dimensions too large for memory allocation.\n");
+        return 1;
+    }
+    decoder->frame = (QOIPixel *)malloc((size_t)decoder->width * decoder->height * sizeof(QOIPixel));
+    if (!decoder->frame) {
+        fprintf(stderr, "Error: Could not allocate memory for decoded pixels.\n");
+        return 1;
+    }
+    return 0;
+}
+
+void qoi_seq_decoder_free(QOISeqDecoder *decoder) {
+    if (!decoder) {
+        return;
+    }
+    free(decoder->frame);
+    memset(decoder, 0, sizeof(*decoder));
+}
+
+int qoi_seq_read_frame_info(const uint8_t *data, size_t data_size, QOISeqFrameInfo *info) {
+    if (!data || !info || data_size < QOI_SEQ_FRAME_HEADER_SIZE ||
+        (data[0] != QOI_SEQ_KEYFRAME && data[0] != QOI_SEQ_DELTA)) {
+        return 1;
+    }
+    uint32_t payload_size = qoi_read_u32_be(data + 5);
+    if (payload_size > data_size - QOI_SEQ_FRAME_HEADER_SIZE) {
+        return 1;
+    }
+    info->kind = (QOISeqFrameKind)data[0];
+    info->frame_number = qoi_read_u32_be(data + 1);
+    info->payload = data + QOI_SEQ_FRAME_HEADER_SIZE;
+    info->payload_size = payload_size;
+    info->record_size = QOI_SEQ_FRAME_HEADER_SIZE + (size_t)payload_size;
+    return 0;
+}
+
+static int qoi_seq_apply_delta(QOISeqDecoder *decoder, const uint8_t *payload, size_t payload_size) {
+    if (payload_size < 4) {
+        return 1;
+    }
+    size_t num_pixels = (size_t)decoder->width * decoder->height;
+    uint32_t span_count = qoi_read_u32_be(payload);
+    const uint8_t *spans = payload + 4;
+    const uint8_t *payload_end = payload + payload_size;
+
+    // Check the span table and find where the opcodes start.
+    const uint8_t *in = spans;
+    size_t pos = 0;
+    for (uint32_t span = 0; span < span_count; span++) {
+        uint32_t skip, count;
+        in = qoi_seq_read_varint(in, payload_end, &skip);
+        if (in) {
+            in = qoi_seq_read_varint(in, payload_end, &count);
+        }
+        if (!in || count == 0 || skip > num_pixels - pos || count > num_pixels - pos - skip) {
+            return 1;
+        }
+        pos += (size_t)skip + count;
+    }
+
+    QOIDecodeState state;
+    qoi_decode_state_init(&state);
+    const uint8_t *ops = in;
+    pos = 0;
+    for (uint32_t span = 0; span < span_count; span++) {
+        uint32_t skip, count;
+        // Validated by the first pass; checked again so skip and count are always set.
+        spans = qoi_seq_read_varint(spans, payload_end, &skip);
+        if (!spans || !(spans = qoi_seq_read_varint(spans, payload_end, &count))) {
+            return 1;
+        }
+        pos += skip;
+        if (qoi_decode_pixels(&state, &ops, payload_end, decoder->frame + pos, count) != count) {
+            return 1;
+        }
+        pos += count;
+    }
+    return state.run_remaining != 0 || ops != payload_end;
+}
+
+int qoi_seq_decode_frame(QOISeqDecoder *decoder, const uint8_t *record, size_t record_size) {
+    if (!decoder || !decoder->frame) {
+        return 1;
+    }
+    QOISeqFrameInfo info;
+    if (qoi_seq_read_frame_info(record, record_size, &info) != 0) {
+        fprintf(stderr, "Error: Invalid QOI sequence frame record.\n");
+        return 1;
+    }
+
+    if (info.kind == QOI_SEQ_KEYFRAME) {
+        uint32_t width, height;
+        uint8_t channels, colorspace;
+        size_t frame_bytes = (size_t)decoder->width * decoder->height * sizeof(QOIPixel);
+        QOIInfo key_info;
+        if (qoi_read_info(info.payload, info.payload_size, &key_info) != QOI_OK ||
+            key_info.width != decoder->width || key_info.height != decoder->height ||
+            qoi_decode_into(info.payload, info.payload_size, decoder->frame, (size_t)decoder->width * sizeof(QOIPixel),
+                            frame_bytes, QOI_LAYOUT_RGBA, &width, &height, &channels, &colorspace) != 0) {
+            fprintf(stderr, "Error: QOI sequence keyframe %u is corrupt.\n", info.frame_number);
+            decoder->have_frame = 0;
+            return 1;
+        }
+    } else {
+        if (!decoder->have_frame || info.frame_number != decoder->frame_number + 1) {
+            fprintf(stderr, "Error: QOI sequence delta frame %u does not follow the current frame.\n",
+                    info.frame_number);
+            return 1;
+        }
+        if (qoi_seq_apply_delta(decoder, info.payload, info.payload_size) != 0) {
+            fprintf(stderr, "Error: QOI sequence delta frame %u is corrupt.\n", info.frame_number);
+            decoder->have_frame = 0;
+            return 1;
+        }
+    }
+
+    decoder->frame_number = info.frame_number;
+    decoder->have_frame = 1;
+    return 0;
+}
+
+int qoi_seq_seek(QOISeqDecoder *decoder, const uint8_t *data, size_t data_size, uint32_t frame_number) {
+    if (!decoder || !data || data_size < QOI_SEQ_HEADER_SIZE) {
+        return 1;
+    }
+    if (decoder->have_frame && decoder->frame_number == frame_number) {
+        return 0;
+    }
+
+    // Find the target and the latest record decoding can start from: a
+    // keyframe, or the frame after the current one.
+    const size_t none = SIZE_MAX;
+    size_t start = none, target = none;
+    size_t offset = QOI_SEQ_HEADER_SIZE;
+    while (offset < data_size) {
+        QOISeqFrameInfo info;
+        if (qoi_seq_read_frame_info(data + offset, data_size - offset, &info) != 0) {
+            fprintf(stderr, "Error: Invalid QOI sequence frame record at offset %lu.\n", (unsigned long)offset);
+            return 1;
+        }
+        if (info.kind == QOI_SEQ_KEYFRAME ||
+            (decoder->have_frame && decoder->frame_number < frame_number &&
+             info.frame_number == decoder->frame_number + 1)) {
+            start = offset;
+        }
+        if (info.frame_number == frame_number) {
+            target = offset;
+            break;
+        }
+        offset += info.record_size;
+    }
+    if (target == none || start == none) {
+        fprintf(stderr, "Error: Frame %u not found in QOI sequence.\n", frame_number);
+        return 1;
+    }
+
+    for (offset = start; offset <= target; ) {
+        QOISeqFrameInfo info;
+        qoi_seq_read_frame_info(data + offset, data_size - offset, &info);
+        if (qoi_seq_decode_frame(decoder, data + offset, data_size - offset) != 0) {
+            return 1;
+        }
+        offset += info.record_size;
+    }
+    return 0;
+}
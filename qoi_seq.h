@@ -0,0 +1,109 @@
+#ifndef QOI_SEQ_H
+#define QOI_SEQ_H
+
+#include "qoi_utils.h"
+
+// QOI sequence ("QOI-SEQ"): frames of one size, for screen capture and
+// remote desktop where most of each frame repeats the previous one.
+// Keyframes are complete QOI files. Delta frames list the spans of pixels
+// that changed since the previous frame and encode only those pixels, as a
+// single QOI opcode stream running across the spans.
+//
+// Layout (all integers big-endian):
+//   header (QOI_SEQ_HEADER_SIZE bytes): magic "qois", width u32, height u32,
+//   channels u8, colorspace u8, keyframe_interval u32;
+//   frame records: kind u8 (QOISeqFrameKind), frame_number u32,
+//   payload_size u32, then the payload.
+//   Keyframe payload: a complete QOI file of the frame.
+//   Delta payload: span_count u32, span_count pairs of LEB128 varints
+//   (pixels to skip, pixels to copy; copy > 0) walking the frame in raster
+//   order, then the QOI opcodes for every copied pixel, starting from a fresh
+//   QOI state. Pixels after the last span are unchanged.
+//
+// A delta frame can only be applied to the frame numbered one less, so
+// seeking starts from the nearest earlier keyframe.
+
+#define QOI_SEQ_HEADER_SIZE 18
+#define QOI_SEQ_FRAME_HEADER_SIZE 9
+#define QOI_SEQ_DEFAULT_KEYFRAME_INTERVAL 60
+
+// Unchanged gaps shorter than this inside a changed region are encoded as
+// pixels; a new span costs more than a few run or index opcodes.
+#define QOI_SEQ_MIN_SKIP 8
+
+typedef enum QOISeqFrameKind {
+    QOI_SEQ_KEYFRAME = 0,
+    QOI_SEQ_DELTA = 1
+} QOISeqFrameKind;
+
+typedef struct QOISeqFrameInfo {
+    QOISeqFrameKind kind;
+    uint32_t frame_number;
+    const uint8_t *payload;
+    size_t payload_size;
+    size_t record_size;      // Frame header plus payload.
+} QOISeqFrameInfo;
+
+typedef struct QOISeqEncoder {
+    uint32_t width, height;
+    uint8_t channels, colorspace;
+    uint32_t keyframe_interval;
+    uint32_t frame_number;   // Number of the next frame.
+    QOIPixel *previous;      // The last frame, as the decoder will hold it.
+    uint8_t *spans;          // Span table of the delta frame being built.
+    size_t spans_capacity;
+    uint8_t *output;         // Record of the last encoded frame.
+    size_t output_capacity;
+} QOISeqEncoder;
+
+// keyframe_interval 0 selects QOI_SEQ_DEFAULT_KEYFRAME_INTERVAL; every
+// keyframe_interval-th frame, starting with the first, is a keyframe.
+int qoi_seq_encoder_init(QOISeqEncoder *encoder,
+                         uint32_t width,
+                         uint32_t height,
+                         uint8_t channels,
+                         uint8_t colorspace,
+                         uint32_t keyframe_interval);
+
+void qoi_seq_encoder_free(QOISeqEncoder *encoder);
+
+// Writes the sequence header that precedes the first frame record.
+void qoi_seq_encoder_write_header(const QOISeqEncoder *encoder, uint8_t header[QOI_SEQ_HEADER_SIZE]);
+
+// Encodes the next frame (width * height RGBA pixels) as one frame record.
+// force_keyframe requests a keyframe outside the interval, e.g. after a
+// receiver lost a frame. *out_data points into the encoder and stays valid
+// until the next call.
+int qoi_seq_encode_frame(QOISeqEncoder *encoder,
+                         const QOIPixel *pixels,
+                         int force_keyframe,
+                         const uint8_t **out_data,
+                         size_t *out_size);
+
+typedef struct QOISeqDecoder {
+    uint32_t width, height;
+    uint8_t channels, colorspace;
+    uint32_t keyframe_interval;
+    QOIPixel *frame;         // The last decoded frame.
+    uint32_t frame_number;
+    int have_frame;
+} QOISeqDecoder;
+
+// Reads the sequence header and allocates the frame buffer.
+int qoi_seq_decoder_init(QOISeqDecoder *decoder, const uint8_t *header, size_t header_size);
+
+void qoi_seq_decoder_free(QOISeqDecoder *decoder);
+
+// Parses the frame record at the start of data without decoding it.
+int qoi_seq_read_frame_info(const uint8_t *data, size_t data_size, QOISeqFrameInfo *info);
+
+// Applies one frame record; the result is in decoder->frame. A delta frame
+// fails unless it directly follows the last decoded frame.
+int qoi_seq_decode_frame(QOISeqDecoder *decoder, const uint8_t *record, size_t record_size);
+
+// Decodes frame frame_number of a complete sequence held in memory (header
+// included), starting from the nearest keyframe at or before it, or from the
+// current frame when that is closer.
+int qoi_seq_seek(QOISeqDecoder *decoder, const uint8_t *data, size_t data_size, uint32_t frame_number);
+
+#endif
@@ -0,0 +1,160 @@
+#include "qoi_seq.h"
+#include "qoi_internal.h"
+#include "qoi_test.h"
+
+// Encodes a short sequence with small, empty and full-frame changes and a
+// forced keyframe, decodes it in order and by seeking forwards and backwards,
+// then feeds delta records with malformed span tables to
+// qoi_seq_decode_frame(), which must reject them.
+
+#define FRAME_COUNT 16
+#define KEYFRAME_INTERVAL 5
+#define FORCED_KEYFRAME 7
+
+static int frame_matches(const QOISeqDecoder *decoder, const QOIPixel *frame, uint32_t frame_number) {
+    return decoder->have_frame && decoder->frame_number == frame_number &&
+           memcmp(decoder->frame, frame, (size_t)decoder->width * decoder->height * sizeof(QOIPixel)) == 0;
+}
+
+// Writes a delta record for frame_number with the given payload into record.
+static size_t make_delta(uint8_t *record, uint32_t frame_number, const uint8_t *payload, size_t payload_size) {
+    record[0] = QOI_SEQ_DELTA;
+    qoi_write_u32_be(record + 1, frame_number);
+    qoi_write_u32_be(record + 5, (uint32_t)payload_size);
+    memcpy(record + QOI_SEQ_FRAME_HEADER_SIZE, payload, payload_size);
+    return QOI_SEQ_FRAME_HEADER_SIZE + payload_size;
+}
+
+int main(void) {
+    uint32_t width = 70, height = 45;
+    size_t num_pixels = (size_t)width * height;
+    QOIPixel *frames[FRAME_COUNT];
+    uint32_t state = 77;
+    frames[0] = qoi_test_image(width, height, 1, 0);
+    for (int i = 1; i < FRAME_COUNT; i++) {
+        if (i == 11) {
+            frames[i] = qoi_test_image(width, height, 2, 0); // Everything changes.
+            continue;
+        }
+        frames[i] = (QOIPixel *)malloc(num_pixels * sizeof(QOIPixel));
+        memcpy(frames[i], frames[i - 1], num_pixels * sizeof(QOIPixel));
+        if (i == 3) {
+            continue; // Nothing changes.
+        }
+        // A few small rectangles, and a pixel at the very end of the frame.
+        for (int rect = 0; rect < 1 + i % 3; rect++) {
+            uint32_t x0 = qoi_test_random(&state) % width, y0 = qoi_test_random(&state) % height;
+            for (uint32_t y = y0; y < y0 + 6 && y < height; y++) {
+                for (uint32_t x = x0; x < x0 + 9 && x < width; x++) {
+                    frames[i][(size_t)y * width + x].r += (uint8_t)(i * 13);
+                }
+            }
+        }
+        frames[i][num_pixels - 1].g ^= (uint8_t)i;
+    }
+
+    // Encode the whole sequence into one buffer.
+    QOISeqEncoder encoder;
+    QOI_CHECK(qoi_seq_encoder_init(&encoder, width, height, 4, 0, KEYFRAME_INTERVAL) == 0);
+    size_t capacity = QOI_SEQ_HEADER_SIZE + FRAME_COUNT * encoder.output_capacity;
+    uint8_t *sequence = (uint8_t *)malloc(capacity);
+    size_t offsets[FRAME_COUNT];
+    qoi_seq_encoder_write_header(&encoder, sequence);
+    size_t size = QOI_SEQ_HEADER_SIZE;
+    for (int i = 0; i < FRAME_COUNT; i++) {
+        const uint8_t *record;
+        size_t record_size = 0;
+        QOI_CHECK(qoi_seq_encode_frame(&encoder, frames[i], i == FORCED_KEYFRAME, &record, &record_size) == 0);
+        int keyframe = i % KEYFRAME_INTERVAL == 0 || i == FORCED_KEYFRAME;
+        QOI_CHECK(record_size > 0 && record[0] == (keyframe ? QOI_SEQ_KEYFRAME : QOI_SEQ_DELTA));
+        offsets[i] = size;
+        memcpy(sequence + size, record, record_size);
+        size += record_size;
+    }
+    qoi_seq_encoder_free(&encoder);
+
+    // Frame by frame.
+    QOISeqDecoder decoder;
+    QOI_CHECK(qoi_seq_decoder_init(&decoder, sequence, size) == 0);
+    if (qoi_test_failures == 0) {
+        for (int i = 0; i < FRAME_COUNT; i++) {
+            QOISeqFrameInfo info;
+            QOI_CHECK(qoi_seq_read_frame_info(sequence + offsets[i], size - offsets[i], &info) == 0 &&
+                      info.frame_number == (uint32_t)i);
+            QOI_CHECK(qoi_seq_decode_frame(&decoder, sequence + offsets[i], size - offsets[i]) == 0 &&
+                      frame_matches(&decoder, frames[i], (uint32_t)i));
+        }
+        // A delta that does not follow the current frame.
+        QOI_CHECK(qoi_seq_decode_frame(&decoder, sequence + offsets[2], size - offsets[2]) != 0);
+    }
+
+    // Seeks forwards, backwards, across keyframes and to the current frame.
+    static const uint32_t targets[] = {15, 3, 4, 12, 0, 9, 9, 6, 8, 14, 1};
+    for (size_t i = 0; i < sizeof(targets) / sizeof(targets[0]); i++) {
+        QOI_CHECK(qoi_seq_seek(&decoder, sequence, size, targets[i]) == 0 &&
+                  frame_matches(&decoder, frames[targets[i]], targets[i]));
+    }
+    QOI_CHECK(qoi_seq_seek(&decoder, sequence, size, FRAME_COUNT) != 0);
+
+    // Hand-made delta records for frame 1, applied on top of frame 0. The
+    // first is well formed so the rejections below are down to the span table.
+    uint8_t record[64];
+    static const uint8_t valid[] = {0, 0, 0, 1, 5, 1, QOI_OP_RGBA_BYTE, 1, 2, 3, 4};
+    static const struct { uint8_t payload[16]; size_t size; } malformed[] = {
+        {{0, 0, 0, 1, 0x85, 0x80, 0x80, 0x80, 0x80}, 9},        // Skip varint never terminates.
+        {{0, 0, 0, 1, 0x85, 0x80}, 6},                          // Skip varint truncated.
+        // Skip of 5 plus a bit 32 that must not be dropped silently.
+        {{0, 0, 0, 1, 0x85, 0x80, 0x80, 0x80, 0x10, 1, QOI_OP_RGBA_BYTE, 1, 2, 3, 4}, 15},
+        {{0, 0, 0, 1, 5}, 5},                                   // Count missing.
+        {{0, 0, 0, 1, 5, 0}, 6},                                // Zero count.
+        {{0, 0, 0, 2, 5, 1, QOI_OP_RGBA_BYTE, 1, 2, 3, 4}, 11}, // Fewer spans than span_count.
+        {{0, 0, 0, 1, 5, 1, QOI_OP_RGBA_BYTE, 1, 2, 3}, 10},    // Opcodes truncated.
+        {{0, 0, 0, 1, 5, 1, QOI_OP_RGBA_BYTE, 1, 2, 3, 4, 0}, 12}, // Opcodes left over.
+        {{0, 0}, 2},                                            // No span count.
+    };
+    QOIPixel *expected = (QOIPixel *)malloc(num_pixels * sizeof(QOIPixel));
+    memcpy(expected, frames[0], num_pixels * sizeof(QOIPixel));
+    expected[5].r = 1;
+    expected[5].g = 2;
+    expected[5].b = 3;
+    expected[5].a = 4;
+
+    QOI_CHECK(qoi_seq_seek(&decoder, sequence, size, 0) == 0);
+    size_t record_size = make_delta(record, 1, valid, sizeof(valid));
+    QOI_CHECK(qoi_seq_decode_frame(&decoder, record, record_size) == 0 && frame_matches(&decoder, expected, 1));
+    for (size_t i = 0; i < sizeof(malformed) / sizeof(malformed[0]); i++) {
+        QOI_CHECK(qoi_seq_seek(&decoder, sequence, size, 0) == 0);
+        record_size = make_delta(record, 1, malformed[i].payload, malformed[i].size);
+        QOI_CHECK(qoi_seq_decode_frame(&decoder, record, record_size) != 0 && !decoder.have_frame);
+    }
+
+    // A span that runs past the end of the frame: skip all of it, copy one.
+    uint8_t past_end[16] = {0, 0, 0, 1};
+    past_end[4] = (uint8_t)((num_pixels & 0x7F) | 0x80);
+    past_end[5] = (uint8_t)(num_pixels >> 7);
+    past_end[6] = 1;
+    past_end[7] = QOI_OP_RGB_BYTE;
+    QOI_CHECK(qoi_seq_seek(&decoder, sequence, size, 0) == 0);
+    record_size = make_delta(record, 1, past_end, 11);
+    QOI_CHECK(qoi_seq_decode_frame(&decoder, record, record_size) != 0);
+    free(expected);
+
+    // Random bit flips in the records: seeking may fail but must stay in bounds.
+    uint8_t *copy = (uint8_t *)malloc(size);
+    for (int round = 0; round < 1500; round++) {
+        memcpy(copy, sequence, size);
+        uint32_t r = qoi_test_random(&state);
+        size_t at = QOI_SEQ_HEADER_SIZE + (r >> 3) % (size - QOI_SEQ_HEADER_SIZE);
+        copy[at] ^= (uint8_t)(1u << (r % 8));
+        decoder.have_frame = 0;
+        qoi_seq_seek(&decoder, copy, size, (uint32_t)round % FRAME_COUNT);
+    }
+    free(copy);
+
+    qoi_seq_decoder_free(&decoder);
+    free(sequence);
+    for (int i = 0; i < FRAME_COUNT; i++) {
+        free(frames[i]);
+    }
+    return qoi_test_report("qoi_seq_test");
+}
@@ -0,0 +1,132 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include "qoi_stats.h"
+#include <string.h>
+#include <time.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+QOIStats *qoi_stats_active = NULL;
+
+double qoi_stats_now(void) {
+#if defined(_WIN32)
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+void qoi_stats_reset(QOIStats *stats) {
+    if (stats) {
+        memset(stats, 0, sizeof(*stats));
+    }
+}
+
+void qoi_stats_attach(QOIStats *stats) {
+    qoi_stats_active = stats;
+}
+
+static void qoi_codec_stats_accumulate(QOICodecStats *dst, const QOICodecStats *src) {
+    for (int op = 0; op < QOI_STATS_OP_COUNT; op++) {
+        dst->opcode_count[op] += src->opcode_count[op];
+        dst->opcode_bytes[op] += src->opcode_bytes[op];
+    }
+    for (int length = 0; length <= QOI_MAX_RUN_LENGTH; length++) {
+        dst->run_histogram[length] += src->run_histogram[length];
+    }
+    dst->index_lookups += src->index_lookups;
+    dst->index_hits += src->index_hits;
+    dst->index_collisions += src->index_collisions;
+    for (int phase = 0; phase < QOI_STATS_PHASE_COUNT; phase++) {
+        dst->phase_seconds[phase] += src->phase_seconds[phase];
+    }
+}
+
+void qoi_stats_accumulate(QOIStats *dst, const QOIStats *src) {
+    if (!dst || !src) {
+        return;
+    }
+    qoi_codec_stats_accumulate(&dst->encode, &src->encode);
+    qoi_codec_stats_accumulate(&dst->decode, &src->decode);
+}
+
+static void qoi_codec_stats_print(const char *name, const QOICodecStats *stats, FILE *out) {
+    static const char *const opcode_names[QOI_STATS_OP_COUNT] = {
+        "INDEX", "DIFF", "LUMA", "RGB", "RGBA", "RUN"
+    };
+    static const char *const phase_names[QOI_STATS_PHASE_COUNT] = {
+        "header", "pixels", "convert", "trailer"
+    };
+
+    uint64_t total_ops = 0, total_bytes = 0, pixels = 0;
+    for (int op = 0; op < QOI_STATS_OP_COUNT; op++) {
+        total_ops += stats->opcode_count[op];
+        total_bytes += stats->opcode_bytes[op];
+    }
+    for (int length = 1; length <= QOI_MAX_RUN_LENGTH; length++) {
+        pixels += stats->run_histogram[length] * (uint64_t)length;
+    }
+    pixels += total_ops - stats->opcode_count[QOI_STATS_OP_RUN];
+    if (total_ops == 0) {
+        return;
+    }
+
+    fprintf(out, "%s: %llu opcodes, %llu bytes, %llu pixels\n", name,
+            (unsigned long long)total_ops, (unsigned long long)total_bytes, (unsigned long long)pixels);
+    for (int op = 0; op < QOI_STATS_OP_COUNT; op++) {
+        fprintf(out, "  %-5s %12llu ops (%5.1f%%) %12llu bytes (%5.1f%%)\n", opcode_names[op],
+                (unsigned long long)stats->opcode_count[op], 100.0 * stats->opcode_count[op] / total_ops,
+                (unsigned long long)stats->opcode_bytes[op],
+                total_bytes ? 100.0 * stats->opcode_bytes[op] / total_bytes : 0.0);
+    }
+
+    uint64_t runs = stats->opcode_count[QOI_STATS_OP_RUN];
+    if (runs > 0) {
+        // Power-of-two buckets: 1, 2-3, 4-7, ... 32-62.
+        fprintf(out, "  run lengths:");
+        for (int low = 1; low <= QOI_MAX_RUN_LENGTH; low *= 2) {
+            int high = low * 2 - 1 < QOI_MAX_RUN_LENGTH ? low * 2 - 1 : QOI_MAX_RUN_LENGTH;
+            uint64_t bucket = 0;
+            for (int length = low; length <= high; length++) {
+                bucket += stats->run_histogram[length];
+            }
+            if (low == high) {
+                fprintf(out, " %d:%.1f%%", low, 100.0 * bucket / runs);
+            } else {
+                fprintf(out, " %d-%d:%.1f%%", low, high, 100.0 * bucket / runs);
+            }
+        }
+        fprintf(out, "\n");
+    }
+
+    if (stats->index_lookups > 0) {
+        uint64_t misses = stats->index_lookups - stats->index_hits;
+        fprintf(out, "  index: %llu lookups, %.1f%% hits, %.1f%% of misses were collisions\n",
+                (unsigned long long)stats->index_lookups,
+                100.0 * stats->index_hits / stats->index_lookups,
+                misses ? 100.0 * stats->index_collisions / misses : 0.0);
+    }
+
+    fprintf(out, "  time:");
+    for (int phase = 0; phase < QOI_STATS_PHASE_COUNT; phase++) {
+        fprintf(out, " %s %.3f ms", phase_names[phase], stats->phase_seconds[phase] * 1000.0);
+    }
+    fprintf(out, "\n");
+}
+
+void qoi_stats_print(const QOIStats *stats, FILE *out) {
+    if (!stats || !out) {
+        return;
+    }
+    qoi_codec_stats_print("encode", &stats->encode, out);
+    qoi_codec_stats_print("decode", &stats->decode, out);
+}
@@ -0,0 +1,64 @@
+#ifndef QOI_STATS_H
+#define QOI_STATS_H
+
+#include "qoi_utils.h"
+
+// Codec statistics, collected only when the library is compiled with
+// QOI_ENABLE_STATS defined (and qoi_stats.c is linked in). Without it the
+// counting hooks compile to nothing and the codec runs at full speed.
+//
+// Collection is process-wide and unsynchronized: attach a QOIStats, run
+// encode/decode calls one at a time from a single thread, then detach.
+// Entry points that fan out to worker threads race on the counters unless
+// run with thread_count 1: qoi_mt_encode, qoi_mt_decode and
+// qoi_decode_parallel_indexed. Concurrent qoi_cache_get_* calls and the
+// qoi_batch conversion workers must not run while stats are attached.
+
+typedef enum QOIStatsOpcode {
+    QOI_STATS_OP_INDEX,
+    QOI_STATS_OP_DIFF,
+    QOI_STATS_OP_LUMA,
+    QOI_STATS_OP_RGB,
+    QOI_STATS_OP_RGBA,
+    QOI_STATS_OP_RUN,
+    QOI_STATS_OP_COUNT
+} QOIStatsOpcode;
+
+typedef enum QOIStatsPhase {
+    QOI_STATS_PHASE_HEADER,
+    QOI_STATS_PHASE_PIXELS,   // Opcode encoding/decoding.
+    QOI_STATS_PHASE_CONVERT,  // Pixel layout conversion (qoi_encode_from_layout, qoi_decode_into).
+    QOI_STATS_PHASE_TRAILER,  // End marker write/verification.
+    QOI_STATS_PHASE_COUNT
+} QOIStatsPhase;
+
+typedef struct QOICodecStats {
+    uint64_t opcode_count[QOI_STATS_OP_COUNT];
+    uint64_t opcode_bytes[QOI_STATS_OP_COUNT];
+    uint64_t run_histogram[QOI_MAX_RUN_LENGTH + 1]; // [n] counts runs of length n.
+    // Encoder only: every pixel that differs from its predecessor probes the
+    // index. A collision is a miss on a slot already holding another color.
+    uint64_t index_lookups;
+    uint64_t index_hits;
+    uint64_t index_collisions;
+    double phase_seconds[QOI_STATS_PHASE_COUNT];
+} QOICodecStats;
+
+typedef struct QOIStats {
+    QOICodecStats encode;
+    QOICodecStats decode;
+} QOIStats;
+
+void qoi_stats_reset(QOIStats *stats);
+
+// Subsequent codec calls add to stats; NULL stops collection.
+void qoi_stats_attach(QOIStats *stats);
+
+// Adds every counter of src to dst.
+void qoi_stats_accumulate(QOIStats *dst, const QOIStats *src);
+
+// Human-readable summary: opcode mix, bytes per opcode, run lengths, index
+// hit/collision rate and phase times.
+void qoi_stats_print(const QOIStats *stats, FILE *out);
+
+#endif
@@ -0,0 +1,667 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+#if !defined(_FILE_OFFSET_BITS)
+#define _FILE_OFFSET_BITS 64
+#endif
+
+#include "qoi_stream.h"
+#include "qoi_internal.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <io.h>
+#define qoi_sys_read(fd, data, size) _read(fd, data, (unsigned)(size))
+#define qoi_sys_write(fd, data, size) _write(fd, data, (unsigned)(size))
+#else
+#include <unistd.h>
+#define qoi_sys_read(fd, data, size) read(fd, data, size)
+#define qoi_sys_write(fd, data, size) write(fd, data, size)
+#endif
+
+enum {
+    QOI_STAGE_HEADER,
+    QOI_STAGE_PIXELS,
+    QOI_STAGE_END_MARKER,
+    QOI_STAGE_DONE,
+    QOI_STAGE_ERROR
+};
+
+static const unsigned char QOI_END_MARKER[8] = {0,0,0,0,0,0,0,1};
+
+static size_t qoi_stream_opcode_size(uint8_t byte1) {
+    if (byte1 == QOI_OP_RGB_BYTE) {
+        return 4;
+    }
+    if (byte1 == QOI_OP_RGBA_BYTE) {
+        return 5;
+    }
+    if (((byte1 >> 6) & 0x03) == QOI_OP_LUMA_TAG) {
+        return 2;
+    }
+    return 1;
+}
+
+static int qoi_stream_parse_header(QOIStreamDecoder *decoder) {
+    QOIInfo info;
+    QOIStatus status = qoi_read_info(decoder->pending_bytes, QOI_HEADER_SIZE, &info);
+    if (status != QOI_OK) {
+        fprintf(stderr, "Error: %s.\n", qoi_status_string(status));
+        return 1;
+    }
+
+    decoder->width = info.width;
+    decoder->height = info.height;
+    decoder->channels = info.channels;
+    decoder->colorspace = info.colorspace;
+
+    size_t row_bytes = (size_t)decoder->width * sizeof(QOIPixel);
+    if (row_bytes / sizeof(QOIPixel) != decoder->width) {
+        fprintf(stderr, "Error: Image width too large for memory allocation.\n");
+        return 1;
+    }
+
+    decoder->row_buffer = (QOIPixel *)malloc(row_bytes);
+    if (decoder->row_buffer == NULL) {
+        fprintf(stderr, "Error: Could not allocate memory for decoder row buffer.\n");
+        return 1;
+    }
+    return 0;
+}
+
+// Decodes opcodes from *in_ptr into the row buffer, handing each completed
+// row to the callback. Stops when the input runs out, leaving any trailing
+// partial opcode unconsumed, or once the last row is done.
+static int qoi_stream_decode_rows(QOIStreamDecoder *decoder,
+                                  QOIDecodeState *state,
+                                  const uint8_t **in_ptr,
+                                  const uint8_t *in_end) {
+    while (decoder->row_y < decoder->height) {
+        size_t wanted = decoder->width - decoder->row_x;
+        size_t written = qoi_decode_pixels(state, in_ptr, in_end, decoder->row_buffer + decoder->row_x, wanted);
+        decoder->row_x += (uint32_t)written;
+        if (written < wanted) {
+            return 0;
+        }
+
+        if (decoder->row_callback &&
+            decoder->row_callback(decoder->row_buffer, decoder->row_y, decoder->user_data) != 0) {
+            return 1;
+        }
+        decoder->row_x = 0;
+        decoder->row_y++;
+    }
+    if (state->run_remaining > 0) {
+        fprintf(stderr, "Error: Decoded more pixels than specified in header. Stream may be corrupt.\n");
+        return 1;
+    }
+    return 0;
+}
+
+void qoi_stream_decoder_init(QOIStreamDecoder *decoder,
+                             qoi_row_callback row_callback,
+                             void *user_data) {
+    if (!decoder) {
+        return;
+    }
+    memset(decoder, 0, sizeof(*decoder));
+    decoder->row_callback = row_callback;
+    decoder->user_data = user_data;
+    decoder->previous_pixel.a = 255;
+    decoder->stage = QOI_STAGE_HEADER;
+}
+
+QOIStreamStatus qoi_stream_decoder_feed(QOIStreamDecoder *decoder,
+                                        const uint8_t *data,
+                                        size_t data_size) {
+    if (!decoder || (!data && data_size > 0)) {
+        return QOI_STREAM_ERROR;
+    }
+
+    const uint8_t *in = data;
+    const uint8_t *in_end = data + data_size;
+
+    while (in < in_end && decoder->stage != QOI_STAGE_DONE && decoder->stage != QOI_STAGE_ERROR) {
+        if (decoder->stage == QOI_STAGE_HEADER) {
+            size_t take = QOI_HEADER_SIZE - decoder->pending_count;
+            if (take > (size_t)(in_end - in)) {
+                take = (size_t)(in_end - in);
+            }
+            memcpy(decoder->pending_bytes + decoder->pending_count, in, take);
+            decoder->pending_count += (uint8_t)take;
+            in += take;
+
+            if (decoder->pending_count == QOI_HEADER_SIZE) {
+                decoder->pending_count = 0;
+                decoder->stage = qoi_stream_parse_header(decoder) ? QOI_STAGE_ERROR : QOI_STAGE_PIXELS;
+            }
+        } else if (decoder->stage == QOI_STAGE_PIXELS) {
+            QOIDecodeState state;
+            state.previous_pixel = decoder->previous_pixel;
+            memcpy(state.index_array, decoder->index_array, sizeof(state.index_array));
+            state.run_remaining = decoder->run_remaining;
+            int status = 0;
+
+            // Complete an opcode split across feed() calls before decoding in place.
+            if (decoder->pending_count > 0) {
+                size_t op_size = qoi_stream_opcode_size(decoder->pending_bytes[0]);
+                size_t take = op_size - decoder->pending_count;
+                if (take > (size_t)(in_end - in)) {
+                    take = (size_t)(in_end - in);
+                }
+                memcpy(decoder->pending_bytes + decoder->pending_count, in, take);
+                decoder->pending_count += (uint8_t)take;
+                in += take;
+                if (decoder->pending_count == op_size) {
+                    const uint8_t *op = decoder->pending_bytes;
+                    decoder->pending_count = 0;
+                    status = qoi_stream_decode_rows(decoder, &state, &op, op + op_size);
+                }
+            }
+
+            if (status == 0 && decoder->pending_count == 0) {
+                status = qoi_stream_decode_rows(decoder, &state, &in, in_end);
+                if (status == 0 && decoder->row_y < decoder->height && in < in_end) {
+                    decoder->pending_count = (uint8_t)(in_end - in);
+                    memcpy(decoder->pending_bytes, in, decoder->pending_count);
+                    in = in_end;
+                }
+            }
+
+            decoder->previous_pixel = state.previous_pixel;
+            memcpy(decoder->index_array, state.index_array, sizeof(decoder->index_array));
+            decoder->run_remaining = state.run_remaining;
+            if (status != 0) {
+                decoder->stage = QOI_STAGE_ERROR;
+            } else if (decoder->row_y == decoder->height) {
+                decoder->stage = QOI_STAGE_END_MARKER;
+            }
+        } else {
+            size_t take = QOI_PADDING_SIZE - decoder->pending_count;
+            if (take > (size_t)(in_end - in)) {
+                take = (size_t)(in_end - in);
+            }
+            memcpy(decoder->pending_bytes + decoder->pending_count, in, take);
+            decoder->pending_count += (uint8_t)take;
+            in += take;
+
+            if (decoder->pending_count == QOI_PADDING_SIZE) {
+                if (memcmp(decoder->pending_bytes, QOI_END_MARKER, QOI_PADDING_SIZE) != 0) {
+                    fprintf(stderr, "Warning: End-of-stream marker mismatch. File might be corrupt or have extra data.\n");
+                } else if (in < in_end) {
+                    fprintf(stderr, "Warning: Additional data found after QOI end-of-stream marker.\n");
+                }
+                decoder->pending_count = 0;
+                decoder->stage = QOI_STAGE_DONE;
+            }
+        }
+    }
+
+    if (decoder->stage == QOI_STAGE_ERROR) {
+        return QOI_STREAM_ERROR;
+    }
+    return decoder->stage == QOI_STAGE_DONE ? QOI_STREAM_DONE : QOI_STREAM_NEED_MORE;
+}
+
+void qoi_stream_decoder_free(QOIStreamDecoder *decoder) {
+    if (!decoder) {
+        return;
+    }
+    free(decoder->row_buffer);
+    decoder->row_buffer = NULL;
+}
+
+static int qoi_stream_encoder_flush(QOIStreamEncoder *encoder) {
+    if (encoder->output_size > 0) {
+        if (encoder->write_callback(encoder->output_buffer, encoder->output_size, encoder->user_data) != 0) {
+            encoder->failed = 1;
+            return 1;
+        }
+        encoder->output_size = 0;
+    }
+    return 0;
+}
+
+int qoi_stream_encoder_begin(QOIStreamEncoder *encoder,
+                             uint32_t width,
+                             uint32_t height,
+                             uint8_t channels,
+                             uint8_t colorspace,
+                             qoi_write_callback write_callback,
+                             void *user_data) {
+    if (!encoder || !write_callback || width == 0 || height == 0) {
+        return 1;
+    }
+
+    encoder->write_callback = write_callback;
+    encoder->user_data = user_data;
+    encoder->width = width;
+    encoder->height = height;
+    encoder->channels = channels;
+    encoder->colorspace = colorspace;
+    encoder->rows_pushed = 0;
+    encoder->failed = 0;
+
+    QOIEncodeState state;
+    qoi_encode_state_init(&state);
+    encoder->previous_pixel = state.previous_pixel;
+    memcpy(encoder->index_array, state.index_array, sizeof(encoder->index_array));
+    encoder->run_count = state.run_count;
+#if defined(QOI_ENABLE_STATS)
+    encoder->index_occupied = state.index_occupied;
+#endif
+
+    uint8_t *out = qoi_write_header(width, height, channels, colorspace, encoder->output_buffer);
+    encoder->output_size = (size_t)(out - encoder->output_buffer);
+    return 0;
+}
+
+int qoi_stream_encoder_push_rows(QOIStreamEncoder *encoder,
+                                 const QOIPixel *rows,
+                                 uint32_t row_count,
+                                 size_t row_stride) {
+    if (!encoder || encoder->failed || (!rows && row_count > 0)) {
+        return 1;
+    }
+    if (row_count > encoder->height - encoder->rows_pushed) {
+        encoder->failed = 1;
+        return 1;
+    }
+
+    QOIEncodeState state;
+    state.previous_pixel = encoder->previous_pixel;
+    memcpy(state.index_array, encoder->index_array, sizeof(state.index_array));
+    state.run_count = encoder->run_count;
+#if defined(QOI_ENABLE_STATS)
+    state.index_occupied = encoder->index_occupied;
+#endif
+
+    uint8_t *out = encoder->output_buffer + encoder->output_size;
+    uint8_t *out_end = encoder->output_buffer + QOI_STREAM_ENCODER_BUFFER_SIZE;
+    size_t bytes_per_pixel = encoder->channels == 3 ? 4 : 5;
+    int status = 0;
+
+    for (uint32_t y = 0; y < row_count && status == 0; y++) {
+        const QOIPixel *row = (const QOIPixel *)((const uint8_t *)rows + (size_t)y * row_stride);
+        for (uint32_t x = 0; x < encoder->width; ) {
+            // One spare byte for a run left pending by the previous span.
+            size_t room = (size_t)(out_end - out);
+            if (room < bytes_per_pixel + 1) {
+                encoder->output_size = (size_t)(out - encoder->output_buffer);
+                if (qoi_stream_encoder_flush(encoder) != 0) {
+                    status = 1;
+                    break;
+                }
+                out = encoder->output_buffer;
+                room = QOI_STREAM_ENCODER_BUFFER_SIZE;
+            }
+            size_t count = (room - 1) / bytes_per_pixel;
+            if (count > encoder->width - x) {
+                count = encoder->width - x;
+            }
+            out = qoi_encode_pixels(&state, row + x, count, encoder->channels, out);
+            x += (uint32_t)count;
+        }
+    }
+
+    if (status == 0) {
+        encoder->output_size = (size_t)(out - encoder->output_buffer);
+        encoder->rows_pushed += row_count;
+    }
+    encoder->previous_pixel = state.previous_pixel;
+    memcpy(encoder->index_array, state.index_array, sizeof(encoder->index_array));
+    encoder->run_count = state.run_count;
+#if defined(QOI_ENABLE_STATS)
+    encoder->index_occupied = state.index_occupied;
+#endif
+    return status;
+}
+
+int qoi_stream_encoder_finish(QOIStreamEncoder *encoder) {
+    if (!encoder || encoder->failed || encoder->rows_pushed != encoder->height) {
+        return 1;
+    }
+
+    if (encoder->output_size > QOI_STREAM_ENCODER_BUFFER_SIZE - 1 - QOI_PADDING_SIZE &&
+        qoi_stream_encoder_flush(encoder) != 0) {
+        return 1;
+    }
+
+    uint8_t *out = encoder->output_buffer + encoder->output_size;
+    if (encoder->run_count > 0) {
+        *out++ = qoi_make_chunk(QOI_OP_RUN_TAG, encoder->run_count - 1);
+        encoder->run_count = 0;
+    }
+    out = qoi_write_end_marker(out);
+    encoder->output_size = (size_t)(out - encoder->output_buffer);
+
+    return qoi_stream_encoder_flush(encoder);
+}
+
+// Room past a full chunk, so a span of pixels never has to be split at the
+// chunk boundary; the overflow moves to the front once the chunk is written.
+#define QOI_FD_SLACK (64 * 1024)
+
+typedef struct QOIFdBuffer {
+    void *allocation;
+    uint8_t *data;           // QOI_FD_ALIGNMENT-aligned.
+} QOIFdBuffer;
+
+static int qoi_fd_buffer_init(QOIFdBuffer *buffer) {
+    buffer->allocation = malloc(QOI_FD_CHUNK_SIZE + QOI_FD_SLACK + QOI_FD_ALIGNMENT - 1);
+    if (!buffer->allocation) {
+        fprintf(stderr, "Error: Could not allocate the file I/O buffer.\n");
+        return 1;
+    }
+    uintptr_t address = (uintptr_t)buffer->allocation;
+    buffer->data = (uint8_t *)buffer->allocation +
+                   ((QOI_FD_ALIGNMENT - address % QOI_FD_ALIGNMENT) % QOI_FD_ALIGNMENT);
+    return 0;
+}
+
+typedef struct QOIFdWriter {
+    int fd;
+    int positional;          // pwrite() at offset; 0 for pipes and sockets.
+    uint64_t offset;         // File offset of the next byte to write.
+    uint64_t written;
+} QOIFdWriter;
+
+static void qoi_fd_writer_init(QOIFdWriter *writer, int fd) {
+    writer->fd = fd;
+    writer->positional = 0;
+    writer->offset = 0;
+    writer->written = 0;
+#if !defined(_WIN32)
+    off_t start = lseek(fd, 0, SEEK_CUR);
+    if (start >= 0) {
+        writer->positional = 1;
+        writer->offset = (uint64_t)start;
+    }
+#endif
+}
+
+static int qoi_fd_write(QOIFdWriter *writer, const uint8_t *data, size_t size) {
+    while (size > 0) {
+#if !defined(_WIN32)
+        ssize_t result = writer->positional
+            ? pwrite(writer->fd, data, size, (off_t)writer->offset)
+            : write(writer->fd, data, size);
+#else
+        int result = qoi_sys_write(writer->fd, data, size);
+#endif
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "Error: Could not write output: %s.\n", strerror(errno));
+            return 1;
+        }
+        data += result;
+        size -= (size_t)result;
+        writer->offset += (uint64_t)result;
+        writer->written += (uint64_t)result;
+    }
+    return 0;
+}
+
+// pwrite() leaves the file offset alone; move it past the output as write()
+// would have.
+static int qoi_fd_writer_finish(QOIFdWriter *writer) {
+#if !defined(_WIN32)
+    if (writer->positional && lseek(writer->fd, (off_t)writer->offset, SEEK_SET) < 0) {
+        fprintf(stderr, "Error: Could not seek output: %s.\n", strerror(errno));
+        return 1;
+    }
+#endif
+    return 0;
+}
+
+int qoi_encode_rows_to_fd(qoi_row_source source,
+                          void *user_data,
+                          uint32_t width,
+                          uint32_t height,
+                          uint8_t channels,
+                          uint8_t colorspace,
+                          int fd,
+                          uint64_t *out_size) {
+    if (!source || width == 0 || height == 0 || channels < 3 || channels > 4 || colorspace > 1 || fd < 0) {
+        return 1;
+    }
+
+    QOIFdBuffer buffer;
+    if (qoi_fd_buffer_init(&buffer) != 0) {
+        return 1;
+    }
+    QOIFdWriter writer;
+    qoi_fd_writer_init(&writer, fd);
+
+    QOIEncodeState state;
+    qoi_encode_state_init(&state);
+
+    uint8_t *chunk_end = buffer.data + QOI_FD_CHUNK_SIZE;
+    uint8_t *buffer_end = chunk_end + QOI_FD_SLACK;
+    uint8_t *out = qoi_write_header(width, height, channels, colorspace, buffer.data);
+    size_t bytes_per_pixel = channels == 3 ? 4 : 5;
+    int status = 0;
+
+    for (uint32_t y = 0; y < height && status == 0; ) {
+        const QOIPixel *rows = NULL;
+        uint32_t row_count = 0;
+        size_t row_stride = 0;
+        if (source(y, &rows, &row_count, &row_stride, user_data) != 0 || !rows ||
+            row_count == 0 || row_count > height - y) {
+            fprintf(stderr, "Error: Row source failed at row %u.\n", y);
+            status = 1;
+            break;
+        }
+
+        for (uint32_t r = 0; r < row_count && status == 0; r++) {
+            const QOIPixel *row = (const QOIPixel *)((const uint8_t *)rows + (size_t)r * row_stride);
+            for (uint32_t x = 0; x < width; ) {
+                if (out >= chunk_end) {
+                    if (qoi_fd_write(&writer, buffer.data, QOI_FD_CHUNK_SIZE) != 0) {
+                        status = 1;
+                        break;
+                    }
+                    size_t overflow = (size_t)(out - chunk_end);
+                    memmove(buffer.data, chunk_end, overflow);
+                    out = buffer.data + overflow;
+                }
+                // One spare byte for a run left pending by the previous span.
+                size_t count = (size_t)(buffer_end - out - 1) / bytes_per_pixel;
+                if (count > width - x) {
+                    count = width - x;
+                }
+                out = qoi_encode_pixels(&state, row + x, count, channels, out);
+                x += (uint32_t)count;
+            }
+        }
+        y += row_count;
+    }
+
+    if (status == 0) {
+        if (out >= chunk_end) {
+            status = qoi_fd_write(&writer, buffer.data, QOI_FD_CHUNK_SIZE);
+            size_t overflow = (size_t)(out - chunk_end);
+            memmove(buffer.data, chunk_end, overflow);
+            out = buffer.data + overflow;
+        }
+        out = qoi_encode_flush_run(&state, out);
+        out = qoi_write_end_marker(out);
+        if (status == 0) {
+            status = qoi_fd_write(&writer, buffer.data, (size_t)(out - buffer.data));
+        }
+        if (status == 0) {
+            status = qoi_fd_writer_finish(&writer);
+        }
+    }
+
+    free(buffer.allocation);
+    if (status == 0 && out_size) {
+        *out_size = writer.written;
+    }
+    return status;
+}
+
+typedef struct QOIStripCursor {
+    const QOIRowStrip *strips;
+    size_t strip_count;
+    size_t next;
+} QOIStripCursor;
+
+static int qoi_strip_source(uint32_t y,
+                            const QOIPixel **rows,
+                            uint32_t *row_count,
+                            size_t *row_stride,
+                            void *user_data) {
+    QOIStripCursor *cursor = (QOIStripCursor *)user_data;
+    (void)y;
+    if (cursor->next == cursor->strip_count) {
+        return 1;
+    }
+    const QOIRowStrip *strip = &cursor->strips[cursor->next++];
+    *rows = strip->rows;
+    *row_count = strip->row_count;
+    *row_stride = strip->row_stride;
+    return 0;
+}
+
+int qoi_encode_strips_to_fd(const QOIRowStrip *strips,
+                            size_t strip_count,
+                            uint32_t width,
+                            uint32_t height,
+                            uint8_t channels,
+                            uint8_t colorspace,
+                            int fd,
+                            uint64_t *out_size) {
+    if (!strips) {
+        return 1;
+    }
+    QOIStripCursor cursor = {strips, strip_count, 0};
+    return qoi_encode_rows_to_fd(qoi_strip_source, &cursor, width, height, channels, colorspace, fd, out_size);
+}
+
+// Reads into buffer after the data already held (up to end) until it holds
+// at least min_bytes or the file ends. Returns the new end of the data, or
+// NULL on a read error.
+static uint8_t *qoi_fd_fill(int fd, uint8_t *buffer, uint8_t *end, size_t min_bytes) {
+    while ((size_t)(end - buffer) < min_bytes) {
+        size_t room = QOI_FD_CHUNK_SIZE - (size_t)(end - buffer);
+        long result = (long)qoi_sys_read(fd, end, room);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "Error: Could not read input: %s.\n", strerror(errno));
+            return NULL;
+        }
+        if (result == 0) {
+            break;
+        }
+        end += result;
+    }
+    return end;
+}
+
+// Moves the unread bytes to the front of the buffer and fills up behind them.
+static uint8_t *qoi_fd_refill(int fd, uint8_t *buffer, const uint8_t *in, const uint8_t *in_end, size_t min_bytes) {
+    size_t kept = (size_t)(in_end - in);
+    memmove(buffer, in, kept);
+    return qoi_fd_fill(fd, buffer, buffer + kept, min_bytes);
+}
+
+int qoi_decode_rows_from_fd(int fd,
+                            qoi_row_callback row_callback,
+                            void *user_data,
+                            uint32_t *width,
+                            uint32_t *height,
+                            uint8_t *channels,
+                            uint8_t *colorspace) {
+    if (fd < 0 || !row_callback || !width || !height || !channels || !colorspace) {
+        return 1;
+    }
+
+    QOIFdBuffer buffer;
+    if (qoi_fd_buffer_init(&buffer) != 0) {
+        return 1;
+    }
+    QOIPixel *row = NULL;
+    int status = 1;
+
+    const uint8_t *in = buffer.data;
+    const uint8_t *in_end = qoi_fd_fill(fd, buffer.data, buffer.data, QOI_FD_CHUNK_SIZE);
+    if (!in_end) {
+        goto done;
+    }
+    QOIInfo info;
+    QOIStatus header_status = qoi_read_info(in, (size_t)(in_end - in), &info);
+    if (header_status != QOI_OK) {
+        fprintf(stderr, "Error: %s.\n", qoi_status_string(header_status));
+        goto done;
+    }
+    *width = info.width;
+    *height = info.height;
+    *channels = info.channels;
+    *colorspace = info.colorspace;
+    in += QOI_HEADER_SIZE;
+
+    size_t row_bytes = (size_t)info.width * sizeof(QOIPixel);
+    row = row_bytes / sizeof(QOIPixel) == info.width ? (QOIPixel *)malloc(row_bytes) : NULL;
+    if (!row) {
+        fprintf(stderr, "Error: Could not allocate memory for decoder row buffer.\n");
+        goto done;
+    }
+
+    QOIDecodeState state;
+    qoi_decode_state_init(&state);
+
+    for (uint32_t y = 0; y < info.height; y++) {
+        for (uint32_t x = 0; x < info.width; ) {
+            x += (uint32_t)qoi_decode_pixels(&state, &in, in_end, row + x, info.width - x);
+            if (x == info.width) {
+                break;
+            }
+            // Only a partial opcode, at most QOI_OP_RGBA, can be left over.
+            const uint8_t *refilled = qoi_fd_refill(fd, buffer.data, in, in_end, QOI_FD_CHUNK_SIZE);
+            if (!refilled) {
+                goto done;
+            }
+            if (refilled - buffer.data == in_end - in) {
+                fprintf(stderr, "Error: Unexpected EOF during pixel decoding at row %u.\n", y);
+                goto done;
+            }
+            in_end = refilled;
+            in = buffer.data;
+        }
+        if (row_callback(row, y, user_data) != 0) {
+            goto done;
+        }
+    }
+    if (state.run_remaining > 0) {
+        fprintf(stderr, "Error: Decoded more pixels than specified in header. Stream may be corrupt.\n");
+        goto done;
+    }
+
+    if ((size_t)(in_end - in) < QOI_PADDING_SIZE) {
+        const uint8_t *refilled = qoi_fd_refill(fd, buffer.data, in, in_end, QOI_PADDING_SIZE);
+        if (!refilled) {
+            goto done;
+        }
+        in_end = refilled;
+        in = buffer.data;
+    }
+    if ((size_t)(in_end - in) < QOI_PADDING_SIZE) {
+        fprintf(stderr, "Warning: Could not fully read/verify end-of-stream marker (read %d bytes of 8). File might be truncated.\n",
+                (int)(in_end - in));
+    } else if (memcmp(in, QOI_END_MARKER, QOI_PADDING_SIZE) != 0) {
+        fprintf(stderr, "Warning: End-of-stream marker mismatch. File might be corrupt or have extra data.\n");
+    }
+    status = 0;
+
+done:
+    free(row);
+    free(buffer.allocation);
+    return status;
+}
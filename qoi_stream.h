@@ -0,0 +1,154 @@
+#ifndef QOI_STREAM_H
+#define QOI_STREAM_H
+
+#include "qoi_utils.h"
+
+typedef enum QOIStreamStatus {
+    QOI_STREAM_ERROR = -1,
+    QOI_STREAM_NEED_MORE = 0,
+    QOI_STREAM_DONE = 1
+} QOIStreamStatus;
+
+// Called once per completed scanline. The row buffer is owned by the decoder
+// and is only valid until the callback returns. Return non-zero to abort.
+typedef int (*qoi_row_callback)(const QOIPixel *row, uint32_t y, void *user_data);
+
+typedef struct QOIStreamDecoder {
+    qoi_row_callback row_callback;
+    void *user_data;
+
+    uint32_t width, height;
+    uint8_t channels, colorspace;
+
+    QOIPixel previous_pixel;
+    QOIPixel index_array[QOI_INDEX_SIZE];
+    uint32_t run_remaining;
+
+    // Header bytes, an opcode split across two feed() calls, or end marker bytes.
+    uint8_t pending_bytes[QOI_HEADER_SIZE];
+    uint8_t pending_count;
+
+    QOIPixel *row_buffer;
+    uint32_t row_x, row_y;
+    int stage;
+} QOIStreamDecoder;
+
+void qoi_stream_decoder_init(QOIStreamDecoder *decoder,
+                             qoi_row_callback row_callback,
+                             void *user_data);
+
+// Feeds an arbitrary chunk of the QOI byte stream. Rows are delivered through
+// the callback as soon as they are complete; the decoder only ever holds one
+// row of pixels. Returns QOI_STREAM_DONE once the end marker has been seen.
+QOIStreamStatus qoi_stream_decoder_feed(QOIStreamDecoder *decoder,
+                                        const uint8_t *data,
+                                        size_t data_size);
+
+void qoi_stream_decoder_free(QOIStreamDecoder *decoder);
+
+// Receives compressed output from the streaming encoder. Return non-zero to abort.
+typedef int (*qoi_write_callback)(const uint8_t *data, size_t size, void *user_data);
+
+#define QOI_STREAM_ENCODER_BUFFER_SIZE (64 * 1024)
+
+typedef struct QOIStreamEncoder {
+    qoi_write_callback write_callback;
+    void *user_data;
+
+    uint32_t width, height;
+    uint8_t channels, colorspace;
+    uint32_t rows_pushed;
+
+    QOIPixel previous_pixel;
+    QOIPixel index_array[QOI_INDEX_SIZE];
+    uint8_t run_count;
+    uint64_t index_occupied; // Only maintained in QOI_ENABLE_STATS builds.
+
+    uint8_t output_buffer[QOI_STREAM_ENCODER_BUFFER_SIZE];
+    size_t output_size;
+    int failed;
+} QOIStreamEncoder;
+
+// Starts a new image and queues the header. Output is handed to write_callback
+// whenever the internal buffer fills, and once more from finish().
+int qoi_stream_encoder_begin(QOIStreamEncoder *encoder,
+                             uint32_t width,
+                             uint32_t height,
+                             uint8_t channels,
+                             uint8_t colorspace,
+                             qoi_write_callback write_callback,
+                             void *user_data);
+
+// Encodes row_count rows starting at rows; row_stride is the distance in bytes
+// between the starts of consecutive rows. Runs and index state carry over from
+// the previous call, so the output matches a single qoi_encode_to_memory().
+int qoi_stream_encoder_push_rows(QOIStreamEncoder *encoder,
+                                 const QOIPixel *rows,
+                                 uint32_t row_count,
+                                 size_t row_stride);
+
+// Flushes the final run and the end marker. Fails if fewer than height rows
+// were pushed.
+int qoi_stream_encoder_finish(QOIStreamEncoder *encoder);
+
+// Encoding and decoding straight to and from a file descriptor, for images
+// too large to hold in memory in either form (more than 4 gigapixels is
+// fine). Pixels pass through in rows; the compressed data goes through one
+// QOI_FD_CHUNK_SIZE buffer aligned to QOI_FD_ALIGNMENT. Full chunks are
+// written with pwrite() at multiples of QOI_FD_CHUNK_SIZE from the fd's
+// starting offset, or with write() to a pipe or socket.
+#define QOI_FD_CHUNK_SIZE (8 * 1024 * 1024)
+#define QOI_FD_ALIGNMENT 4096
+
+// Supplies the rows starting at row y: sets *rows to the first of *row_count
+// rows (1 to height - y), which must stay valid until the next call, and
+// *row_stride to the distance in bytes between their starts. Return non-zero
+// to abort.
+typedef int (*qoi_row_source)(uint32_t y,
+                              const QOIPixel **rows,
+                              uint32_t *row_count,
+                              size_t *row_stride,
+                              void *user_data);
+
+// A band of rows held in its own allocation.
+typedef struct QOIRowStrip {
+    const QOIPixel *rows;
+    uint32_t row_count;
+    size_t row_stride;
+} QOIRowStrip;
+
+// Encodes a width x height image pulled from source and writes it to fd,
+// starting at its current offset. *out_size receives the number of bytes
+// written and may be NULL.
+int qoi_encode_rows_to_fd(qoi_row_source source,
+                          void *user_data,
+                          uint32_t width,
+                          uint32_t height,
+                          uint8_t channels,
+                          uint8_t colorspace,
+                          int fd,
+                          uint64_t *out_size);
+
+// Same as qoi_encode_rows_to_fd() for an image split into strips, top to
+// bottom; their row counts must add up to height.
+int qoi_encode_strips_to_fd(const QOIRowStrip *strips,
+                            size_t strip_count,
+                            uint32_t width,
+                            uint32_t height,
+                            uint8_t channels,
+                            uint8_t colorspace,
+                            int fd,
+                            uint64_t *out_size);
+
+// Reads a QOI file from fd and hands each decoded row to row_callback, like
+// the stream decoder, but reading QOI_FD_CHUNK_SIZE at a time and decoding
+// with the in-memory decoder's fast path.
+int qoi_decode_rows_from_fd(int fd,
+                            qoi_row_callback row_callback,
+                            void *user_data,
+                            uint32_t *width,
+                            uint32_t *height,
+                            uint8_t *channels,
+                            uint8_t *colorspace);
+
+#endif
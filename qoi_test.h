@@ -0,0 +1,78 @@
+#ifndef QOI_TEST_H
+#define QOI_TEST_H
+
+// Helpers shared by the qoi_*_test.c programs. Each test is a standalone
+// executable that prints the checks that failed and exits non-zero if any did.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "qoi_utils.h"
+
+static int qoi_test_failures = 0;
+
+#define QOI_CHECK(condition)                                                           \
+    do {                                                                               \
+        if (!(condition)) {                                                            \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            qoi_test_failures++;                                                       \
+        }                                                                              \
+    } while (0)
+
+// xorshift32; deterministic so a failure reproduces.
+static inline uint32_t qoi_test_random(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+// An image that exercises every opcode: runs, small and larger deltas,
+// repeated colors for the index and, unless opaque, alpha changes. free() it.
+static inline QOIPixel *qoi_test_image(uint32_t width, uint32_t height, uint32_t seed, int opaque) {
+    QOIPixel *pixels = (QOIPixel *)malloc((size_t)width * height * sizeof(QOIPixel));
+    if (!pixels) {
+        return NULL;
+    }
+    uint32_t state = seed * 2654435761u + 1;
+    QOIPixel px = {0, 0, 0, 255};
+    for (size_t i = 0; i < (size_t)width * height; i++) {
+        uint32_t r = qoi_test_random(&state);
+        switch (r % 8) {
+        case 0: case 1: case 2:
+            break; // Run.
+        case 3:
+            px.r += (uint8_t)(r >> 8) % 3;
+            px.b -= (uint8_t)(r >> 16) % 2;
+            break;
+        case 4:
+            px.g += (uint8_t)(r >> 8) % 40;
+            px.r = (uint8_t)(px.r + px.g / 8);
+            break;
+        case 5:
+            if (i > 0) {
+                px = pixels[i - 1 - (r >> 8) % (i < 64 ? i : 64)]; // A recent color.
+            }
+            break;
+        case 6:
+            px.a = opaque ? 255 : (uint8_t)(r >> 24);
+            break;
+        default:
+            px.r = (uint8_t)(r >> 8);
+            px.g = (uint8_t)(r >> 16);
+            px.b = (uint8_t)(r >> 24);
+            break;
+        }
+        pixels[i] = px;
+    }
+    return pixels;
+}
+
+static inline int qoi_test_report(const char *name) {
+    printf("%s: %s\n", name, qoi_test_failures ? "FAILED" : "ok");
+    return qoi_test_failures != 0;
+}
+
+#endif
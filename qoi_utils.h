@@ -1,6 +1,7 @@
 #ifndef QOI_UTILS_H
 #define QOI_UTILS_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 
@@ -19,6 +20,79 @@ typedef struct QOIPixel {
 #define QOI_OP_LUMA_TAG  2  // Was 0b10
 #define QOI_OP_RUN_TAG   3  // Was 0b11
 
+#define QOI_HEADER_SIZE   14
+#define QOI_PADDING_SIZE  8
+
+// Byte order of caller-owned pixel buffers. QOI_LAYOUT_RGBA matches QOIPixel;
+// BGRX is four bytes per pixel with the fourth byte ignored on encode and
+// written as 255 on decode.
+//
+// The layouts after BGRX are decode-only and convert while storing:
+// RGBA_PREMULTIPLIED multiplies the 8-bit color by alpha as stored. The
+// RGBA16F (IEEE half) and RGBA32F layouts hold native-endian floats in
+// [0, 1]; the header colorspace selects the transfer, so QOI_SRGB color is
+// converted to linear and QOI_LINEAR color is only rescaled. Alpha is always
+// linear. The _PREMULTIPLIED float layouts multiply the linear color by alpha.
+typedef enum QOIPixelLayout {
+    QOI_LAYOUT_RGB,
+    QOI_LAYOUT_RGBA,
+    QOI_LAYOUT_BGRA,
+    QOI_LAYOUT_BGRX,
+    QOI_LAYOUT_RGBA_PREMULTIPLIED,
+    QOI_LAYOUT_RGBA16F,
+    QOI_LAYOUT_RGBA16F_PREMULTIPLIED,
+    QOI_LAYOUT_RGBA32F,
+    QOI_LAYOUT_RGBA32F_PREMULTIPLIED
+} QOIPixelLayout;
+
+#define QOI_SRGB   0
+#define QOI_LINEAR 1
+
+static inline size_t qoi_layout_bytes_per_pixel(QOIPixelLayout layout) {
+    switch (layout) {
+    case QOI_LAYOUT_RGB:
+        return 3;
+    case QOI_LAYOUT_RGBA16F:
+    case QOI_LAYOUT_RGBA16F_PREMULTIPLIED:
+        return 8;
+    case QOI_LAYOUT_RGBA32F:
+    case QOI_LAYOUT_RGBA32F_PREMULTIPLIED:
+        return 16;
+    default:
+        return 4;
+    }
+}
+
+// Worst-case encoded size (header + one QOI_OP_RGB per pixel for 3 channels or
+// one QOI_OP_RGBA per pixel otherwise + end marker).
+// Returns 0 if the result would not fit in a size_t.
+size_t qoi_encode_max_size(uint32_t width, uint32_t height, uint8_t channels);
+
+// Encodes into a caller-provided buffer of at least qoi_encode_max_size() bytes.
+// With channels == 3 the image is treated as opaque and the input alpha is
+// ignored, as in every other encoder entry point.
+int qoi_encode_to_memory(const QOIPixel *pixel_data,
+                         uint32_t width,
+                         uint32_t height,
+                         uint8_t channels,
+                         uint8_t colorspace,
+                         uint8_t *out_buffer,
+                         size_t out_capacity,
+                         size_t *out_size);
+
+// Encodes from a caller-owned buffer in the given layout. row_stride is the
+// distance in bytes between the starts of consecutive rows.
+int qoi_encode_from_layout(const void *pixels,
+                           uint32_t width,
+                           uint32_t height,
+                           size_t row_stride,
+                           QOIPixelLayout layout,
+                           uint8_t channels,
+                           uint8_t colorspace,
+                           uint8_t *out_buffer,
+                           size_t out_capacity,
+                           size_t *out_size);
+
 int qoi_encode_to_file(const QOIPixel *pixel_data,
                        uint32_t width,
                        uint32_t height,
@@ -26,10 +100,93 @@ int qoi_encode_to_file(const QOIPixel *pixel_data,
                        uint8_t colorspace,
                        FILE *outfile_ptr);
 
+// Result codes of qoi_read_info() and qoi_validate(); QOI_OK is 0 like every
+// other success return in the library.
+typedef enum QOIStatus {
+    QOI_OK = 0,
+    QOI_ERROR_INVALID_ARGUMENT,
+    QOI_ERROR_TRUNCATED_HEADER,    // Fewer than QOI_HEADER_SIZE bytes.
+    QOI_ERROR_BAD_MAGIC,
+    QOI_ERROR_ZERO_DIMENSIONS,
+    QOI_ERROR_BAD_CHANNELS,        // Not 3 or 4.
+    QOI_ERROR_BAD_COLORSPACE,      // Not 0 or 1.
+    QOI_ERROR_TRUNCATED_DATA,      // Opcodes end before width * height pixels.
+    QOI_ERROR_RUN_OVERFLOW,        // A run extends past width * height pixels.
+    QOI_ERROR_BAD_END_MARKER,      // Missing, short or wrong end marker.
+    QOI_ERROR_TRAILING_DATA        // Bytes after the end marker.
+} QOIStatus;
+
+typedef struct QOIInfo {
+    uint32_t width, height;
+    uint8_t channels, colorspace;
+} QOIInfo;
+
+// Parses only the 14-byte header. Never allocates or writes to stderr.
+QOIStatus qoi_read_info(const uint8_t *data, size_t data_size, QOIInfo *info);
+
+// Checks a whole QOI file without decoding pixels: header, that the opcodes
+// describe exactly width * height pixels, and the end marker. info and
+// error_offset may be NULL; on failure error_offset receives the byte offset
+// of the offending header field, opcode or trailer.
+QOIStatus qoi_validate(const uint8_t *data, size_t data_size, QOIInfo *info, size_t *error_offset);
+
+// Short description of a status code, e.g. for logging.
+const char *qoi_status_string(QOIStatus status);
+
 QOIPixel* qoi_decode_from_file(FILE *infile_ptr,
                                uint32_t *width,
                                uint32_t *height,
                                uint8_t *channels,
                                uint8_t *colorspace);
 
+QOIPixel* qoi_decode_from_memory(const uint8_t *data,
+                                 size_t data_size,
+                                 uint32_t *width,
+                                 uint32_t *height,
+                                 uint8_t *channels,
+                                 uint8_t *colorspace);
+
+// Decodes straight into a caller-owned buffer of pixels_capacity bytes using
+// the given layout and row stride; no pixel buffer is allocated.
+int qoi_decode_into(const uint8_t *data,
+                    size_t data_size,
+                    void *pixels,
+                    size_t row_stride,
+                    size_t pixels_capacity,
+                    QOIPixelLayout layout,
+                    uint32_t *width,
+                    uint32_t *height,
+                    uint8_t *channels,
+                    uint8_t *colorspace);
+
+// Decodes a reduced copy of the image in one pass, for thumbnails: each
+// output pixel is the rounded average of a 2^scale_shift square block of
+// source pixels (scale_shift 1, 2 or 3 gives 1/2, 1/4 or 1/8; 0 decodes at
+// full size). Channels are averaged independently, without alpha weighting,
+// before any premultiply or float conversion of the layout.
+// Edge blocks cover only the pixels present, so the output is
+// ceil(width / 2^scale_shift) by ceil(height / 2^scale_shift), returned in
+// *width and *height; the source dimensions are returned by qoi_read_info().
+// Only one row of block sums is allocated, and runs are added per block
+// rather than per pixel.
+int qoi_decode_scaled(const uint8_t *data,
+                      size_t data_size,
+                      unsigned scale_shift,
+                      void *pixels,
+                      size_t row_stride,
+                      size_t pixels_capacity,
+                      QOIPixelLayout layout,
+                      uint32_t *width,
+                      uint32_t *height,
+                      uint8_t *channels,
+                      uint8_t *colorspace);
+
+// Decodes a QOI file by path. On POSIX systems the file is memory-mapped and
+// decoded in place; elsewhere it falls back to qoi_decode_from_file().
+QOIPixel* qoi_decode_path(const char *path,
+                          uint32_t *width,
+                          uint32_t *height,
+                          uint8_t *channels,
+                          uint8_t *colorspace);
+
 #endif
\ No newline at end of file